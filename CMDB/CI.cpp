@@ -9,9 +9,56 @@ CI::CI(const std::string& id, const std::string& name, const std::string& type,
     int level, const std::unordered_map<std::string, std::string>& properties)
     : id_(id), name_(name), type_(type), level_(level), properties_(properties) {}
 
-std::string CI::getId() const { return id_; }
-std::string CI::getName() const { return name_; }
-std::string CI::getType() const { return type_; }
+CI::CI(const CI& other)
+    : id_(other.id_), name_(other.name_), type_(other.type_), level_(other.level_), properties_(other.properties_) {}
+
+CI::CI(CI&& other) noexcept
+    : id_(std::move(other.id_)),
+      name_(std::move(other.name_)),
+      type_(std::move(other.type_)),
+      level_(other.level_),
+      properties_(std::move(other.properties_)) {
+    other.invalidateCache();
+}
+
+CI& CI::operator=(const CI& other) {
+    if (this != &other) {
+        id_ = other.id_;
+        name_ = other.name_;
+        type_ = other.type_;
+        level_ = other.level_;
+        properties_ = other.properties_;
+        invalidateCache();
+    }
+
+    return *this;
+}
+
+CI& CI::operator=(CI&& other) noexcept {
+    if (this != &other) {
+        id_ = std::move(other.id_);
+        name_ = std::move(other.name_);
+        type_ = std::move(other.type_);
+        level_ = other.level_;
+        properties_ = std::move(other.properties_);
+        invalidateCache();
+        other.invalidateCache();
+    }
+
+    return *this;
+}
+
+CI::~CI() {
+    delete json_cache_.load(std::memory_order_relaxed);
+}
+
+void CI::invalidateCache() {
+    delete json_cache_.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+const std::string& CI::getId() const { return id_; }
+const std::string& CI::getName() const { return name_; }
+const std::string& CI::getType() const { return type_; }
 int CI::getLevel() const { return level_; }
 const std::unordered_map<std::string, std::string>& CI::getProperties() const { return properties_; }
 
@@ -41,6 +88,7 @@ bool CI::setName(const std::string& name) {
     if (name_ == name) return false;
 
     name_ = name;
+    invalidateCache();
     return true;
 }
 
@@ -48,6 +96,7 @@ bool CI::setLevel(int level) {
     if (level_ == level) return false;
 
     level_ = level;
+    invalidateCache();
     return true;
 }
 
@@ -56,6 +105,7 @@ bool CI::setProperty(const std::string& key, const std::optional<std::string>& v
         auto it = properties_.find(key);
         if (it != properties_.end()) {
             properties_.erase(it);
+            invalidateCache();
             return true;
         }
         return false;
@@ -65,9 +115,11 @@ bool CI::setProperty(const std::string& key, const std::optional<std::string>& v
     if (it != properties_.end()) {
         if (it->second == *value) return false;
         it->second = *value;
+        invalidateCache();
         return true;
     } else {
         properties_[key] = *value;
+        invalidateCache();
         return true;
     }
 
@@ -77,6 +129,7 @@ bool CI::setProperty(const std::string& key, const std::optional<std::string>& v
 
 void CI::setProperties(const std::unordered_map<std::string, std::string>& properties) {
     properties_ = properties;
+    invalidateCache();
 }
 
 bool CI::setProperties(const boost::json::object& update_ci, std::string& message) {
@@ -135,6 +188,7 @@ bool CI::removeProperty(const std::string& key) {
     
     if (it != properties_.end()) {
         properties_.erase(it);
+        invalidateCache();
         return true;
     }
 
@@ -175,6 +229,8 @@ bool CI::load(std::ifstream& in) {
         return false;
     }
 
+    invalidateCache();
+
     size_t idLen, nameLen, typeLen;
 
     in.read(reinterpret_cast<char*>(&idLen), sizeof(idLen));
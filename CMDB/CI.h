@@ -9,8 +9,10 @@
 #pragma once
 
 #include <boost/json.hpp>
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -49,26 +51,51 @@ public:
     CI(const std::string& id, const std::string& name, const std::string& type,
         int level, const std::unordered_map<std::string, std::string>& properties);
 
+    /**
+     * @brief Конструктор копирования. Копия создается с пустым кэшем сериализации.
+     */
+    CI(const CI& other);
+
+    /**
+     * @brief Конструктор перемещения. Поля переносятся, кэши сериализации обоих объектов пусты.
+     */
+    CI(CI&& other) noexcept;
+
+    /**
+     * @brief Оператор присваивания. Кэш сериализации сбрасывается.
+     */
+    CI& operator=(const CI& other);
+
+    /**
+     * @brief Оператор перемещающего присваивания. Кэши сериализации обоих объектов сбрасываются.
+     */
+    CI& operator=(CI&& other) noexcept;
+
+    /**
+     * @brief Деструктор.
+     */
+    ~CI();
+
     /**
      * @brief Получить идентификатор конфигурационной единицы.
      *
      * @return Идентификатор конфигурационной единицы.
      */
-    std::string getId() const;
+    const std::string& getId() const;
 
     /**
      * @brief Получить имя конфигурационной единицы.
      *
      * @return Имя конфигурационной единицы.
      */
-    std::string getName() const;
+    const std::string& getName() const;
 
     /**
      * @brief Получить тип конфигурационной единицы.
      *
      * @return Тип конфигурационной единицы.
      */
-    std::string getType() const;
+    const std::string& getType() const;
 
     /**
      * @brief Получить уровень конфигурационной единицы.
@@ -163,6 +190,34 @@ public:
      */
     bool removeProperty(const std::string& key);
 
+    /**
+     * @brief Получить закэшированное сериализованное представление конфигурационной единицы.
+     *
+     * При первом обращении представление строится функцией build и сохраняется в объекте,
+     * следующие обращения возвращают ту же строку. Любое изменение CI сбрасывает кэш. CI,
+     * опубликованные в снимке, не изменяются (модификация работает с копией), поэтому кэш
+     * строится один раз на версию CI; одновременные обращения из разных потоков безопасны.
+     *
+     * @param build Функция, записывающая представление в переданную строку.
+     * @return Сериализованное представление (действительно, пока CI не изменен и не уничтожен).
+     */
+    template <class Build>
+    const std::string& getCachedJSON(Build&& build) const {
+        if (const std::string* cached = json_cache_.load(std::memory_order_acquire)) {
+            return *cached;
+        }
+
+        auto fresh = std::make_unique<std::string>();
+        build(*fresh);
+
+        std::string* expected = nullptr;
+        if (!json_cache_.compare_exchange_strong(expected, fresh.get(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return *expected;
+        }
+
+        return *fresh.release();
+    }
+
     /**
      * @brief Сохранить конфигурационную единицу в файл.
      *
@@ -190,6 +245,12 @@ private:
     std::string type_; ///< Тип конфигурационной единицы.
     int level_; ///< Уровень конфигурационной единицы.
     std::unordered_map<std::string, std::string> properties_; ///< Набор свойств конфигурационной единицы.
+    mutable std::atomic<std::string*> json_cache_{nullptr}; ///< Кэш сериализованного представления.
+
+    /**
+     * @brief Сбросить кэш сериализованного представления.
+     */
+    void invalidateCache();
 };
 
 } // namespace cmdb
\ No newline at end of file
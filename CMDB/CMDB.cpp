@@ -10,9 +10,9 @@ const std::string LEVEL_3 = "Physical Layer";
 std::unique_ptr<CMDB> CMDB::instance_;
 std::once_flag CMDB::init_flag_;
 
-CMDB& CMDB::getInstance(const std::string& filename) {
+CMDB& CMDB::getInstance(const std::string& filename, size_t shard_count) {
     std::call_once(init_flag_, [&]() {
-        instance_.reset(new CMDB);
+        instance_.reset(new CMDB(shard_count));
         instance_->filename_ = filename;
 
         instance_->startAutoSave();        
@@ -32,7 +32,13 @@ CMDB& CMDB::getInstance(const std::string& filename) {
     return *instance_;
 }
 
+CMDB::CMDB(size_t shard_count)
+    : snapshot_(std::make_shared<Snapshot>(shard_count)),
+      shard_mutexes_(std::max<size_t>(shard_count, 1)) {}
+
 CMDB::~CMDB() {
+    pipeline_.reset();
+
     {
         std::lock_guard<std::mutex> lock(stop_mutex_);
         stop_thread_ = true;
@@ -51,6 +57,170 @@ CMDB::~CMDB() {
     }
 }
 
+std::shared_ptr<const Snapshot> CMDB::snapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+uint64_t CMDB::getGeneration() const {
+    return snapshot()->getGeneration();
+}
+
+size_t CMDB::getShardCount() const {
+    return shard_mutexes_.size();
+}
+
+void CMDB::publish(SnapshotBuilder& builder) {
+    if (!builder.isModified()) {
+        return;
+    }
+
+    auto expected = snapshot();
+    std::shared_ptr<const Snapshot> desired;
+
+    do {
+        desired = builder.rebase(*expected, expected->getGeneration() + 1);
+    } while (!std::atomic_compare_exchange_weak(&snapshot_, &expected, desired));
+
+    modified_ = true;
+}
+
+CMDB::ShardLocks CMDB::lockShards(std::vector<size_t> indexes) {
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+
+    ShardLocks locks;
+    locks.reserve(indexes.size());
+
+    for (size_t index : indexes) {
+        locks.emplace_back(shard_mutexes_[index]);
+    }
+
+    return locks;
+}
+
+CMDB::ShardLocks CMDB::lockAllShards() {
+    std::vector<size_t> indexes(shard_mutexes_.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    return lockShards(std::move(indexes));
+}
+
+std::vector<size_t> CMDB::relatedShards(const Snapshot& snapshot, const std::string& id) {
+    std::vector<size_t> indexes{snapshot.shardIndex(id)};
+
+    snapshot.forEachRelationshipFrom(id, [&](const RelationshipPtr& relationship) {
+        indexes.push_back(snapshot.shardIndex(relationship->getDestination()));
+    });
+
+    if (auto sources = snapshot.getDependents(id)) {
+        for (const auto& source_id : *sources) {
+            indexes.push_back(snapshot.shardIndex(source_id));
+        }
+    }
+
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+
+    return indexes;
+}
+
+CMDB::ShardLocks CMDB::lockRelatedShards(const std::string& id) {
+    auto indexes = relatedShards(*snapshot(), id);
+
+    while (true) {
+        auto locks = lockShards(indexes);
+        auto actual = relatedShards(*snapshot(), id);
+
+        // Пока удерживается сегмент КЕ, новые связи с ней появиться не могут,
+        // поэтому повторная попытка требуется не более одного раза.
+        if (std::includes(indexes.begin(), indexes.end(), actual.begin(), actual.end())) {
+            return locks;
+        }
+
+        indexes = std::move(actual);
+    }
+}
+
+CMDB::ShardLocks CMDB::lockEndpoints(const std::string& from_id, const std::string& to_id) {
+    auto current = snapshot();
+    return lockShards({current->shardIndex(from_id), current->shardIndex(to_id)});
+}
+
+CMDB::AllLocks CMDB::lockAll() {
+    return AllLocks{std::unique_lock<std::mutex>(levels_mutex_), lockAllShards()};
+}
+
+template <typename Lock, typename Apply>
+auto CMDB::mutate(Lock lock, Apply apply) -> decltype(apply(std::declval<SnapshotBuilder&>())) {
+    if (pipeline_) {
+        return pipeline_->submit(std::move(apply)).get();
+    }
+
+    auto locks = lock();
+    SnapshotBuilder builder(snapshot());
+    auto result = apply(builder);
+    publish(builder);
+
+    return result;
+}
+
+template <typename Lock, typename Apply, typename Callback>
+void CMDB::mutate(Lock lock, Apply apply, Callback callback) {
+    using Result = decltype(apply(std::declval<SnapshotBuilder&>()));
+
+    if (pipeline_) {
+        pipeline_->submit(std::move(apply), std::move(callback));
+        return;
+    }
+
+    std::exception_ptr error;
+    Result result{};
+
+    try {
+        result = mutate(std::move(lock), std::move(apply));
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    callback(error, std::move(result));
+}
+
+void CMDB::commitBatch(const WritePipeline::Batch& batch) {
+    auto locks = lockAll();
+    SnapshotBuilder builder(snapshot());
+
+    for (auto* mutation : batch) {
+        // Модификация применяется к дочернему построителю: прерванная исключением не оставляет
+        // частичных изменений в пачке
+        SnapshotBuilder child(builder.build(builder.view().getGeneration()));
+
+        try {
+            mutation->apply(child);
+        } catch (...) {
+            mutation->fail(std::current_exception());
+            continue;
+        }
+
+        builder.merge(std::move(child));
+    }
+
+    publish(builder);
+}
+
+void CMDB::enableWritePipeline(size_t max_batch) {
+    pipeline_ = std::make_unique<WritePipeline>(
+        [this](const WritePipeline::Batch& batch) { commitBatch(batch); },
+        max_batch);
+}
+
+void CMDB::disableWritePipeline() {
+    pipeline_.reset();
+}
+
+bool CMDB::isWritePipelineEnabled() const {
+    return pipeline_ != nullptr;
+}
+
 /*
 *   BEGIN: Методы для работы с CI
 */
@@ -63,119 +233,195 @@ bool CMDB::addCI(
     const std::unordered_map<std::string, std::string>& properties
     )
 {
-    if (level >= static_cast<int>(levels_.size())) {
-        return false;
-    }
-    std::lock_guard<std::mutex> lock(cis_mutex_);
+    return mutate(
+        [&]() { return lockShards({snapshot()->shardIndex(id)}); },
+        [&](SnapshotBuilder& builder) {
+            if (level < 0 || level >= static_cast<int>(builder.view().getLevels().size())) {
+                return false;
+            }
 
-    auto ci = std::make_shared<CI>(id, name, type, level, properties);
-    all_cis_.push_back(ci);
-    id_to_ci_[id] = ci;
+            if (builder.view().getCI(id)) {
+                return false;
+            }
 
-    updatePropertiesMap(ci, ci->getProperties());
+            builder.putCI(std::make_shared<CI>(id, name, type, level, properties));
 
-    modified_ = true;
+            return true;
+        });
+}
 
-    return true;
+CMDB::BulkResult CMDB::addCIs(std::vector<CIData> cis) {
+    return mutate(
+        [&]() {
+            auto current = snapshot();
+            std::vector<size_t> indexes;
+            indexes.reserve(cis.size());
+
+            for (const auto& ci : cis) {
+                indexes.push_back(current->shardIndex(ci.id));
+            }
+
+            return lockShards(std::move(indexes));
+        },
+        [&](SnapshotBuilder& builder) {
+            BulkResult result;
+            result.succeeded.assign(cis.size(), false);
+            result.messages.resize(cis.size());
+
+            const auto& view = builder.view();
+            const int level_count = static_cast<int>(view.getLevels().size());
+
+            std::unordered_set<std::string> batch_ids;
+            batch_ids.reserve(cis.size());
+
+            std::vector<size_t> accepted;
+            accepted.reserve(cis.size());
+
+            for (size_t i = 0; i < cis.size(); ++i) {
+                const auto& ci = cis[i];
+
+                if (ci.level < 0 || ci.level >= level_count) {
+                    result.messages[i] = "Уровень " + std::to_string(ci.level) + " не существует.";
+                } else if (view.getCI(ci.id) || !batch_ids.insert(ci.id).second) {
+                    result.messages[i] = "КЕ с таким id " + ci.id + " уже существует.";
+                } else {
+                    accepted.push_back(i);
+                }
+            }
+
+            for (size_t i : accepted) {
+                auto& ci = cis[i];
+
+                result.messages[i] = ci.id + " добавлен";
+                result.succeeded[i] = true;
+
+                builder.insertCI(std::make_shared<CI>(ci.id, ci.name, ci.type, ci.level, ci.properties));
+            }
+
+            result.added = accepted.size();
+
+            return result;
+        });
 }
 
 int CMDB::addLevel(const std::string& name) {
-    auto it = std::find(levels_.begin(), levels_.end(), name);
-    if (it != levels_.end()) {
-        return std::distance(levels_.begin(), it);
-    }
+    return mutate(
+        [&]() { return std::unique_lock<std::mutex>(levels_mutex_); },
+        [&](SnapshotBuilder& builder) {
+            const auto& levels = builder.view().getLevels();
+            auto it = std::find(levels.begin(), levels.end(), name);
+            if (it != levels.end()) {
+                return static_cast<int>(std::distance(levels.begin(), it));
+            }
 
-    levels_.push_back(name);
-    modified_ = true;
+            builder.levels().push_back(name);
 
-    return levels_.size() - 1;
+            return static_cast<int>(builder.view().getLevels().size() - 1);
+        });
 }
 
 bool CMDB::renameLevel(size_t index, std::string new_name) {
-    if (index >= levels_.size()) {
-        return false;
-    }
-
-    levels_[index] = new_name; 
+    return mutate(
+        [&]() { return std::unique_lock<std::mutex>(levels_mutex_); },
+        [&](SnapshotBuilder& builder) {
+            if (index >= builder.view().getLevels().size()) {
+                return false;
+            }
 
-    modified_ = true;
+            builder.levels()[index] = std::move(new_name);
 
-    return true;
+            return true;
+        });
 }
 
 bool CMDB::removeLevel(size_t index) {
-    if (index >= levels_.size()) {
-        return false;
-    }
+    return mutate(
+        [&]() { return lockAll(); },
+        [&](SnapshotBuilder& builder) {
+            if (index >= builder.view().getLevels().size()) {
+                return false;
+            }
 
-    auto cis = getCIs(index);
+            bool in_use = false;
+            builder.view().forEachCI([&](const CIPtr& ci) {
+                in_use = in_use || ci->getLevel() == static_cast<int>(index);
+            });
 
-    if (cis && !cis->empty()) {
-        return false;
-    }
+            if (in_use) {
+                return false;
+            }
 
-    levels_.erase(levels_.begin() + index);
-    modified_ = true;
+            auto& levels = builder.levels();
+            levels.erase(levels.begin() + index);
 
-    return true;
+            return true;
+        });
 }
 
 void CMDB::addLevels(const std::vector<std::string>* new_levels) {
     if (!new_levels) return;
 
-    for (const auto& level : *new_levels) {
-        addLevel(level);
-    }
+    mutate(
+        [&]() { return std::unique_lock<std::mutex>(levels_mutex_); },
+        [&](SnapshotBuilder& builder) {
+            for (const auto& level : *new_levels) {
+                const auto& levels = builder.view().getLevels();
+
+                if (std::find(levels.begin(), levels.end(), level) == levels.end()) {
+                    builder.levels().push_back(level);
+                }
+            }
 
-    modified_ = true;    
+            return true;
+        });
 }
 
 bool CMDB::setLevels(const std::vector<std::string>* new_levels) {
-    if (!new_levels || !all_cis_.empty()) {
+    if (!new_levels) {
         return false;
     }
 
-    levels_ = *new_levels;
-    modified_ = true;
+    return mutate(
+        [&]() { return lockAll(); },
+        [&](SnapshotBuilder& builder) {
+            if (builder.view().getCICount() != 0) {
+                return false;
+            }
 
-    return true;
+            builder.levels() = *new_levels;
+
+            return true;
+        });
 }
 
 bool CMDB::removeCI(const std::string& id) {
-    auto it = id_to_ci_.find(id);
-    if (it == id_to_ci_.end()) return false;
-
-    std::lock_guard<std::mutex> lock(cis_mutex_);
-    auto ciPtr = it->second;
-    
-    id_to_ci_.erase(it);
-
-    all_cis_.erase(std::remove_if(all_cis_.begin(), all_cis_.end(), [&ciPtr](const CIPtr& ptr) { return ptr == ciPtr; }), all_cis_.end());
-
-    removeRelationshipsForId(id);
-    deletePropertiesMap(ciPtr, ciPtr->getProperties());
+    return mutate(
+        [&]() { return lockRelatedShards(id); },
+        [&](SnapshotBuilder& builder) {
+            if (!builder.eraseCI(id)) {
+                return false;
+            }
 
-    modified_ = true;
+            builder.removeRelationshipsForId(id);
 
-    return true;
+            return true;
+        });
 }
 
 CMDB::CIPtr CMDB::getCI(const std::string& id) const {
-    auto it = id_to_ci_.find(id);
-    return (it != id_to_ci_.end()) ? it->second : nullptr;
+    return snapshot()->getCI(id);
 }
 
 template <typename Predicate>
 std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIsImpl(Predicate pred) const {
-    std::lock_guard<std::mutex> lock(cis_mutex_);
-
+    auto current = snapshot();
     auto result = std::make_shared<std::vector<CIPtr>>();
 
-    for (const auto& ci_ptr : all_cis_) {
+    current->forEachCI([&](const CIPtr& ci_ptr) {
         if (pred(ci_ptr)) {
             result->push_back(ci_ptr);
         }
-    }
+    });
 
     return result->empty() ? nullptr : result;
 }
@@ -197,92 +443,236 @@ std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::string& type)
     return getCIsImpl([type](const CIPtr& ci) { return ci->getType() == type; });
 }
 
-std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::map<std::string, std::string>& filters) const {
-    auto result = std::make_shared<std::vector<CIPtr>>();
+std::function<bool(const CMDB::CIPtr&)> CMDB::matchCI(const std::map<std::string, std::string>& filters) {
     std::string id;
     std::string name;
     std::string type;
     int level = -1;
 
-    if (filters.empty()) {
-        result = getCIs();
-    } else {
-        if (filters.count("id") > 0) {
-            id = filters.at("id");
-        }
+    if (filters.count("id") > 0) {
+        id = filters.at("id");
+    }
 
-        if (filters.count("name") > 0) {
-            name = filters.at("name");
-        }
+    if (filters.count("name") > 0) {
+        name = filters.at("name");
+    }
 
-        if (filters.count("type") > 0) {
-            type = filters.at("type");
-        }
+    if (filters.count("type") > 0) {
+        type = filters.at("type");
+    }
 
-        if (filters.count("level") > 0) {
-            level = std::stoi(filters.at("level"));
-        }
+    if (filters.count("level") > 0) {
+        level = std::stoi(filters.at("level"));
+    }
 
-        std::shared_ptr<std::vector<cmdb::CMDB::CIPtr>> allCIs;
-        
-        if (filters.count("has_props") > 0) {
-            auto has_props = splitAndDecode(filters.at("has_props"), ',');
+    return [id, name, type, level](const CIPtr& ci) {
+        return (id.empty() || ci->getId() == id) &&
+            (name.empty() || ci->getName() == name) &&
+            (type.empty() || ci->getType() == type) &&
+            (level == -1 || ci->getLevel() == level);
+    };
+}
 
-            allCIs = getCIs(has_props);
-        } else {
-            allCIs = getCIs();
+std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::map<std::string, std::string>& filters) const {
+    auto result = std::make_shared<std::vector<CIPtr>>();
+    auto current = snapshot();
+    auto matches = matchCI(filters);
+    std::string id = filters.count("id") > 0 ? filters.at("id") : std::string();
+
+    if (filters.count("has_props") > 0) {
+        auto has_props = splitAndDecode(filters.at("has_props"), ',');
+        auto with_props = getCIs(*current, has_props);
+
+        for (const auto& ci : *with_props) {
+            if (matches(ci)) {
+                result->push_back(ci);
+            }
         }
+    } else if (!id.empty()) {
+        auto ci = current->getCI(id);
 
-        for (const auto& ci : *allCIs) {
-            if ((id.empty() || ci->getId() == id) &&
-                (name.empty() || ci->getName() == name) &&
-                (type.empty() || ci->getType() == type) &&
-                (level == -1 || ci->getLevel() == level)) {
+        if (ci && matches(ci)) {
+            result->push_back(ci);
+        }
+    } else {
+        current->forEachCI([&](const CIPtr& ci) {
+            if (matches(ci)) {
                 result->push_back(ci);
             }
-        }        
+        });
     }
 
     return result;
 }
 
-std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::vector<std::string>& props) const {
+std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::map<std::string, std::string>& filters,
+                                                       const std::optional<std::string>& after, size_t limit, bool& more) const {
     auto result = std::make_shared<std::vector<CIPtr>>();
-    std::unordered_set<std::string> seen_ids;
+    auto current = snapshot();
+    auto matches = matchCI(filters);
+    more = false;
 
-    std::unordered_set<CIPtr> candidate_cis;
+    std::vector<std::string> has_props;
+    if (filters.count("has_props") > 0) {
+        has_props = splitAndDecode(filters.at("has_props"), ',');
+    }
 
-    for (const auto& prop : props) {
-        auto it = property_to_cis_.find(prop);
-        if (it == property_to_cis_.end()) {
-            return std::make_shared<std::vector<CIPtr>>();
+    auto accept = [&](const CIPtr& ci) {
+        if (!matches(ci)) {
+            return true;
         }
 
-        if (candidate_cis.empty()) {
-            candidate_cis.insert(it->second.begin(), it->second.end());
-        } else {
-            std::unordered_set<CIPtr> intersection;
-            for (const auto& ci_ptr : it->second) {
-                if (candidate_cis.count(ci_ptr)) {
-                    intersection.insert(ci_ptr);
+        const auto& properties = ci->getProperties();
+        for (const auto& prop : has_props) {
+            if (properties.count(prop) == 0) {
+                return true;
+            }
+        }
+
+        if (result->size() == limit) {
+            more = true;
+            return false;
+        }
+
+        result->push_back(ci);
+        return true;
+    };
+
+    if (filters.count("id") > 0) {
+        const auto& id = filters.at("id");
+        auto ci = current->getCI(id);
+
+        if (ci && (!after || *after < id)) {
+            accept(ci);
+        }
+    } else {
+        current->forEachCIAfter(after, accept);
+    }
+
+    return result;
+}
+
+size_t CMDB::countCIs(const std::map<std::string, std::string>& filters, size_t limit) const {
+    auto current = snapshot();
+    auto matches = matchCI(filters);
+    bool by_fields = filters.count("id") > 0 || filters.count("name") > 0 || filters.count("type") > 0 ||
+                     filters.count("level") > 0;
+    size_t count = 0;
+
+    auto matchesIn = [&](const SnapshotShard& shard, const std::string& ci_id) {
+        auto ci = shard.getCI(ci_id);
+        return ci && matches(ci);
+    };
+
+    if (filters.count("has_props") > 0) {
+        auto props = splitAndDecode(filters.at("has_props"), ',');
+
+        for (size_t shard_index = 0; shard_index < current->getShardCount() && count < limit && !props.empty(); ++shard_index) {
+            const auto& shard = current->getShard(shard_index);
+            const auto& property_map = shard.getPropertyMap();
+
+            std::vector<const Snapshot::IdSet*> sets;
+            for (const auto& prop : props) {
+                auto it = property_map.find(prop);
+                if (it == property_map.end()) {
+                    break;
                 }
+                sets.push_back(&it->second);
+            }
+
+            if (sets.size() != props.size()) {
+                continue;
+            }
+
+            // Одно свойство без других фильтров - размер индекса свойства
+            if (sets.size() == 1 && !by_fields) {
+                count += sets.front()->size();
+                continue;
             }
-            
-            candidate_cis = std::move(intersection);
-            if (candidate_cis.empty()) {
-                return std::make_shared<std::vector<CIPtr>>();
+
+            std::sort(sets.begin(), sets.end(), [](const Snapshot::IdSet* a, const Snapshot::IdSet* b) { return a->size() < b->size(); });
+
+            for (const auto& ci_id : *sets.front()) {
+                bool has_all = std::all_of(sets.begin() + 1, sets.end(), [&](const Snapshot::IdSet* ids) {
+                    return ids->count(ci_id) > 0;
+                });
+
+                if (!has_all || (by_fields && !matchesIn(shard, ci_id))) {
+                    continue;
+                }
+
+                if (++count == limit) {
+                    break;
+                }
             }
         }
+
+        return std::min(count, limit);
     }
 
-    for (const auto& ci_ptr : candidate_cis) {
-        const auto& ci_props = ci_ptr->getProperties();
-        bool has_all = std::all_of(props.begin(), props.end(), [&](const std::string& prop) {
-            return ci_props.find(prop) != ci_props.end();
-        });
+    if (!by_fields) {
+        return std::min(current->getCICount(), limit);
+    }
 
-        if (has_all) {
-            result->push_back(ci_ptr);
+    if (filters.count("id") > 0) {
+        auto ci = current->getCI(filters.at("id"));
+        return ci && matches(ci) ? std::min<size_t>(1, limit) : 0;
+    }
+
+    for (size_t shard_index = 0; shard_index < current->getShardCount(); ++shard_index) {
+        for (const auto& [id, ci] : current->getShard(shard_index).getCIMap()) {
+            if (matches(ci) && ++count >= limit) {
+                return limit;
+            }
+        }
+    }
+
+    return count;
+}
+
+std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::vector<std::string>& props) const {
+    return getCIs(*snapshot(), props);
+}
+
+std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const Snapshot& snapshot, const std::vector<std::string>& props) {
+    auto result = std::make_shared<std::vector<CIPtr>>();
+
+    if (props.empty()) {
+        return result;
+    }
+
+    for (size_t shard_index = 0; shard_index < snapshot.getShardCount(); ++shard_index) {
+        const auto& shard = snapshot.getShard(shard_index);
+        const auto& property_map = shard.getPropertyMap();
+
+        std::vector<const Snapshot::IdSet*> sets;
+        sets.reserve(props.size());
+
+        for (const auto& prop : props) {
+            auto it = property_map.find(prop);
+            if (it == property_map.end()) {
+                break;
+            }
+
+            sets.push_back(&it->second);
+        }
+
+        if (sets.size() != props.size()) {
+            continue;
+        }
+
+        std::sort(sets.begin(), sets.end(), [](const Snapshot::IdSet* a, const Snapshot::IdSet* b) { return a->size() < b->size(); });
+
+        for (const auto& ci_id : *sets.front()) {
+            bool has_all = std::all_of(sets.begin() + 1, sets.end(), [&](const Snapshot::IdSet* ids) {
+                return ids->count(ci_id) > 0;
+            });
+
+            if (has_all) {
+                if (auto ci = shard.getCI(ci_id)) {
+                    result->push_back(ci);
+                }
+            }
         }
     }
 
@@ -291,10 +681,9 @@ std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::vector<std::st
 
 
 std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::string& id, size_t steps) const {
-    std::lock_guard<std::mutex> lock(cis_mutex_);
-    std::lock_guard<std::mutex> lock_dependencies(dependencies_mutex_);
+    auto current = snapshot();
 
-    auto start_ci = getCI(id);
+    auto start_ci = current->getCI(id);
     if (!start_ci || steps == 0) {
         return std::make_shared<std::vector<CIPtr>>();
     }
@@ -312,165 +701,138 @@ std::shared_ptr<std::vector<CMDB::CIPtr>> CMDB::getCIs(const std::string& id, si
         queue.pop();
 
         if (depth == steps) {
-            auto ci = getCI(current_id);
+            auto ci = current->getCI(current_id);
             if (ci) {
                 result->push_back(ci);
             }
             continue;
         }
 
-        auto range = relationships_.equal_range(current_id);
-        
-        for (auto it = range.first; it != range.second; ++it) {
-            const auto& next_id = it->second.getDestination();
+        current->forEachRelationshipFrom(current_id, [&, depth = depth](const RelationshipPtr& relationship) {
+            const auto& next_id = relationship->getDestination();
             if (!visited.count(next_id)) {
                 visited.insert(next_id);
                 queue.push({next_id, depth + 1});
             }
-        }
+        });
     }
 
     return result;
 }
 
 std::optional<std::string> CMDB::getLevelName(int index) {
-    if (index < 0 || index >= static_cast<int>(levels_.size())) {
+    auto current = snapshot();
+    const auto& levels = current->getLevels();
+
+    if (index < 0 || index >= static_cast<int>(levels.size())) {
         return std::nullopt;
     }
-    return levels_[index];
+    return levels[index];
 }
 
 std::optional<int> CMDB::getLevelIndex(const std::string& name) {
-    auto it = std::find(levels_.begin(), levels_.end(), name);
-    if (it != levels_.end()) {
-        return std::distance(levels_.begin(), it);
+    auto current = snapshot();
+    const auto& levels = current->getLevels();
+
+    auto it = std::find(levels.begin(), levels.end(), name);
+    if (it != levels.end()) {
+        return std::distance(levels.begin(), it);
     }
     return std::nullopt;
 }
 
 std::shared_ptr<std::vector<std::string>> CMDB::getLevels() const {
-    return std::make_shared<std::vector<std::string>>(levels_);
+    return std::make_shared<std::vector<std::string>>(snapshot()->getLevels());
 }
 
 
 bool CMDB::updateCI(const std::string& id, const std::unordered_map<std::string, std::string>& properties) {
-    auto ci = getCI(id);
-    if (!ci) return false;
-    
-    ci->setProperties(properties);
-    updatePropertiesMap(ci, ci->getProperties());
+    return mutate(
+        [&]() { return lockShards({snapshot()->shardIndex(id)}); },
+        [&](SnapshotBuilder& builder) {
+            auto ci = builder.view().getCI(id);
+            if (!ci) return false;
 
-    modified_ = true;
+            auto updated = std::make_shared<CI>(*ci);
+            updated->setProperties(properties);
 
-    return true;
+            builder.putCI(std::move(updated));
+
+            return true;
+        });
 }
 
 bool CMDB::updateCI(const std::string& id, const std::string& name, int level, const std::unordered_map<std::string, std::string>& properties) {
-    auto ci = getCI(id);
-    if (!ci) return false;
-    
-    ci->setName(name);
-    ci->setLevel(level);
-    ci->setProperties(properties);
-    updatePropertiesMap(ci, ci->getProperties());
+    return mutate(
+        [&]() { return lockShards({snapshot()->shardIndex(id)}); },
+        [&](SnapshotBuilder& builder) {
+            auto ci = builder.view().getCI(id);
+            if (!ci) return false;
 
-    modified_ = true;
+            auto updated = std::make_shared<CI>(*ci);
+            updated->setName(name);
+            updated->setLevel(level);
+            updated->setProperties(properties);
 
-    return true;
+            builder.putCI(std::move(updated));
+
+            return true;
+        });
 }
 
 bool CMDB::updateCI (cmdb::CMDB::CIPtr current_ci, const boost::json::object &ci, std::string &message) {
-    std::lock_guard<std::mutex> lock(cis_mutex_);
+    return mutate(
+        [&]() { return lockShards({snapshot()->shardIndex(current_ci->getId())}); },
+        [&](SnapshotBuilder& builder) {
+            auto latest = builder.view().getCI(current_ci->getId());
+            if (!latest) {
+                message = "Не найден ID.";
+                return false;
+            }
 
-    auto current_props = current_ci->getProperties();
+            auto updated = std::make_shared<CI>(*latest);
 
-    if (current_ci->setProperties(ci, message)) {
+            if (updated->setProperties(ci, message)) {
+                builder.putCI(std::move(updated));
 
-        auto new_props = current_ci->getProperties();
+                message = "обновлен";
 
-        for (const auto& [key, value] : current_props) {
-            if (new_props.find(key) == new_props.end()) {
-                deletePropertyFromMap(current_ci, key);
+                return true;
+            } else {
+                message = current_ci->getId() + " не обновлен";
+                return false;
             }
-        }
-
-        updatePropertiesMap(current_ci, new_props);
-
-        message = "обновлен";
-        modified_ = true;
-
-        return true;
-    } else {
-        message = current_ci->getId() + " не обновлен";
-        return false;
-    }
+        });
 }
 
 bool CMDB::setProperty(const std::string& id, const std::string& property_name, const std::string& property_value) {
-    auto ci = getCI(id);
-    if (!ci) return false;
-
-    ci->setProperty(property_name, property_value);
-    addPropertyToMap(ci, property_name, property_value);
-
-    modified_ = true;
-
-    return true;
-}
-
-
-void CMDB::updatePropertiesMap(CIPtr ci, const std::unordered_map<std::string, std::string>& properties) {
-    for (const auto& [property_name, property_value] : properties) {
-        CIList& ci_list = property_to_cis_[property_name];
-
-        if (std::find(ci_list.begin(), ci_list.end(), ci) == ci_list.end()) {
-            ci_list.push_back(ci);
-        }
-    }
-}
-
-void CMDB::deletePropertyFromMap(CIPtr ci, const std::string& property_name) {
-    auto it = property_to_cis_.find(property_name);
-    if (it != property_to_cis_.end()) {
-        CIList& ci_list = it->second;
-
-        ci_list.erase(std::remove(ci_list.begin(), ci_list.end(), ci), ci_list.end());
-
-        if (ci_list.empty()) {
-            property_to_cis_.erase(it);
-        }
-    }
-}
-
-void CMDB::deletePropertiesMap(CIPtr ci, const std::unordered_map<std::string, std::string>& properties) {
-    for (const auto& [property_name, property_value] : properties) {
-        deletePropertyFromMap(ci, property_name);
-    }
-}
-    
-void CMDB::addPropertyToMap(CIPtr ci, const std::string& property_name, const std::string& /*property_value*/) {
-    CIList& ci_list = property_to_cis_[property_name];
-
-    if (std::find(ci_list.begin(), ci_list.end(), ci) == ci_list.end()) {
-        ci_list.push_back(ci);
-    }
-}
-
-void CMDB::restorePropertiesMap() {
-    property_to_cis_.clear();
+    return mutate(
+        [&]() { return lockShards({snapshot()->shardIndex(id)}); },
+        [&](SnapshotBuilder& builder) {
+            auto ci = builder.view().getCI(id);
+            if (!ci) return false;
+
+            auto updated = std::make_shared<CI>(*ci);
+            if (updated->setProperty(property_name, property_value)) {
+                builder.putCI(std::move(updated));
+            }
 
-    for (const auto& ci : all_cis_) {
-        if (ci) {
-            updatePropertiesMap(ci, ci->getProperties());
-        }
-    }
+            return true;
+        });
 }
 
 boost::json::array CMDB::getProps() const {
+    auto current = snapshot();
     boost::json::array props_array;
 
-    for (const auto& [property_name, ci_list] : property_to_cis_) {
-        props_array.emplace_back(property_name);
+    std::unordered_set<std::string> seen;
+
+    for (size_t i = 0; i < current->getShardCount(); ++i) {
+        for (const auto& [property_name, ci_ids] : current->getShard(i).getPropertyMap()) {
+            if (seen.insert(property_name).second) {
+                props_array.emplace_back(property_name);
+            }
+        }
     }
 
     return props_array;
@@ -483,95 +845,96 @@ boost::json::array CMDB::getProps() const {
 */
 
 bool CMDB::addRelationship(const std::string& from_id, const std::string& to_id, const std::string& type) {
-    auto from_ci = getCI(from_id);
-    auto to_ci = getCI(to_id);
-
-    if (!from_ci || !to_ci) {
-        return false;
-    }
-
-    Relationship relationship(from_id, to_id, type);
-    relationships_.emplace(from_ci->getId(), relationship);
+    return mutate(
+        [&]() { return lockEndpoints(from_id, to_id); },
+        [&](SnapshotBuilder& builder) {
+            if (!builder.view().getCI(from_id) || !builder.view().getCI(to_id)) {
+                return false;
+            }
 
-    reverse_index_[to_id].insert(from_id);
-    modified_ = true;
+            builder.addRelationship(std::make_shared<Relationship>(from_id, to_id, type));
 
-    return true;
+            return true;
+        });
 }
 
-bool CMDB::removeRelationship(const std::string& from_id, const std::string& to_id) {
-    auto range = relationships_.equal_range(from_id);
-
-    for (auto it = range.first; it != range.second; ++it) {
-        if (it->second.getDestination() == to_id) {
-            relationships_.erase(it);
-            reverse_index_[to_id].erase(from_id);
+CMDB::BulkResult CMDB::addRelationships(const std::vector<RelationshipData>& relationships) {
+    return mutate(
+        [&]() {
+            auto current = snapshot();
+            std::vector<size_t> indexes;
+            indexes.reserve(relationships.size() * 2);
 
-            if (reverse_index_[to_id].empty()) {
-                reverse_index_.erase(to_id);
+            for (const auto& rel : relationships) {
+                indexes.push_back(current->shardIndex(rel.from_id));
+                indexes.push_back(current->shardIndex(rel.to_id));
             }
 
-            modified_ = true;
-            return true;
-        }
-    }
+            return lockShards(std::move(indexes));
+        },
+        [&](SnapshotBuilder& builder) {
+            BulkResult result;
+            result.succeeded.assign(relationships.size(), false);
+            result.messages.assign(relationships.size(), "НЕ добавлено");
 
-    return false;
-}
+            const auto& view = builder.view();
+            std::vector<size_t> accepted;
+            accepted.reserve(relationships.size());
 
-bool CMDB::removeRelationship(const std::string& from_id, const std::string& to_id, const std::string& type) {
-    auto range = relationships_.equal_range(from_id);
+            for (size_t i = 0; i < relationships.size(); ++i) {
+                if (view.getCI(relationships[i].from_id) && view.getCI(relationships[i].to_id)) {
+                    accepted.push_back(i);
+                }
+            }
 
-    for (auto it = range.first; it != range.second; ++it) {
-        if (it->second.getDestination() == to_id && it->second.getType() == type) {
-            relationships_.erase(it);
-            reverse_index_[to_id].erase(from_id);
+            for (size_t i : accepted) {
+                const auto& rel = relationships[i];
 
-            if (reverse_index_[to_id].empty()) {
-                reverse_index_.erase(to_id);
+                builder.addRelationship(std::make_shared<Relationship>(rel.from_id, rel.to_id, rel.type));
+                result.messages[i] = "добавлено";
+                result.succeeded[i] = true;
             }
 
-            modified_ = true;
-            return true;
-        }
-    }
+            result.added = accepted.size();
 
-    return false;
+            return result;
+        });
 }
 
-void CMDB::removeRelationshipsForId(const std::string& id) {
-    for (auto it = relationships_.begin(); it != relationships_.end(); ) {
-        if (it->first == id || it->second.getDestination() == id) {
-            it = relationships_.erase(it);
-            modified_ = true;
-        } else {
-            ++it;
-        }
-    }
+bool CMDB::removeRelationship(const std::string& from_id, const std::string& to_id) {
+    return mutate(
+        [&]() { return lockEndpoints(from_id, to_id); },
+        [&](SnapshotBuilder& builder) {
+            return builder.removeRelationship(from_id, to_id, std::nullopt);
+        });
+}
 
-    for (auto reverse_it = reverse_index_.begin(); reverse_it != reverse_index_.end(); ) {
-        reverse_it->second.erase(id);
-        if (reverse_it->second.empty()) {
-            reverse_it = reverse_index_.erase(reverse_it);
-            modified_ = true;
-        } else {
-            ++reverse_it;
-        }
-    }
+bool CMDB::removeRelationship(const std::string& from_id, const std::string& to_id, const std::string& type) {
+    return mutate(
+        [&]() { return lockEndpoints(from_id, to_id); },
+        [&](SnapshotBuilder& builder) {
+            return builder.removeRelationship(from_id, to_id, type);
+        });
+}
+
+void CMDB::removeRelationshipsForId(const std::string& id) {
+    mutate(
+        [&]() { return lockRelatedShards(id); },
+        [&](SnapshotBuilder& builder) {
+            return builder.removeRelationshipsForId(id);
+        });
 }
 
 template <typename Predicate>
 std::shared_ptr<std::vector<CMDB::RelationshipPtr>> CMDB::getRelationshipsImpl(Predicate pred) const {
-    std::lock_guard<std::mutex> lock(dependencies_mutex_);
-
+    auto current = snapshot();
     auto result = std::make_shared<std::vector<RelationshipPtr>>();
 
-    for (const auto& relationship_pair : relationships_) {
-        auto relationship_ptr = std::make_shared<Relationship>(relationship_pair.second);
-        if (pred(relationship_ptr)) {
-            result->push_back(relationship_ptr);
+    current->forEachRelationship([&](const RelationshipPtr& relationship) {
+        if (pred(relationship)) {
+            result->push_back(relationship);
         }
-    }
+    });
 
     return result->empty() ? nullptr : result;
 }
@@ -618,21 +981,127 @@ std::shared_ptr<std::vector<CMDB::RelationshipPtr>> CMDB::getRelationships(const
             type = filters.at("type");
         }
 
-        auto allrelationships = getRelationships();
+        auto current = snapshot();
 
-        if (allrelationships) {
-            for (const auto& rel : *allrelationships) {
-                if ((source.empty() || rel->getSource() == source) &&
-                    (destination.empty() || rel->getDestination() == destination) &&
-                    (type.empty() || rel->getType() == type)) {
-                    result->push_back(rel);
-                }
+        auto matches = [&](const RelationshipPtr& rel) {
+            return (source.empty() || rel->getSource() == source) &&
+                (destination.empty() || rel->getDestination() == destination) &&
+                (type.empty() || rel->getType() == type);
+        };
+
+        auto collect = [&](const RelationshipPtr& rel) {
+            if (matches(rel)) {
+                result->push_back(rel);
             }
+        };
+
+        if (!source.empty()) {
+            current->forEachRelationshipFrom(source, collect);
+        } else {
+            current->forEachRelationship(collect);
         }
     }
 
     return result;
 }
+
+std::shared_ptr<std::vector<CMDB::RelationshipPtr>> CMDB::getRelationships(const std::map<std::string, std::string>& filters,
+                                                                           const std::optional<RelationshipKey>& after,
+                                                                           size_t limit, bool& more) const {
+    auto result = std::make_shared<std::vector<RelationshipPtr>>();
+    auto current = snapshot();
+    more = false;
+
+    std::string source = filters.count("source") > 0 ? filters.at("source") : std::string();
+    std::string destination = filters.count("destination") > 0 ? filters.at("destination") : std::string();
+    std::string type = filters.count("type") > 0 ? filters.at("type") : std::string();
+
+    auto accept = [&](const RelationshipPtr& rel) {
+        if ((!destination.empty() && rel->getDestination() != destination) || (!type.empty() && rel->getType() != type)) {
+            return true;
+        }
+
+        // Связи с тем же ключом, что и последняя на странице, остаются на этой странице.
+        if (result->size() >= limit && RelationshipOrderLess{}(result->back(), rel)) {
+            more = true;
+            return false;
+        }
+
+        result->push_back(rel);
+        return true;
+    };
+
+    if (source.empty()) {
+        current->forEachRelationshipAfter(after, accept);
+        return result;
+    }
+
+    // Связи одного источника лежат подряд в упорядоченном индексе сегмента-владельца.
+    const auto& order = current->getShard(current->shardIndex(source)).getRelationshipOrder();
+    RelationshipKey first{source, "", ""};
+    auto it = after && !RelationshipOrderLess{}(*after, first) ? order.upper_bound(*after) : order.lower_bound(first);
+
+    for (; it != order.end() && (*it)->getSource() == source; ++it) {
+        if (!accept(*it)) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+size_t CMDB::countRelationships(const std::map<std::string, std::string>& filters, size_t limit) const {
+    auto current = snapshot();
+
+    std::string source = filters.count("source") > 0 ? filters.at("source") : std::string();
+    std::string destination = filters.count("destination") > 0 ? filters.at("destination") : std::string();
+    std::string type = filters.count("type") > 0 ? filters.at("type") : std::string();
+
+    if (source.empty() && destination.empty() && type.empty()) {
+        return std::min(current->getRelationshipCount(), limit);
+    }
+
+    size_t count = 0;
+
+    // Подсчет связей источника с проверкой цели и типа; false - достигнут limit
+    auto countFrom = [&](const std::string& from_id) {
+        const auto& order = current->getShard(current->shardIndex(from_id)).getRelationshipOrder();
+        auto last = order.upper_bound(RelationshipSource{from_id});
+
+        for (auto it = order.lower_bound(RelationshipSource{from_id}); it != last; ++it) {
+            const auto& rel = *it;
+            if ((destination.empty() || rel->getDestination() == destination) &&
+                (type.empty() || rel->getType() == type) && ++count >= limit) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    if (!source.empty()) {
+        countFrom(source);
+    } else if (!destination.empty()) {
+        if (const auto* sources = current->getDependents(destination)) {
+            for (const auto& from_id : *sources) {
+                if (!countFrom(from_id)) {
+                    break;
+                }
+            }
+        }
+    } else {
+        for (size_t shard_index = 0; shard_index < current->getShardCount() && count < limit; ++shard_index) {
+            for (const auto& rel : current->getShard(shard_index).getRelationshipOrder()) {
+                if (rel->getType() == type && ++count >= limit) {
+                    break;
+                }
+            }
+        }
+    }
+
+    return std::min(count, limit);
+}
+
 std::shared_ptr<std::vector<CMDB::RelationshipPtr>> CMDB::getRelationships(const std::string& from_id,
     const std::string& to_id, const std::string& type) const {
     return getRelationshipsImpl([from_id, to_id, type](const RelationshipPtr& relationship) {
@@ -645,17 +1114,16 @@ std::shared_ptr<std::vector<CMDB::RelationshipPtr>> CMDB::getRelationships(const
 }
 
 std::shared_ptr<std::vector<CMDB::RelationshipPtr>> CMDB::getDependentCIs(const std::string& id) const {
+    auto current = snapshot();
     auto dependent_cis = std::make_shared<std::vector<CMDB::RelationshipPtr>>();
-    auto it = reverse_index_.find(id);
 
-    if (it != reverse_index_.end()) {
-        for (const auto& dep_id : it->second) {
-            auto rel_it = relationships_.find(dep_id);
-
-            while (rel_it != relationships_.end() && rel_it->first == dep_id) {
-                dependent_cis->push_back(std::make_shared<Relationship>(rel_it->second));
-                ++rel_it;
-            }
+    if (auto sources = current->getDependents(id)) {
+        for (const auto& dep_id : *sources) {
+            current->forEachRelationshipFrom(dep_id, [&](const RelationshipPtr& relationship) {
+                if (relationship->getDestination() == id) {
+                    dependent_cis->push_back(relationship);
+                }
+            });
         }
     }
 
@@ -663,6 +1131,131 @@ std::shared_ptr<std::vector<CMDB::RelationshipPtr>> CMDB::getDependentCIs(const
 }
 // END: Методы для работы со связями 
 
+/*
+*   BEGIN: Транзакции
+*/
+
+TxResult CMDB::applyTransaction(const std::vector<TxOperation>& operations) {
+    return mutate(
+        [&]() { return lockAll(); },
+        [&](SnapshotBuilder& builder) { return applyOperations(builder, operations); });
+}
+
+void CMDB::applyTransaction(std::vector<TxOperation> operations, TxCallback callback) {
+    mutate(
+        [this]() { return lockAll(); },
+        [operations = std::move(operations)](SnapshotBuilder& builder) { return applyOperations(builder, operations); },
+        std::move(callback));
+}
+
+TxResult CMDB::applyOperations(SnapshotBuilder& builder, const std::vector<TxOperation>& operations) {
+    TxResult result;
+    result.messages.reserve(operations.size());
+
+    SnapshotBuilder tx(builder.build(builder.view().getGeneration()));
+
+    for (size_t i = 0; i < operations.size(); ++i) {
+        std::string message;
+        bool applied = applyOperation(tx, operations[i], message);
+
+        result.messages.push_back(std::move(message));
+
+        if (!applied) {
+            result.failed_index = i;
+            return result;
+        }
+    }
+
+    builder.merge(std::move(tx));
+    result.committed = true;
+
+    return result;
+}
+
+bool CMDB::applyOperation(SnapshotBuilder& builder, const TxOperation& operation, std::string& message) {
+    const auto& view = builder.view();
+
+    switch (operation.type) {
+    case TxOperation::Type::AddCI:
+        if (operation.level < 0 || operation.level >= static_cast<int>(view.getLevels().size())) {
+            message = "Уровень " + std::to_string(operation.level) + " не существует.";
+            return false;
+        }
+
+        if (view.getCI(operation.id)) {
+            message = "КЕ с таким id " + operation.id + " уже существует.";
+            return false;
+        }
+
+        builder.putCI(std::make_shared<CI>(operation.id, operation.name, operation.ci_type, operation.level, operation.properties));
+        message = operation.id + " добавлен";
+
+        return true;
+
+    case TxOperation::Type::UpdateCI: {
+        auto ci = view.getCI(operation.id);
+        if (!ci) {
+            message = "Не найден ID " + operation.id + ".";
+            return false;
+        }
+
+        auto updated = std::make_shared<CI>(*ci);
+        if (!updated->setProperties(operation.update, message)) {
+            if (!message.empty()) {
+                return false;
+            }
+
+            // Изменений нет: повторная синхронизация того же состояния не отменяет транзакцию.
+            message = operation.id + " не изменен";
+            return true;
+        }
+
+        builder.putCI(std::move(updated));
+        message = operation.id + " обновлен";
+
+        return true;
+    }
+
+    case TxOperation::Type::RemoveCI:
+        if (!builder.eraseCI(operation.id)) {
+            message = "Не найден ID " + operation.id + ".";
+            return false;
+        }
+
+        builder.removeRelationshipsForId(operation.id);
+        message = operation.id + " удален";
+
+        return true;
+
+    case TxOperation::Type::AddRelationship:
+        if (!view.getCI(operation.id) || !view.getCI(operation.to_id)) {
+            message = "КЕ связи " + operation.id + " -> " + operation.to_id + " не найдены.";
+            return false;
+        }
+
+        builder.addRelationship(std::make_shared<Relationship>(operation.id, operation.to_id, operation.relationship_type.value_or("")));
+        message = "добавлено";
+
+        return true;
+
+    case TxOperation::Type::RemoveRelationship:
+        if (!builder.removeRelationship(operation.id, operation.to_id, operation.relationship_type)) {
+            message = "Связь " + operation.id + " -> " + operation.to_id + " не найдена.";
+            return false;
+        }
+
+        message = "удалено";
+
+        return true;
+    }
+
+    message = "Неизвестная операция.";
+    return false;
+}
+
+// END: Транзакции
+
+
 
 /*
 *   BEGIN: Методы для сохранения в файл
@@ -672,15 +1265,16 @@ void CMDB::markAsModified() {
     modified_ = true;
 }
 
-bool CMDB::saveCollection(std::ofstream& out, const CIList& collection) {
-    size_t size = collection.size();
+bool CMDB::saveCIs(std::ofstream& out, const Snapshot& snapshot) {
+    size_t size = snapshot.getCICount();
     out.write(reinterpret_cast<const char*>(&size), sizeof(size));
 
-    for (const auto& item : collection) {
-        if (!item->save(out)) return false; 
-    }
+    bool ok = true;
+    snapshot.forEachCI([&](const CIPtr& item) {
+        ok = ok && item->save(out);
+    });
 
-    return out.good();
+    return ok && out.good();
 }
 
 bool CMDB::saveCollection(std::ofstream& out, const std::vector<std::string>& collection) {
@@ -700,26 +1294,24 @@ bool CMDB::saveCollection(std::ofstream& out, const std::vector<std::string>& co
     return out.good();
 }
 
-bool CMDB::saveCollection(std::ofstream& out, const RelationshipMap& collection) {
-    size_t size = collection.size();
+bool CMDB::saveRelationships(std::ofstream& out, const Snapshot& snapshot) {
+    size_t size = snapshot.getRelationshipCount();
     out.write(reinterpret_cast<const char*>(&size), sizeof(size));
     if (!out.good()) return false;
 
-    for (const auto& pair : collection) {
-        size_t key_size = pair.first.size();
-        out.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+    bool ok = true;
+    snapshot.forEachRelationship([&](const RelationshipPtr& relationship) {
+        if (!ok) return;
 
-        if (!out.good()) return false;
-
-        out.write(pair.first.data(), key_size);
-        if (!out.good()) return false;
+        const auto& key = relationship->getSource();
+        size_t key_size = key.size();
+        out.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+        out.write(key.data(), key_size);
 
-        if (!pair.second.save(out)) {
-            return false;
-        }
-    }
+        ok = out.good() && relationship->save(out);
+    });
 
-    return out.good();
+    return ok && out.good();
 }
 
 bool CMDB::saveToFile() {
@@ -729,11 +1321,15 @@ bool CMDB::saveToFile() {
 bool CMDB::saveToFile(const std::string& filename) {
     std::string temp_filename = filename + ".tmp";
 
-    std::lock_guard<std::mutex> lock(cis_mutex_);
+    std::lock_guard<std::mutex> lock(save_mutex_);
+
+    modified_ = false;
+    auto current = snapshot();
 
     if (std::ifstream(filename)) {
         if (std::rename(filename.c_str(), temp_filename.c_str()) != 0) {
             std::cerr << "Ошибка: не удалось переименовать " << filename << " в " << temp_filename << "!\n";
+            modified_ = true;
             return false;
         }
     }
@@ -742,20 +1338,22 @@ bool CMDB::saveToFile(const std::string& filename) {
     if (!out) {
         std::cerr << "Ошибка: не удалось открыть файл " << filename << " для записи!\n";
         std::rename(temp_filename.c_str(), filename.c_str());
-        
+        modified_ = true;
+
         return false;
     }
 
     if (
-        !saveCollection(out, levels_) ||
-        !saveCollection(out, all_cis_) ||
-        !saveCollection(out, relationships_)
+        !saveCollection(out, current->getLevels()) ||
+        !saveCIs(out, *current) ||
+        !saveRelationships(out, *current)
         ) {
         std::cerr << "Ошибка: не удалось сохранить данные в " << filename << "!\n";
         out.close();
 
         std::remove(filename.c_str());
         std::rename(temp_filename.c_str(), filename.c_str());
+        modified_ = true;
 
         return false;
     }
@@ -766,8 +1364,6 @@ bool CMDB::saveToFile(const std::string& filename) {
 
     std::cout << "CMDB успешно сохранена в " << filename << "\n";
 
-    modified_ = false;
-
     return true;
 }
 
@@ -781,15 +1377,17 @@ bool CMDB::loadCollection(std::ifstream& in, CIList& collection) {
     }
 
     std::cout << "Expected collection size: " << size << "\n";
-    collection.resize(size);
+    collection.clear();
 
     for (size_t i = 0; i < size; ++i) {
-        collection[i] = std::make_shared<CI>();
+        auto ci = std::make_shared<CI>();
 
-        if (!collection[i]->load(in)) {
+        if (!ci->load(in)) {
             std::cerr << "Error loading item " << i << " from file.\n";
             return false;
         }
+
+        collection.push_back(std::move(ci));
     }
 
     std::cout << "Successfully loaded collection with " << size << " items.\n";
@@ -837,8 +1435,8 @@ bool CMDB::loadCollection(std::ifstream& in, RelationshipMap& collection) {
         in.read(&key[0], key_size);
         if (!in.good()) return false;
 
-        Relationship relationship;
-        if (!relationship.load(in)) return false;
+        auto relationship = std::make_shared<Relationship>();
+        if (!relationship->load(in)) return false;
 
         collection.emplace(std::move(key), std::move(relationship));
     }
@@ -846,59 +1444,53 @@ bool CMDB::loadCollection(std::ifstream& in, RelationshipMap& collection) {
     return in.good();
 }
 
-void CMDB::restoreIDtoCI() {
-    id_to_ci_.clear();
-
-    for (const auto& ci : all_cis_) {
-        if (ci) {
-            id_to_ci_[ci->getId()] = ci;
-        }
-    }
-}
-
-void CMDB::restoreReverseIndex() {
-    reverse_index_.clear();
-
-    for (const auto& [from_id, relationship] : relationships_) {
-        const std::string& to_id = relationship.getDestination();
-        reverse_index_[to_id].insert(from_id);
-    }
-}
-
 bool CMDB::loadFromFile() {
     return loadFromFile(filename_);
 }
 
 bool CMDB::loadFromFile(const std::string& filename) {
-    {
-        std::lock_guard<std::mutex> lock(cis_mutex_);
+    std::vector<std::string> levels;
+    CIList cis;
+    RelationshipMap relationships;
 
+    {
         std::ifstream in(filename, std::ios::binary);
         if (!in) {
             std::cerr << "Ошибка: не удалось открыть файл " << filename << " для чтения!\n";
             return false;
         }
 
-        if (!loadCollection(in, levels_)) {
+        if (!loadCollection(in, levels)) {
             std::cerr << "Ошибка: не удалось загрузить уровни из " << filename << "!\n";
             return false;
         }
 
-        if (!loadCollection(in, all_cis_)) {
+        if (!loadCollection(in, cis)) {
             std::cerr << "Ошибка: не удалось загрузить CIs из " << filename << "!\n";
             return false;
         }
 
-        if (!loadCollection(in, relationships_)) {
+        if (!loadCollection(in, relationships)) {
             std::cerr << "Ошибка: не удалось загрузить связи из " << filename << "!\n";
             return false;
         }
+    }
+
+    {
+        auto locks = lockAll();
+        SnapshotBuilder builder(std::make_shared<Snapshot>(getShardCount()));
 
-        restoreIDtoCI();
+        builder.levels() = std::move(levels);
 
-        restorePropertiesMap();
+        for (auto& ci : cis) {
+            builder.putCI(std::move(ci));
+        }
+
+        for (auto& [from_id, relationship] : relationships) {
+            builder.addRelationship(std::move(relationship));
+        }
 
-        restoreReverseIndex();
+        std::atomic_store(&snapshot_, builder.build(snapshot()->getGeneration() + 1));
     }
 
     std::cout << "CMDB загружена из " << filename << "\n";
@@ -923,7 +1515,6 @@ void CMDB::autoSaveLoop() {
 
         if (modified_ && !saving_.exchange(true)) {
             saveToFile();
-            modified_ = false;
             saving_ = false;
         }
     }
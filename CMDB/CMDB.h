@@ -16,8 +16,13 @@
 #include <fstream>
 #include <filesystem>
 #include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <queue>
 #include <thread>
@@ -27,6 +32,9 @@
 #include <vector>
 #include "CI.h"
 #include "Relationship.h"
+#include "Snapshot.h"
+#include "Transaction.h"
+#include "WritePipeline.h"
 
 namespace cmdb {
 
@@ -36,13 +44,20 @@ namespace cmdb {
  *
  * Этот класс предоставляет интерфейс для управления конфигурационными единицами (CI) и их связями,
  * включая добавление, удаление, обновление, поиск и сохранение данных.
+ *
+ * Состояние хранится в виде неизменяемых снимков (Snapshot). Методы чтения работают с текущим
+ * снимком без блокировок. КЕ и связи разбиты на сегменты по хешу идентификатора: писатель блокирует
+ * только сегменты, которые затрагивает операция (для связи - сегменты обеих КЕ), и публикует новую
+ * версию атомарной заменой, перенося свои сегменты в самый свежий снимок.
  */
 class CMDB {
 public:
     /**
      * @brief Тип указателя на конфигурационную единицу.
+     *
+     * Опубликованные КЕ неизменяемы: модификация создает новую версию КЕ.
      */
-    using CIPtr = std::shared_ptr<CI>;
+    using CIPtr = Snapshot::CIPtr;
 
     /**
      * @brief Тип списка конфигурационных единиц.
@@ -52,35 +67,70 @@ public:
     /**
      * @brief Тип карты идентификаторов конфигурационных единиц к указателям.
      */
-    using CIMap = std::unordered_map<std::string, CIPtr>;
+    using CIMap = Snapshot::CIMap;
 
     /**
-     * @brief Тип карты свойств конфигурационных единиц к списку указателей на КЕ, которые данные свойства содержат.
+     * @brief Тип карты свойств конфигурационных единиц к идентификаторам КЕ, которые данные свойства содержат.
      */
-    using CIPropertyMap = std::unordered_map<std::string, CIList>;
+    using CIPropertyMap = Snapshot::CIPropertyMap;
 
     /**
      * @brief Тип карты связей между конфигурационными единицами.
      */
-    using RelationshipMap = std::unordered_multimap<std::string, Relationship>;
+    using RelationshipMap = std::unordered_multimap<std::string, Snapshot::RelationshipPtr>;
 
     /**
      * @brief Тип обратного индекса для поиска зависимых CI.
      */
-    using ReverseIndex = std::unordered_map<std::string, std::unordered_set<std::string>>;
+    using ReverseIndex = Snapshot::ReverseIndex;
 
     /**
      * @brief Тип указателя на связь между конфигурационными единицами.
      */
-    using RelationshipPtr = std::shared_ptr<Relationship>;
+    using RelationshipPtr = Snapshot::RelationshipPtr;
+
+    /**
+     * @brief Данные добавляемой конфигурационной единицы.
+     */
+    struct CIData {
+        std::string id; ///< Идентификатор.
+        std::string name; ///< Имя.
+        std::string type; ///< Тип.
+        int level = 0; ///< Уровень.
+        std::unordered_map<std::string, std::string> properties; ///< Свойства.
+    };
+
+    /**
+     * @brief Данные добавляемой связи.
+     */
+    struct RelationshipData {
+        std::string from_id; ///< Идентификатор исходной КЕ.
+        std::string to_id; ///< Идентификатор целевой КЕ.
+        std::string type; ///< Тип связи.
+    };
+
+    /**
+     * @brief Результат пакетного добавления.
+     */
+    struct BulkResult {
+        size_t added = 0; ///< Количество добавленных элементов.
+        std::vector<bool> succeeded; ///< Признак добавления по каждому элементу.
+        std::vector<std::string> messages; ///< Сообщение по каждому элементу.
+    };
+
+    /**
+     * @brief Количество сегментов по умолчанию.
+     */
+    static constexpr size_t DEFAULT_SHARD_COUNT = 16;
 
     /**
      * @brief Получить экземпляр CMDB (синглтон).
      *
      * @param filename Имя файла для сохранения и загрузки данных.
+     * @param shard_count Количество сегментов (учитывается только при первом вызове).
      * @return Ссылка на экземпляр CMDB.
      */
-    static CMDB& getInstance(const std::string& filename);
+    static CMDB& getInstance(const std::string& filename, size_t shard_count = DEFAULT_SHARD_COUNT);
 
     /**
      * @brief Запрещены копирование и перемещение.
@@ -94,7 +144,48 @@ public:
      * @brief Деструктор класса CMDB.
      */
     ~CMDB();
-    
+
+    /**
+     * @brief Получить текущий неизменяемый снимок состояния.
+     *
+     * Снимок не блокирует писателей и остается корректным, пока на него есть ссылки.
+     *
+     * @return Указатель на снимок.
+     */
+    std::shared_ptr<const Snapshot> snapshot() const;
+
+    /**
+     * @brief Получить номер поколения текущего снимка.
+     */
+    uint64_t getGeneration() const;
+
+    /**
+     * @brief Получить количество сегментов.
+     */
+    size_t getShardCount() const;
+
+    /**
+     * @brief Направлять все модификации через единственный поток-писатель.
+     *
+     * Модификации из любых потоков ставятся в lock-free очередь и применяются пачками: одна
+     * критическая секция, один построитель и одна публикация снимка на пачку. Вызывающий поток
+     * ожидает результат своей модификации. Включать и выключать конвейер следует до начала
+     * (или после окончания) параллельной работы с CMDB.
+     *
+     * @param max_batch Максимальное количество модификаций в пачке.
+     */
+    void enableWritePipeline(size_t max_batch = WritePipeline::DEFAULT_MAX_BATCH);
+
+    /**
+     * @brief Отключить конвейер модификаций, дождавшись применения поставленных модификаций.
+     */
+    void disableWritePipeline();
+
+    /**
+     * @brief Включен ли конвейер модификаций.
+     */
+    bool isWritePipelineEnabled() const;
+
     /**
      * @brief Добавить уровень конфигурационных единиц.
      *
@@ -163,6 +254,8 @@ public:
     /**
      * @brief Добавить конфигурационную единицу.
      *
+     * КЕ не добавляется, если уровень не существует или КЕ с таким идентификатором уже есть.
+     *
      * @param id Идентификатор конфигурационной единицы.
      * @param name Имя конфигурационной единицы.
      * @param type Тип конфигурационной единицы.
@@ -172,6 +265,18 @@ public:
      */
     bool addCI(const std::string& id, const std::string& name, const std::string& type, int level, const std::unordered_map<std::string, std::string>& properties = {});
 
+    /**
+     * @brief Добавить пачку конфигурационных единиц за одну модификацию.
+     *
+     * Пачка сначала целиком проверяется (уровень, существующие и повторяющиеся идентификаторы),
+     * затем прошедшие проверку КЕ вставляются за один проход и публикуются одним снимком.
+     * Блокируются только сегменты, в которые попадают КЕ пачки. Некорректные элементы не мешают добавлению остальных.
+     *
+     * @param cis Добавляемые КЕ.
+     * @return Результат по каждому элементу (в порядке входа).
+     */
+    BulkResult addCIs(std::vector<CIData> cis);
+
     /**
      * @brief Удалить конфигурационную единицу по идентификатору.
      *
@@ -228,6 +333,35 @@ public:
      */
     std::shared_ptr<std::vector<CMDB::CIPtr>> getCIs(const std::map<std::string, std::string>& filters) const;
 
+    /**
+     * @brief Получить страницу конфигурационных единиц по фильтрам в порядке идентификаторов.
+     *
+     * Обход продолжается сразу после after по упорядоченному индексу, поэтому КЕ предыдущих страниц
+     * не просматриваются, а КЕ, добавленные или удаленные между запросами страниц, не сдвигают
+     * остальные результаты (keyset pagination).
+     *
+     * @param filters Фильтры (поле - значение), как у getCIs(filters).
+     * @param after Идентификатор последней КЕ предыдущей страницы (nullopt - первая страница).
+     * @param limit Максимум КЕ на странице.
+     * @param more Выход: после страницы есть еще подходящие КЕ.
+     * @return Указатель на вектор указателей на конфигурационные единицы.
+     */
+    std::shared_ptr<std::vector<CIPtr>> getCIs(const std::map<std::string, std::string>& filters,
+                                               const std::optional<std::string>& after, size_t limit, bool& more) const;
+
+    /**
+     * @brief Подсчитать конфигурационные единицы, подходящие под фильтры, без построения результата.
+     *
+     * Без фильтров и при отборе только по has_props число берется из размеров индексов; в остальных
+     * случаях КЕ просматриваются без копирования указателей, и просмотр прекращается на limit.
+     *
+     * @param filters Фильтры (поле - значение), как у getCIs(filters).
+     * @param limit Достаточное число КЕ (1 - проверка существования).
+     * @return Число подходящих КЕ, не больше limit.
+     */
+    size_t countCIs(const std::map<std::string, std::string>& filters,
+                    size_t limit = std::numeric_limits<size_t>::max()) const;
+
     /**
      * @brief Получить список конфигурационных единиц, связанных с указанной CI на заданное количество шагов.
      *
@@ -294,6 +428,14 @@ public:
      */
     bool addRelationship(const std::string& from_id, const std::string& to_id, const std::string& type);
 
+    /**
+     * @brief Добавить пачку связей за одну модификацию.
+     *
+     * @param relationships Добавляемые связи.
+     * @return Результат по каждому элементу (в порядке входа).
+     */
+    BulkResult addRelationships(const std::vector<RelationshipData>& relationships);
+
     /**
      * @brief Удалить связь между конфигурационными единицами.
      *
@@ -361,6 +503,36 @@ public:
      * @return Указатель на вектор указателей на связи.
      */
     std::shared_ptr<std::vector<CMDB::RelationshipPtr>> getRelationships(const std::map<std::string, std::string>& filters) const;
+
+    /**
+     * @brief Получить страницу связей по фильтрам в порядке (источник, цель, тип).
+     *
+     * Связи с одинаковым ключом не разделяются между страницами, поэтому страница может
+     * превышать limit на число таких повторов.
+     *
+     * @param filters Параметры запроса, как у getRelationships(filters).
+     * @param after Ключ последней связи предыдущей страницы (nullopt - первая страница).
+     * @param limit Максимум связей на странице.
+     * @param more Выход: после страницы есть еще подходящие связи.
+     * @return Указатель на вектор указателей на связи.
+     */
+    std::shared_ptr<std::vector<RelationshipPtr>> getRelationships(const std::map<std::string, std::string>& filters,
+                                                                   const std::optional<RelationshipKey>& after,
+                                                                   size_t limit, bool& more) const;
+
+    /**
+     * @brief Подсчитать связи, подходящие под фильтры, без построения результата.
+     *
+     * Без фильтров число берется из снимка, по одному источнику - из индекса связей источника,
+     * по цели - из обратного индекса; просмотр прекращается на limit.
+     *
+     * @param filters Параметры запроса, как у getRelationships(filters).
+     * @param limit Достаточное число связей (1 - проверка существования).
+     * @return Число подходящих связей, не больше limit.
+     */
+    size_t countRelationships(const std::map<std::string, std::string>& filters,
+                              size_t limit = std::numeric_limits<size_t>::max()) const;
+
     /**
      * @brief Получить список зависимых конфигурационных единиц от указанной CI.
      *
@@ -369,6 +541,36 @@ public:
      */
     std::shared_ptr<std::vector<CMDB::RelationshipPtr>> getDependentCIs(const std::string& id) const;
 
+    /**
+     * @brief Атомарно применить набор операций над КЕ и связями.
+     *
+     * Операции применяются по порядку (каждая видит результат предыдущих) под блокировками
+     * уровней и всех сегментов либо в одной пачке конвейера модификаций. Если какая-либо операция
+     * не проходит проверку, не применяется ни одна; иначе публикуется один снимок.
+     *
+     * @param operations Операции транзакции.
+     * @return Результат транзакции.
+     */
+    TxResult applyTransaction(const std::vector<TxOperation>& operations);
+
+    /**
+     * @brief Функция получения результата асинхронной транзакции: ошибка (или nullptr) и результат.
+     */
+    using TxCallback = std::function<void(std::exception_ptr, TxResult)>;
+
+    /**
+     * @brief Атомарно применить набор операций, не ожидая фиксации в вызывающем потоке.
+     *
+     * С конвейером модификаций транзакция ставится в очередь потока-писателя, а `callback`
+     * вызывается этим потоком после публикации пачки (групповая фиксация без блокировки
+     * вызывающего потока). Без конвейера транзакция применяется сразу и `callback` вызывается
+     * до возврата из метода.
+     *
+     * @param operations Операции транзакции.
+     * @param callback Получатель результата.
+     */
+    void applyTransaction(std::vector<TxOperation> operations, TxCallback callback);
+
     /**
      * @brief Преобразовать вектор объектов в JSON-объект.
      *
@@ -427,15 +629,12 @@ public:
 
 private:
     std::string filename_; ///< Имя файла для сохранения и загрузки данных.
-    CIList all_cis_; ///< Список всех конфигурационных единиц.
-    CIMap id_to_ci_; ///< Карта идентификаторов конфигурационных единиц к указателям.
-    CIPropertyMap property_to_cis_; ///< Карта свойств конфигурационных единиц к списку указателей на КЕ.
-    std::vector<std::string> levels_; ///< Список уровней конфигурационных единиц.
-    RelationshipMap relationships_; ///< Карта связей между конфигурационными единицами.
-    ReverseIndex reverse_index_; ///< Обратный индекс для поиска зависимых CI.
+    std::shared_ptr<const Snapshot> snapshot_; ///< Текущая опубликованная версия состояния.
 
-    mutable std::mutex cis_mutex_; ///< Мьютекс для защиты доступа к конфигурационным единицам.
-    mutable std::mutex dependencies_mutex_; ///< Мьютекс для защиты доступа к связям.
+    std::vector<std::mutex> shard_mutexes_; ///< Мьютексы сегментов (захватываются по возрастанию индекса).
+    std::mutex levels_mutex_; ///< Мьютекс уровней (захватывается раньше мьютексов сегментов).
+    std::unique_ptr<WritePipeline> pipeline_; ///< Конвейер модификаций (nullptr, если отключен).
+    std::mutex save_mutex_; ///< Мьютекс, сериализующий сохранение в файл.
 
     std::atomic<bool> saving_{false}; ///< Флаг, указывающий, выполняется ли сохранение.
     std::atomic<bool> stop_thread_{false}; ///< Флаг, указывающий, нужно ли остановить поток автоматического сохранения.
@@ -443,10 +642,120 @@ private:
     std::condition_variable stop_condition_; ///< Условная переменная для прерывания потока автоматического сохранения.
     std::mutex stop_mutex_; ///< Мьютекс для защиты условной переменной и флага прерывания.
 
-    bool modified_ = false; ///< Флаг, указывающий, были ли внесены изменения в данные.
+    std::atomic<bool> modified_{false}; ///< Флаг, указывающий, были ли внесены изменения в данные.
     static std::unique_ptr<CMDB> instance_; ///< Уникальный указатель на экземпляр CMDB (синглтон).
     static std::once_flag init_flag_; ///< Флаг для инициализации синглтона.
-    CMDB() = default; ///< Конструктор по умолчанию (приватный для синглтона).
+    explicit CMDB(size_t shard_count); ///< Конструктор (приватный для синглтона).
+
+    /**
+     * @brief Тип набора удерживаемых блокировок сегментов.
+     */
+    using ShardLocks = std::vector<std::unique_lock<std::mutex>>;
+
+    /**
+     * @brief Опубликовать версию, собранную построителем, если в ней есть изменения.
+     *
+     * Вызывается под блокировками всех сегментов, которые изменял построитель. Измененные сегменты
+     * переносятся в текущий снимок через compare-and-swap, поэтому параллельные публикации
+     * непересекающихся сегментов не теряют изменений друг друга.
+     *
+     * @param builder Построитель новой версии.
+     */
+    void publish(SnapshotBuilder& builder);
+
+    /**
+     * @brief Заблокировать сегменты с указанными индексами (по возрастанию, без повторов).
+     */
+    ShardLocks lockShards(std::vector<size_t> indexes);
+
+    /**
+     * @brief Блокировки уровней и всех сегментов.
+     */
+    struct AllLocks {
+        std::unique_lock<std::mutex> levels; ///< Блокировка уровней.
+        ShardLocks shards; ///< Блокировки сегментов.
+    };
+
+    /**
+     * @brief Заблокировать все сегменты.
+     */
+    ShardLocks lockAllShards();
+
+    /**
+     * @brief Заблокировать уровни и все сегменты.
+     */
+    AllLocks lockAll();
+
+    /**
+     * @brief Заблокировать сегменты обеих КЕ связи.
+     */
+    ShardLocks lockEndpoints(const std::string& from_id, const std::string& to_id);
+
+    /**
+     * @brief Заблокировать сегмент КЕ и сегменты всех КЕ, связанных с ней.
+     */
+    ShardLocks lockRelatedShards(const std::string& id);
+
+    /**
+     * @brief Индексы сегмента КЕ и сегментов всех КЕ, связанных с ней, по возрастанию.
+     */
+    static std::vector<size_t> relatedShards(const Snapshot& snapshot, const std::string& id);
+
+    /**
+     * @brief Выполнить модификацию.
+     *
+     * Без конвейера модификация применяется в вызывающем потоке под блокировками, которые
+     * возвращает `lock`. С конвейером модификация ставится в очередь потока-писателя,
+     * а вызывающий поток ожидает ее результат.
+     *
+     * @param lock Функция, захватывающая необходимые блокировки.
+     * @param apply Функция, применяющая модификацию к `SnapshotBuilder&`.
+     * @return Результат `apply`.
+     */
+    template <typename Lock, typename Apply>
+    auto mutate(Lock lock, Apply apply) -> decltype(apply(std::declval<SnapshotBuilder&>()));
+
+    /**
+     * @brief Выполнить модификацию и передать результат функции обратного вызова.
+     *
+     * С конвейером `callback(error, result)` вызывается потоком-писателем после публикации,
+     * без конвейера - в вызывающем потоке.
+     */
+    template <typename Lock, typename Apply, typename Callback>
+    void mutate(Lock lock, Apply apply, Callback callback);
+
+    /**
+     * @brief Применить операции транзакции к построителю (все или ни одной).
+     */
+    static TxResult applyOperations(SnapshotBuilder& builder, const std::vector<TxOperation>& operations);
+
+    /**
+     * @brief Применить одну операцию транзакции к построителю.
+     *
+     * @param builder Построитель транзакции.
+     * @param operation Операция.
+     * @param message Результат операции.
+     * @return true, если операция применена.
+     */
+    static bool applyOperation(SnapshotBuilder& builder, const TxOperation& operation, std::string& message);
+
+    /**
+     * @brief Применить пачку модификаций конвейера под всеми блокировками и опубликовать один снимок.
+     *
+     * Каждая модификация применяется к дочернему построителю и сливается с пачкой только при
+     * успехе; модификация, завершившаяся исключением, получает эту ошибку.
+     */
+    void commitBatch(const WritePipeline::Batch& batch);
+
+    /**
+     * @brief Предикат отбора КЕ по полям id, name, type и level из фильтров запроса.
+     */
+    static std::function<bool(const CIPtr&)> matchCI(const std::map<std::string, std::string>& filters);
+
+    /**
+     * @brief Получить КЕ, содержащие все перечисленные свойства, из заданного снимка.
+     */
+    static std::shared_ptr<std::vector<CIPtr>> getCIs(const Snapshot& snapshot, const std::vector<std::string>& props);
 
     /**
      * @brief Внутренняя функция для получения списка конфигурационных единиц с использованием предиката.
@@ -478,22 +787,22 @@ private:
     bool saveCollection(std::ofstream& out, const std::vector<std::string>& collection);
 
     /**
-     * @brief Сохранить коллекцию конфигурационных единиц в файл.
+     * @brief Сохранить конфигурационные единицы всех сегментов снимка в файл.
      *
      * @param out Поток вывода для сохранения.
-     * @param collection Коллекция конфигурационных единиц.
+     * @param snapshot Снимок состояния.
      * @return true, если сохранение прошло успешно, иначе false.
      */
-    bool saveCollection(std::ofstream& out, const CIList& collection);
+    bool saveCIs(std::ofstream& out, const Snapshot& snapshot);
 
     /**
-     * @brief Сохранить коллекцию связей в файл.
+     * @brief Сохранить связи всех сегментов снимка в файл.
      *
      * @param out Поток вывода для сохранения.
-     * @param collection Коллекция связей.
+     * @param snapshot Снимок состояния.
      * @return true, если сохранение прошло успешно, иначе false.
      */
-    bool saveCollection(std::ofstream& out, const RelationshipMap& collection);
+    bool saveRelationships(std::ofstream& out, const Snapshot& snapshot);
 
     /**
      * @brief Загрузить коллекцию строк из файла.
@@ -522,46 +831,11 @@ private:
      */
     bool loadCollection(std::ifstream& in, RelationshipMap& collection);
 
-    /**
-     * @brief Восстановить карту идентификаторов конфигурационных единиц к указателям.
-     */
-    void restoreIDtoCI();
-
-    /**
-     * @brief Восстановить обратный индекс для поиска зависимых CI.
-     */
-    void restoreReverseIndex();
-
-    /**
-     * @brief Восстановить карту свойств и CI.
-     */
-    void restorePropertiesMap();
-
     /**
      * @brief Цикл автоматического сохранения данных CMDB.
      */
     void autoSaveLoop();
 
-    /**
-     * @brief Обновление карты свойств.
-     */
-    void updatePropertiesMap(CIPtr ci, const std::unordered_map<std::string, std::string>& properties);
-
-    /**
-     * @brief Удаление свойства из карты свойств.
-     */
-    void deletePropertyFromMap(CIPtr ci, const std::string& property_name);
-
-    /**
-     * @brief Удаление свойств из карты свойств.
-     */
-    void deletePropertiesMap(CIPtr ci, const std::unordered_map<std::string, std::string>& properties);
-
-    /**
-     * @brief Создание или дополнение свойства в карты свойств.
-     */
-    void addPropertyToMap(CIPtr ci, const std::string& property_name, const std::string& property_value);
-
     static std::string urlDecode(const std::string& str);
 
     static std::vector<std::string> splitAndDecode(const std::string& input, char a);
@@ -0,0 +1,801 @@
+/**
+ * @file Persistent.h
+ * @brief Персистентные (структурно разделяемые) контейнеры для версий снимка CMDB.
+ *
+ * Копия контейнера разделяет с оригиналом все узлы, поэтому копирование занимает O(1). Изменение
+ * копирует только путь от корня до затронутого элемента: O(log32 N) узлов хеш-дерева и O(log2 N)
+ * узлов AVL-дерева, остальные узлы остаются общими со всеми версиями.
+ *
+ * Изменяющие методы принимают метку правки (EditToken). Узлы, созданные с той же меткой,
+ * принадлежат построителю, и повторные изменения в них выполняются на месте без копирования.
+ * Узлы с другой меткой считаются неизменяемыми: они могут быть видны опубликованным снимкам.
+ * После публикации построитель обязан сменить метку (newEditToken()).
+ *
+ * Копия контейнера, сделанная во время правки, разделяет с ним узлы текущей метки, поэтому
+ * изменять с этой меткой можно только один из экземпляров.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace cmdb {
+
+/**
+ * @brief Метка правки: узлы с этой меткой принадлежат одному построителю.
+ */
+using EditToken = uint64_t;
+
+/**
+ * @brief Новая уникальная метка правки.
+ */
+inline EditToken newEditToken() {
+    static std::atomic<EditToken> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+namespace detail {
+
+/**
+ * @class HashTrie
+ * @brief Персистентное хеш-дерево (CHAMP): 32-ветвящиеся узлы с битовыми картами элементов и поддеревьев.
+ *
+ * @tparam Entry Тип хранимого элемента.
+ * @tparam Key Тип ключа.
+ * @tparam KeyOf Функция получения ключа из элемента.
+ * @tparam Hash Хеш-функция ключа.
+ * @tparam Equal Сравнение ключей на равенство.
+ */
+template <typename Entry, typename Key, typename KeyOf, typename Hash, typename Equal>
+class HashTrie {
+    static constexpr unsigned BITS = 5;                         ///< Разрядов хеша на уровень.
+    static constexpr unsigned HASH_BITS = sizeof(size_t) * 8;   ///< Разрядов хеша всего.
+    static constexpr size_t MAX_DEPTH = HASH_BITS / BITS + 2;   ///< Наибольшая глубина с узлом коллизий.
+
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+
+    /**
+     * @brief Узел: элементы и поддеревья в порядке номера фрагмента хеша.
+     *
+     * Узел ниже последнего уровня хранит элементы с совпадающим хешем без битовых карт.
+     */
+    struct Node {
+        EditToken edit = 0;             ///< Метка правки, с которой создан узел.
+        uint32_t datamap = 0;           ///< Фрагменты, занятые элементами.
+        uint32_t nodemap = 0;           ///< Фрагменты, занятые поддеревьями.
+        std::vector<Entry> entries;     ///< Элементы.
+        std::vector<NodePtr> children;  ///< Поддеревья.
+    };
+
+public:
+    using value_type = Entry;
+    using size_type = size_t;
+
+    /**
+     * @class const_iterator
+     * @brief Прямой итератор по элементам (порядок определяется хешами ключей).
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Entry*;
+        using reference = const Entry&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return top().node->entries[top().pos]; }
+        pointer operator->() const { return &**this; }
+
+        const_iterator& operator++() {
+            ++top().pos;
+            settle();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            if (depth_ == 0 || other.depth_ == 0) {
+                return depth_ == other.depth_;
+            }
+
+            return top().node == other.top().node && top().pos == other.top().pos;
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class HashTrie;
+
+        struct Frame {
+            const Node* node = nullptr; ///< Узел.
+            size_t pos = 0;             ///< Позиция: элементы, затем поддеревья.
+        };
+
+        Frame& top() { return frames_[depth_ - 1]; }
+        const Frame& top() const { return frames_[depth_ - 1]; }
+
+        void push(const Node* node, size_t pos) { frames_[depth_++] = Frame{node, pos}; }
+
+        /**
+         * @brief Переход к ближайшему элементу, начиная с текущей позиции.
+         */
+        void settle() {
+            while (depth_ > 0) {
+                auto& frame = top();
+                const auto& entries = frame.node->entries;
+                const auto& children = frame.node->children;
+
+                if (frame.pos < entries.size()) {
+                    return;
+                }
+
+                size_t child = frame.pos - entries.size();
+                if (child < children.size()) {
+                    ++frame.pos;
+                    push(children[child].get(), 0);
+                } else {
+                    --depth_;
+                }
+            }
+        }
+
+        std::array<Frame, MAX_DEPTH> frames_{}; ///< Путь от корня.
+        size_t depth_ = 0;                      ///< Длина пути (0 - конец).
+    };
+
+    const_iterator begin() const {
+        const_iterator it;
+        if (root_) {
+            it.push(root_.get(), 0);
+            it.settle();
+        }
+        return it;
+    }
+
+    const_iterator end() const { return const_iterator(); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief Найти элемент по ключу.
+     */
+    const_iterator find(const Key& key) const {
+        const_iterator it;
+        const Node* node = root_.get();
+        size_t hash = Hash{}(key);
+
+        for (unsigned shift = 0; node; shift += BITS) {
+            if (shift >= HASH_BITS) {
+                for (size_t i = 0; i < node->entries.size(); ++i) {
+                    if (Equal{}(KeyOf{}(node->entries[i]), key)) {
+                        it.push(node, i);
+                        return it;
+                    }
+                }
+                return end();
+            }
+
+            uint32_t bit = bitOf(hash, shift);
+
+            if (node->datamap & bit) {
+                size_t i = index(node->datamap, bit);
+                if (!Equal{}(KeyOf{}(node->entries[i]), key)) {
+                    return end();
+                }
+                it.push(node, i);
+                return it;
+            }
+
+            if (!(node->nodemap & bit)) {
+                return end();
+            }
+
+            size_t child = index(node->nodemap, bit);
+            it.push(node, node->entries.size() + child + 1);
+            node = node->children[child].get();
+        }
+
+        return end();
+    }
+
+    size_t count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+
+    /**
+     * @brief Добавить элемент, если его ключа нет.
+     * @return true, если элемент добавлен.
+     */
+    bool insert(Entry entry, EditToken edit) {
+        if (find(KeyOf{}(entry)) != end()) {
+            return false;
+        }
+
+        assign(std::move(entry), edit);
+        return true;
+    }
+
+    /**
+     * @brief Добавить элемент или заменить элемент с тем же ключом.
+     */
+    void assign(Entry entry, EditToken edit) {
+        if (!root_) {
+            root_ = std::make_shared<Node>();
+            root_->edit = edit;
+        }
+
+        size_t hash = Hash{}(KeyOf{}(entry));
+        if (assoc(root_, 0, hash, std::move(entry), edit)) {
+            ++size_;
+        }
+    }
+
+    /**
+     * @brief Удалить элемент по ключу.
+     * @return true, если элемент был удален.
+     */
+    bool erase(const Key& key, EditToken edit) {
+        if (find(key) == end()) {
+            return false;
+        }
+
+        dissoc(root_, 0, Hash{}(key), key, edit);
+        --size_;
+
+        return true;
+    }
+
+    /**
+     * @brief Изменяемый элемент по ключу (путь до него копируется при необходимости).
+     * @return Указатель на элемент или nullptr, если ключа нет. Ключ элемента менять нельзя.
+     */
+    Entry* update(const Key& key, EditToken edit) {
+        if (find(key) == end()) {
+            return nullptr;
+        }
+
+        NodePtr* slot = &root_;
+        size_t hash = Hash{}(key);
+
+        for (unsigned shift = 0;; shift += BITS) {
+            Node& node = own(*slot, edit);
+
+            if (shift >= HASH_BITS) {
+                for (auto& entry : node.entries) {
+                    if (Equal{}(KeyOf{}(entry), key)) {
+                        return &entry;
+                    }
+                }
+                return nullptr;
+            }
+
+            uint32_t bit = bitOf(hash, shift);
+
+            if (node.datamap & bit) {
+                return &node.entries[index(node.datamap, bit)];
+            }
+
+            slot = &node.children[index(node.nodemap, bit)];
+        }
+    }
+
+private:
+    static uint32_t bitOf(size_t hash, unsigned shift) {
+        return 1u << ((hash >> shift) & ((1u << BITS) - 1));
+    }
+
+    static size_t index(uint32_t map, uint32_t bit) {
+        return std::bitset<32>(map & (bit - 1)).count();
+    }
+
+    /**
+     * @brief Узел, принадлежащий правке edit (копия, если узел общий).
+     */
+    static Node& own(NodePtr& node, EditToken edit) {
+        if (node->edit != edit) {
+            node = std::make_shared<Node>(*node);
+            node->edit = edit;
+        }
+
+        return *node;
+    }
+
+    /**
+     * @brief Поддерево из двух элементов с разными ключами.
+     */
+    static NodePtr makePair(Entry&& a, size_t hash_a, Entry&& b, size_t hash_b, unsigned shift, EditToken edit) {
+        auto node = std::make_shared<Node>();
+        node->edit = edit;
+
+        if (shift >= HASH_BITS) {
+            node->entries.push_back(std::move(a));
+            node->entries.push_back(std::move(b));
+            return node;
+        }
+
+        uint32_t bit_a = bitOf(hash_a, shift);
+        uint32_t bit_b = bitOf(hash_b, shift);
+
+        if (bit_a == bit_b) {
+            node->nodemap = bit_a;
+            node->children.push_back(makePair(std::move(a), hash_a, std::move(b), hash_b, shift + BITS, edit));
+        } else {
+            node->datamap = bit_a | bit_b;
+            node->entries.reserve(2);
+            if (bit_a < bit_b) {
+                node->entries.push_back(std::move(a));
+                node->entries.push_back(std::move(b));
+            } else {
+                node->entries.push_back(std::move(b));
+                node->entries.push_back(std::move(a));
+            }
+        }
+
+        return node;
+    }
+
+    /**
+     * @brief Вставка или замена в поддереве.
+     * @return true, если ключ добавлен.
+     */
+    static bool assoc(NodePtr& slot, unsigned shift, size_t hash, Entry&& entry, EditToken edit) {
+        Node& node = own(slot, edit);
+
+        if (shift >= HASH_BITS) {
+            for (auto& existing : node.entries) {
+                if (Equal{}(KeyOf{}(existing), KeyOf{}(entry))) {
+                    existing = std::move(entry);
+                    return false;
+                }
+            }
+
+            node.entries.push_back(std::move(entry));
+            return true;
+        }
+
+        uint32_t bit = bitOf(hash, shift);
+
+        if (node.datamap & bit) {
+            size_t i = index(node.datamap, bit);
+
+            if (Equal{}(KeyOf{}(node.entries[i]), KeyOf{}(entry))) {
+                node.entries[i] = std::move(entry);
+                return false;
+            }
+
+            // Два ключа с общим фрагментом уходят в новое поддерево
+            Entry existing = std::move(node.entries[i]);
+            size_t existing_hash = Hash{}(KeyOf{}(existing));
+            node.entries.erase(node.entries.begin() + i);
+            node.datamap ^= bit;
+
+            auto child = makePair(std::move(existing), existing_hash, std::move(entry), hash, shift + BITS, edit);
+            node.nodemap |= bit;
+            node.children.insert(node.children.begin() + index(node.nodemap, bit), std::move(child));
+
+            return true;
+        }
+
+        if (node.nodemap & bit) {
+            return assoc(node.children[index(node.nodemap, bit)], shift + BITS, hash, std::move(entry), edit);
+        }
+
+        node.datamap |= bit;
+        node.entries.insert(node.entries.begin() + index(node.datamap, bit), std::move(entry));
+
+        return true;
+    }
+
+    /**
+     * @brief Удаление существующего ключа из поддерева.
+     */
+    static void dissoc(NodePtr& slot, unsigned shift, size_t hash, const Key& key, EditToken edit) {
+        Node& node = own(slot, edit);
+
+        if (shift >= HASH_BITS) {
+            for (auto it = node.entries.begin(); it != node.entries.end(); ++it) {
+                if (Equal{}(KeyOf{}(*it), key)) {
+                    node.entries.erase(it);
+                    return;
+                }
+            }
+            return;
+        }
+
+        uint32_t bit = bitOf(hash, shift);
+
+        if (node.datamap & bit) {
+            node.entries.erase(node.entries.begin() + index(node.datamap, bit));
+            node.datamap ^= bit;
+            return;
+        }
+
+        size_t child_index = index(node.nodemap, bit);
+        dissoc(node.children[child_index], shift + BITS, hash, key, edit);
+
+        // Поддерево из одного элемента заменяется самим элементом
+        Node& child = *node.children[child_index];
+        if (child.children.empty() && child.entries.size() <= 1) {
+            std::optional<Entry> moved;
+            if (!child.entries.empty()) {
+                moved.emplace(std::move(child.entries.front()));
+            }
+
+            node.children.erase(node.children.begin() + child_index);
+            node.nodemap ^= bit;
+
+            if (moved) {
+                node.datamap |= bit;
+                node.entries.insert(node.entries.begin() + index(node.datamap, bit), std::move(*moved));
+            }
+        }
+    }
+
+    NodePtr root_;      ///< Корень (nullptr - пустой контейнер).
+    size_t size_ = 0;   ///< Количество элементов.
+};
+
+/**
+ * @brief Ключ элемента хеш-таблицы.
+ */
+struct FirstOf {
+    template <typename Pair>
+    const auto& operator()(const Pair& pair) const { return pair.first; }
+};
+
+/**
+ * @brief Ключ элемента множества (сам элемент).
+ */
+struct Identity {
+    template <typename T>
+    const T& operator()(const T& value) const { return value; }
+};
+
+} // namespace detail
+
+/**
+ * @class PersistentHashMap
+ * @brief Персистентная хеш-таблица: ключ -> значение.
+ *
+ * Элементы - `std::pair<Key, Value>`, поэтому обход поддерживает `const auto& [key, value]`.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class PersistentHashMap : public detail::HashTrie<std::pair<Key, Value>, Key, detail::FirstOf, Hash, Equal> {
+    using Base = detail::HashTrie<std::pair<Key, Value>, Key, detail::FirstOf, Hash, Equal>;
+
+public:
+    /**
+     * @brief Записать значение по ключу (добавить или заменить).
+     */
+    void set(Key key, Value value, EditToken edit) {
+        Base::assign(std::pair<Key, Value>(std::move(key), std::move(value)), edit);
+    }
+
+    /**
+     * @brief Изменяемое значение по ключу; отсутствующий ключ добавляется со значением по умолчанию.
+     */
+    Value& modify(const Key& key, EditToken edit) {
+        if (auto* entry = Base::update(key, edit)) {
+            return entry->second;
+        }
+
+        Base::assign(std::pair<Key, Value>(key, Value()), edit);
+        return Base::update(key, edit)->second;
+    }
+};
+
+/**
+ * @class PersistentHashSet
+ * @brief Персистентное множество ключей.
+ */
+template <typename Key, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class PersistentHashSet : public detail::HashTrie<Key, Key, detail::Identity, Hash, Equal> {};
+
+/**
+ * @class PersistentTreeSet
+ * @brief Персистентное упорядоченное множество (AVL-дерево).
+ *
+ * Элементы, эквивалентные по Compare, не повторяются. Compare может быть прозрачным: поиск границ
+ * и удаление принимают любой ключ, сравнимый с элементами.
+ *
+ * @tparam T Тип элемента.
+ * @tparam Compare Строгий порядок элементов.
+ */
+template <typename T, typename Compare>
+class PersistentTreeSet {
+    static constexpr size_t MAX_DEPTH = 64; ///< Высота AVL-дерева меньше 1.45 * log2(N + 2).
+
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+
+    struct Node {
+        EditToken edit = 0;     ///< Метка правки, с которой создан узел.
+        T value;                ///< Элемент.
+        NodePtr left;           ///< Меньшие элементы.
+        NodePtr right;          ///< Большие элементы.
+        int height = 1;         ///< Высота поддерева.
+    };
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+
+    /**
+     * @class const_iterator
+     * @brief Прямой итератор по возрастанию элементов.
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return path_[depth_ - 1]->value; }
+        pointer operator->() const { return &**this; }
+
+        const_iterator& operator++() {
+            const Node* node = path_[--depth_];
+            pushLeft(node->right.get());
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            if (depth_ == 0 || other.depth_ == 0) {
+                return depth_ == other.depth_;
+            }
+
+            return path_[depth_ - 1] == other.path_[other.depth_ - 1];
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class PersistentTreeSet;
+
+        void push(const Node* node) { path_[depth_++] = node; }
+
+        void pushLeft(const Node* node) {
+            for (; node; node = node->left.get()) {
+                push(node);
+            }
+        }
+
+        std::array<const Node*, MAX_DEPTH> path_{}; ///< Предки, которые еще не пройдены (вершина - текущий).
+        size_t depth_ = 0;                          ///< Размер стека (0 - конец).
+    };
+
+    const_iterator begin() const {
+        const_iterator it;
+        it.pushLeft(root_.get());
+        return it;
+    }
+
+    const_iterator end() const { return const_iterator(); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief Первый элемент, не меньший key.
+     */
+    template <typename K>
+    const_iterator lower_bound(const K& key) const {
+        const_iterator it;
+        for (const Node* node = root_.get(); node;) {
+            if (Compare{}(node->value, key)) {
+                node = node->right.get();
+            } else {
+                it.push(node);
+                node = node->left.get();
+            }
+        }
+        return it;
+    }
+
+    /**
+     * @brief Первый элемент, больший key.
+     */
+    template <typename K>
+    const_iterator upper_bound(const K& key) const {
+        const_iterator it;
+        for (const Node* node = root_.get(); node;) {
+            if (Compare{}(key, node->value)) {
+                it.push(node);
+                node = node->left.get();
+            } else {
+                node = node->right.get();
+            }
+        }
+        return it;
+    }
+
+    /**
+     * @brief Найти элемент, эквивалентный key.
+     */
+    template <typename K>
+    const_iterator find(const K& key) const {
+        auto it = lower_bound(key);
+        return it != end() && !Compare{}(key, *it) ? it : end();
+    }
+
+    template <typename K>
+    size_t count(const K& key) const { return find(key) != end() ? 1 : 0; }
+
+    /**
+     * @brief Добавить элемент, если эквивалентного нет.
+     * @return true, если элемент добавлен.
+     */
+    bool insert(T value, EditToken edit) {
+        if (find(value) != end()) {
+            return false;
+        }
+
+        insertAt(root_, std::move(value), edit);
+        ++size_;
+
+        return true;
+    }
+
+    /**
+     * @brief Удалить элемент, эквивалентный key.
+     * @return true, если элемент был удален.
+     */
+    template <typename K>
+    bool erase(const K& key, EditToken edit) {
+        if (find(key) == end()) {
+            return false;
+        }
+
+        eraseAt(root_, key, edit);
+        --size_;
+
+        return true;
+    }
+
+private:
+    static int height(const NodePtr& node) { return node ? node->height : 0; }
+
+    static void updateHeight(Node& node) { node.height = std::max(height(node.left), height(node.right)) + 1; }
+
+    static Node& own(NodePtr& node, EditToken edit) {
+        if (node->edit != edit) {
+            node = std::make_shared<Node>(*node);
+            node->edit = edit;
+        }
+
+        return *node;
+    }
+
+    static void rotateRight(NodePtr& slot, EditToken edit) {
+        Node& node = own(slot, edit);
+        own(node.left, edit);
+
+        NodePtr pivot = node.left;
+        node.left = pivot->right;
+        updateHeight(node);
+        pivot->right = slot;
+        updateHeight(*pivot);
+        slot = std::move(pivot);
+    }
+
+    static void rotateLeft(NodePtr& slot, EditToken edit) {
+        Node& node = own(slot, edit);
+        own(node.right, edit);
+
+        NodePtr pivot = node.right;
+        node.right = pivot->left;
+        updateHeight(node);
+        pivot->left = slot;
+        updateHeight(*pivot);
+        slot = std::move(pivot);
+    }
+
+    /**
+     * @brief Восстановление баланса узла, принадлежащего правке.
+     */
+    static void rebalance(NodePtr& slot, EditToken edit) {
+        Node& node = *slot;
+        int balance = height(node.left) - height(node.right);
+
+        if (balance > 1) {
+            if (height(node.left->left) < height(node.left->right)) {
+                rotateLeft(node.left, edit);
+            }
+            rotateRight(slot, edit);
+        } else if (balance < -1) {
+            if (height(node.right->right) < height(node.right->left)) {
+                rotateRight(node.right, edit);
+            }
+            rotateLeft(slot, edit);
+        } else {
+            updateHeight(node);
+        }
+    }
+
+    static void insertAt(NodePtr& slot, T&& value, EditToken edit) {
+        if (!slot) {
+            slot = std::make_shared<Node>();
+            slot->edit = edit;
+            slot->value = std::move(value);
+            return;
+        }
+
+        Node& node = own(slot, edit);
+
+        if (Compare{}(value, node.value)) {
+            insertAt(node.left, std::move(value), edit);
+        } else {
+            insertAt(node.right, std::move(value), edit);
+        }
+
+        rebalance(slot, edit);
+    }
+
+    static T removeMin(NodePtr& slot, EditToken edit) {
+        Node& node = own(slot, edit);
+
+        if (!node.left) {
+            T value = std::move(node.value);
+            NodePtr right = node.right;
+            slot = std::move(right);
+            return value;
+        }
+
+        T value = removeMin(node.left, edit);
+        rebalance(slot, edit);
+
+        return value;
+    }
+
+    template <typename K>
+    static void eraseAt(NodePtr& slot, const K& key, EditToken edit) {
+        Node& node = own(slot, edit);
+
+        if (Compare{}(key, node.value)) {
+            eraseAt(node.left, key, edit);
+        } else if (Compare{}(node.value, key)) {
+            eraseAt(node.right, key, edit);
+        } else if (!node.left || !node.right) {
+            NodePtr child = node.left ? node.left : node.right;
+            slot = std::move(child);
+            return;
+        } else {
+            node.value = removeMin(node.right, edit);
+        }
+
+        rebalance(slot, edit);
+    }
+
+    NodePtr root_;      ///< Корень (nullptr - пустое множество).
+    size_t size_ = 0;   ///< Количество элементов.
+};
+
+} // namespace cmdb
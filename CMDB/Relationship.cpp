@@ -5,9 +5,9 @@ namespace cmdb {
 Relationship::Relationship(const std::string& source, const std::string& destination, const std::string& type, double weight)
         : source_(source), destination_(destination), type_(type), weight_(weight) {}
 
-std::string Relationship::getType() const { return type_; }
-std::string Relationship::getSource() const { return source_; }
-std::string Relationship::getDestination() const { return destination_; }
+const std::string& Relationship::getType() const { return type_; }
+const std::string& Relationship::getSource() const { return source_; }
+const std::string& Relationship::getDestination() const { return destination_; }
 double Relationship::getWeight() const { return weight_; }
 
 std::string Relationship::getCIasJSONstring() const {
@@ -88,21 +88,21 @@ public:
      *
      * @return Тип связи.
      */
-    std::string getType() const;
+    const std::string& getType() const;
 
     /**
      * @brief Получить идентификатор исходной конфигурационной единицы.
      *
      * @return Идентификатор исходной CI.
      */
-    std::string getSource() const;
+    const std::string& getSource() const;
 
     /**
      * @brief Получить идентификатор целевой конфигурационной единицы.
      *
      * @return Идентификатор целевой CI.
      */
-    std::string getDestination() const;
+    const std::string& getDestination() const;
 
     /**
      * @brief Получить вес связи.
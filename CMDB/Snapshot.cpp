@@ -0,0 +1,403 @@
+#include "Snapshot.h"
+#include <algorithm>
+
+namespace cmdb {
+
+namespace {
+
+template <typename T>
+T& detach(std::shared_ptr<const T>& slot, std::shared_ptr<T>& owned) {
+    if (!owned) {
+        owned = std::make_shared<T>(*slot);
+        slot = owned;
+    }
+
+    return *owned;
+}
+
+} // namespace
+
+/*
+*   BEGIN: SnapshotShard
+*/
+
+SnapshotShard::SnapshotShard() = default;
+
+const SnapshotShard::CIMap& SnapshotShard::getCIMap() const { return cis_; }
+const SnapshotShard::CIPropertyMap& SnapshotShard::getPropertyMap() const { return properties_; }
+const SnapshotShard::ReverseIndex& SnapshotShard::getReverseIndex() const { return reverse_index_; }
+const SnapshotShard::CIOrder& SnapshotShard::getCIOrder() const { return ci_order_; }
+const SnapshotShard::RelationshipOrder& SnapshotShard::getRelationshipOrder() const { return relationship_order_; }
+
+SnapshotShard::CIPtr SnapshotShard::getCI(const std::string& id) const {
+    auto it = cis_.find(id);
+    return (it != cis_.end()) ? it->second : nullptr;
+}
+
+// END: SnapshotShard
+
+/*
+*   BEGIN: Snapshot
+*/
+
+Snapshot::Snapshot(size_t shard_count)
+    : levels_(std::make_shared<Levels>()) {
+    shard_count = std::max<size_t>(shard_count, 1);
+    shards_.reserve(shard_count);
+
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_shared<SnapshotShard>());
+    }
+}
+
+uint64_t Snapshot::getGeneration() const { return generation_; }
+const Snapshot::Levels& Snapshot::getLevels() const { return *levels_; }
+size_t Snapshot::getShardCount() const { return shards_.size(); }
+const SnapshotShard& Snapshot::getShard(size_t index) const { return *shards_.at(index); }
+
+size_t Snapshot::shardIndex(const std::string& id) const {
+    return std::hash<std::string>{}(id) % shards_.size();
+}
+
+Snapshot::CIPtr Snapshot::getCI(const std::string& id) const {
+    return shards_[shardIndex(id)]->getCI(id);
+}
+
+size_t Snapshot::getCICount() const {
+    size_t count = 0;
+
+    for (const auto& shard : shards_) {
+        count += shard->getCIMap().size();
+    }
+
+    return count;
+}
+
+size_t Snapshot::getRelationshipCount() const {
+    size_t count = 0;
+
+    for (const auto& shard : shards_) {
+        count += shard->getRelationshipOrder().size();
+    }
+
+    return count;
+}
+
+bool Snapshot::hasProperty(const std::string& property_name) const {
+    for (const auto& shard : shards_) {
+        if (shard->getPropertyMap().count(property_name) > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const Snapshot::IdSet* Snapshot::getDependents(const std::string& to_id) const {
+    const auto& reverse_index = shards_[shardIndex(to_id)]->getReverseIndex();
+    auto it = reverse_index.find(to_id);
+
+    return (it != reverse_index.end()) ? &it->second : nullptr;
+}
+
+// END: Snapshot
+
+/*
+*   BEGIN: SnapshotBuilder
+*/
+
+/**
+ * @brief Построитель одного сегмента: правка персистентных индексов с собственной меткой.
+ */
+class SnapshotBuilder::ShardBuilder {
+public:
+    explicit ShardBuilder(const std::shared_ptr<const SnapshotShard>& base)
+        : next_(std::make_shared<SnapshotShard>(*base)),
+          edit_(newEditToken()) {}
+
+    const std::shared_ptr<SnapshotShard>& get() const { return next_; }
+    const SnapshotShard& view() const { return *next_; }
+    bool isModified() const { return modified_; }
+    EditToken edit() const { return edit_; }
+
+    /**
+     * @brief Изменяемый сегмент.
+     */
+    SnapshotShard& modify() {
+        modified_ = true;
+        return *next_;
+    }
+
+    /**
+     * @brief Отдает собранный сегмент результату: новая метка и собственная копия корней.
+     */
+    void freeze() {
+        edit_ = newEditToken();
+        next_ = std::make_shared<SnapshotShard>(*next_);
+    }
+
+    void indexProperties(const CI& ci) {
+        auto& shard = modify();
+
+        for (const auto& [property_name, property_value] : ci.getProperties()) {
+            shard.properties_.modify(property_name, edit_).insert(ci.getId(), edit_);
+        }
+    }
+
+    void unindexProperties(const CI& ci) {
+        auto& shard = modify();
+
+        for (const auto& [property_name, property_value] : ci.getProperties()) {
+            auto* entry = shard.properties_.update(property_name, edit_);
+            if (!entry) {
+                continue;
+            }
+
+            entry->second.erase(ci.getId(), edit_);
+
+            if (entry->second.empty()) {
+                shard.properties_.erase(property_name, edit_);
+            }
+        }
+    }
+
+    void insertReverse(const std::string& to_id, const std::string& from_id) {
+        modify().reverse_index_.modify(to_id, edit_).insert(from_id, edit_);
+    }
+
+    void eraseReverse(const std::string& to_id, const std::string& from_id) {
+        auto& reverse = modify().reverse_index_;
+        auto* entry = reverse.update(to_id, edit_);
+
+        if (entry) {
+            entry->second.erase(from_id, edit_);
+            if (entry->second.empty()) {
+                reverse.erase(to_id, edit_);
+            }
+        }
+    }
+
+private:
+    std::shared_ptr<SnapshotShard> next_; ///< Собираемая версия сегмента.
+    EditToken edit_; ///< Метка узлов, принадлежащих построителю.
+    bool modified_ = false; ///< Признак внесенных изменений.
+};
+
+SnapshotBuilder::SnapshotBuilder(const std::shared_ptr<const Snapshot>& base)
+    : next_(std::make_shared<Snapshot>(*base)),
+      shards_(base->getShardCount()) {}
+
+SnapshotBuilder::~SnapshotBuilder() = default;
+
+const Snapshot& SnapshotBuilder::view() const { return *next_; }
+
+bool SnapshotBuilder::isModified() const {
+    if (levels_modified_) {
+        return true;
+    }
+
+    return std::any_of(shards_.begin(), shards_.end(), [](const std::unique_ptr<ShardBuilder>& shard) {
+        return shard && shard->isModified();
+    });
+}
+
+Snapshot::Levels& SnapshotBuilder::levels() {
+    levels_modified_ = true;
+    return detach(next_->levels_, levels_);
+}
+
+SnapshotBuilder::ShardBuilder& SnapshotBuilder::shard(size_t index) {
+    auto& builder = shards_[index];
+
+    if (!builder) {
+        builder = std::make_unique<ShardBuilder>(next_->shards_[index]);
+        next_->shards_[index] = builder->get();
+    }
+
+    return *builder;
+}
+
+SnapshotBuilder::ShardBuilder& SnapshotBuilder::shardOf(const std::string& id) {
+    return shard(next_->shardIndex(id));
+}
+
+void SnapshotBuilder::putCI(Snapshot::CIPtr ci) {
+    auto& owner = shardOf(ci->getId());
+    auto& shard = owner.modify();
+    std::string id = ci->getId();
+
+    if (auto previous = shard.getCI(id)) {
+        owner.unindexProperties(*previous);
+        shard.ci_order_.erase(id, owner.edit());
+    }
+
+    owner.indexProperties(*ci);
+    shard.ci_order_.insert(ci, owner.edit());
+    shard.cis_.set(std::move(id), std::move(ci), owner.edit());
+}
+
+void SnapshotBuilder::insertCI(Snapshot::CIPtr ci) {
+    auto& owner = shardOf(ci->getId());
+    auto& shard = owner.modify();
+    std::string id = ci->getId();
+
+    owner.indexProperties(*ci);
+    shard.ci_order_.insert(ci, owner.edit());
+    shard.cis_.set(std::move(id), std::move(ci), owner.edit());
+}
+
+bool SnapshotBuilder::eraseCI(const std::string& id) {
+    auto previous = view().getCI(id);
+    if (!previous) {
+        return false;
+    }
+
+    auto& owner = shardOf(id);
+    auto& shard = owner.modify();
+    owner.unindexProperties(*previous);
+    shard.ci_order_.erase(id, owner.edit());
+    shard.cis_.erase(id, owner.edit());
+
+    return true;
+}
+
+void SnapshotBuilder::addRelationship(Snapshot::RelationshipPtr relationship) {
+    shardOf(relationship->getDestination()).insertReverse(relationship->getDestination(), relationship->getSource());
+
+    auto& owner = shardOf(relationship->getSource());
+    owner.modify().relationship_order_.insert(std::move(relationship), owner.edit());
+}
+
+bool SnapshotBuilder::removeRelationship(const std::string& from_id, const std::string& to_id, const std::optional<std::string>& type) {
+    auto& owner = shardOf(from_id);
+    const auto& order = owner.view().getRelationshipOrder();
+    Snapshot::RelationshipPtr removed;
+    bool still_linked = false;
+
+    for (auto it = order.lower_bound(RelationshipKey{from_id, to_id, ""});
+         it != order.end() && (*it)->getSource() == from_id && (*it)->getDestination() == to_id; ++it) {
+        if (!removed && (!type || (*it)->getType() == *type)) {
+            removed = *it;
+        } else {
+            still_linked = true;
+        }
+    }
+
+    if (!removed) {
+        return false;
+    }
+
+    owner.modify().relationship_order_.erase(removed, owner.edit());
+
+    if (!still_linked) {
+        shardOf(to_id).eraseReverse(to_id, from_id);
+    }
+
+    return true;
+}
+
+size_t SnapshotBuilder::removeRelationshipsForId(const std::string& id) {
+    std::vector<Snapshot::RelationshipPtr> outgoing;
+    view().forEachRelationshipFrom(id, [&](const Snapshot::RelationshipPtr& relationship) {
+        outgoing.push_back(relationship);
+    });
+
+    std::vector<std::string> source_ids;
+    if (auto sources = view().getDependents(id)) {
+        source_ids.assign(sources->begin(), sources->end());
+    }
+
+    if (outgoing.empty() && source_ids.empty()) {
+        return 0;
+    }
+
+    auto& owner = shardOf(id);
+    size_t removed = 0;
+
+    for (const auto& relationship : outgoing) {
+        const auto& to_id = relationship->getDestination();
+        owner.modify().relationship_order_.erase(relationship, owner.edit());
+        shardOf(to_id).eraseReverse(to_id, id);
+        ++removed;
+    }
+
+    for (const auto& source_id : source_ids) {
+        auto& source_owner = shardOf(source_id);
+        std::vector<Snapshot::RelationshipPtr> incoming;
+        const auto& order = source_owner.view().getRelationshipOrder();
+
+        for (auto it = order.lower_bound(RelationshipKey{source_id, id, ""});
+             it != order.end() && (*it)->getSource() == source_id && (*it)->getDestination() == id; ++it) {
+            incoming.push_back(*it);
+        }
+
+        for (const auto& relationship : incoming) {
+            source_owner.modify().relationship_order_.erase(relationship, source_owner.edit());
+            ++removed;
+        }
+    }
+
+    if (!source_ids.empty()) {
+        owner.modify().reverse_index_.erase(id, owner.edit());
+    }
+
+    return removed;
+}
+
+void SnapshotBuilder::merge(SnapshotBuilder&& child) {
+    if (child.levels_modified_) {
+        levels_ = std::move(child.levels_);
+        next_->levels_ = child.next_->levels_;
+        levels_modified_ = true;
+    }
+
+    for (size_t i = 0; i < shards_.size() && i < child.shards_.size(); ++i) {
+        if (child.shards_[i] && child.shards_[i]->isModified()) {
+            shards_[i] = std::move(child.shards_[i]);
+            next_->shards_[i] = shards_[i]->get();
+        }
+    }
+}
+
+void SnapshotBuilder::freeze() {
+    // Опубликованные уровни больше не правятся: следующий levels() снимет с них копию
+    levels_.reset();
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (shards_[i]) {
+            shards_[i]->freeze();
+            next_->shards_[i] = shards_[i]->get();
+        }
+    }
+}
+
+std::shared_ptr<const Snapshot> SnapshotBuilder::build(uint64_t generation) {
+    auto result = std::make_shared<Snapshot>(*next_);
+    result->generation_ = generation;
+    freeze();
+
+    return result;
+}
+
+std::shared_ptr<const Snapshot> SnapshotBuilder::rebase(const Snapshot& latest, uint64_t generation) {
+    auto result = std::make_shared<Snapshot>(latest);
+    result->generation_ = generation;
+
+    if (levels_modified_) {
+        result->levels_ = next_->levels_;
+    }
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (shards_[i] && shards_[i]->isModified()) {
+            result->shards_[i] = next_->shards_[i];
+        }
+    }
+
+    freeze();
+
+    return result;
+}
+
+// END: SnapshotBuilder
+
+} // namespace cmdb
@@ -0,0 +1,551 @@
+/**
+ * @file Snapshot.h
+ * @brief Объявление неизменяемого версионированного снимка состояния CMDB и построителя новых версий.
+ *
+ * Читатели получают снимок через `CMDB::snapshot()` и работают с ним без блокировок: опубликованный
+ * снимок никогда не изменяется. Писатели собирают следующую версию в `SnapshotBuilder`, после чего
+ * CMDB атомарно публикует результат. Индексы хранятся в персистентных контейнерах (Persistent.h):
+ * изменение копирует только путь к затронутому ключу, поэтому стоимость записи не зависит от
+ * размера базы, а соседние версии разделяют все остальные узлы.
+ *
+ * Данные КЕ и связей разбиты на сегменты (shards) по хешу идентификатора КЕ: сегмент владеет
+ * своими КЕ, их индексом свойств, исходящими связями и обратным индексом для входящих связей.
+ * Упорядоченные индексы КЕ (по идентификатору) и связей (по источнику, цели и типу) позволяют
+ * продолжать постраничный обход с заданного ключа, не просматривая предыдущие элементы.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "CI.h"
+#include "Persistent.h"
+#include "Relationship.h"
+
+namespace cmdb {
+
+/**
+ * @struct RelationshipKey
+ * @brief Ключ упорядочения связей: источник, цель и тип.
+ */
+struct RelationshipKey {
+    std::string source;         ///< Идентификатор исходной КЕ.
+    std::string destination;    ///< Идентификатор целевой КЕ.
+    std::string type;           ///< Тип связи.
+};
+
+/**
+ * @struct RelationshipSource
+ * @brief Ключ поиска всех связей одного источника.
+ */
+struct RelationshipSource {
+    const std::string& id; ///< Идентификатор исходной КЕ.
+};
+
+/**
+ * @struct RelationshipOrderLess
+ * @brief Сравнение связей и ключей связей по (источник, цель, тип).
+ *
+ * Связи с одинаковым ключом различаются адресом объекта, поэтому каждая связь занимает
+ * в упорядоченном индексе свое место и удаляется точно.
+ */
+struct RelationshipOrderLess {
+    using is_transparent = void;
+    using Ptr = std::shared_ptr<const Relationship>;
+
+    static auto key(const Ptr& relationship) {
+        return std::tie(relationship->getSource(), relationship->getDestination(), relationship->getType());
+    }
+
+    static auto key(const RelationshipKey& key) {
+        return std::tie(key.source, key.destination, key.type);
+    }
+
+    bool operator()(const Ptr& a, const Ptr& b) const {
+        auto key_a = key(a);
+        auto key_b = key(b);
+        return key_a < key_b || (!(key_b < key_a) && a.get() < b.get());
+    }
+
+    bool operator()(const Ptr& a, const RelationshipSource& b) const { return a->getSource() < b.id; }
+    bool operator()(const RelationshipSource& a, const Ptr& b) const { return a.id < b->getSource(); }
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        return key(a) < key(b);
+    }
+};
+
+/**
+ * @struct CIOrderLess
+ * @brief Сравнение КЕ и идентификаторов КЕ по идентификатору.
+ */
+struct CIOrderLess {
+    using is_transparent = void;
+
+    static const std::string& key(const std::shared_ptr<const CI>& ci) { return ci->getId(); }
+    static const std::string& key(const std::string& id) { return id; }
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        return key(a) < key(b);
+    }
+};
+
+/**
+ * @class SnapshotShard
+ * @brief Неизменяемое состояние одного сегмента: КЕ, индекс свойств и связи.
+ *
+ * Компоненты - персистентные контейнеры, поэтому копия сегмента занимает O(1), а соседние
+ * версии сегмента разделяют все узлы, которые не менялись между ними.
+ */
+class SnapshotShard {
+public:
+    /**
+     * @brief Тип указателя на неизменяемую конфигурационную единицу.
+     */
+    using CIPtr = std::shared_ptr<const CI>;
+
+    /**
+     * @brief Тип указателя на неизменяемую связь.
+     */
+    using RelationshipPtr = std::shared_ptr<const Relationship>;
+
+    /**
+     * @brief Тип карты идентификаторов КЕ к указателям.
+     */
+    using CIMap = PersistentHashMap<std::string, CIPtr>;
+
+    /**
+     * @brief Тип множества идентификаторов КЕ.
+     */
+    using IdSet = PersistentHashSet<std::string>;
+
+    /**
+     * @brief Тип индекса свойств: имя свойства -> идентификаторы КЕ, у которых оно есть.
+     */
+    using CIPropertyMap = PersistentHashMap<std::string, IdSet>;
+
+    /**
+     * @brief Тип обратного индекса: идентификатор целевой КЕ -> идентификаторы исходных КЕ.
+     */
+    using ReverseIndex = PersistentHashMap<std::string, IdSet>;
+
+    /**
+     * @brief Тип упорядоченного индекса КЕ.
+     */
+    using CIOrder = PersistentTreeSet<CIPtr, CIOrderLess>;
+
+    /**
+     * @brief Тип упорядоченного индекса исходящих связей (он же - связи по источнику).
+     */
+    using RelationshipOrder = PersistentTreeSet<RelationshipPtr, RelationshipOrderLess>;
+
+    /**
+     * @brief Создать пустой сегмент.
+     */
+    SnapshotShard();
+
+    /**
+     * @brief Получить карту КЕ сегмента.
+     */
+    const CIMap& getCIMap() const;
+
+    /**
+     * @brief Получить индекс свойств КЕ сегмента.
+     */
+    const CIPropertyMap& getPropertyMap() const;
+
+    /**
+     * @brief Получить обратный индекс для входящих связей КЕ сегмента.
+     */
+    const ReverseIndex& getReverseIndex() const;
+
+    /**
+     * @brief Получить КЕ сегмента в порядке идентификаторов.
+     */
+    const CIOrder& getCIOrder() const;
+
+    /**
+     * @brief Получить исходящие связи сегмента в порядке (источник, цель, тип).
+     */
+    const RelationshipOrder& getRelationshipOrder() const;
+
+    /**
+     * @brief Найти КЕ сегмента по идентификатору.
+     *
+     * @param id Идентификатор КЕ.
+     * @return Указатель на КЕ или nullptr.
+     */
+    CIPtr getCI(const std::string& id) const;
+
+private:
+    friend class SnapshotBuilder;
+
+    CIMap cis_; ///< КЕ по идентификатору.
+    CIPropertyMap properties_; ///< Индекс свойств.
+    ReverseIndex reverse_index_; ///< Обратный индекс входящих связей.
+    CIOrder ci_order_; ///< КЕ в порядке идентификаторов.
+    RelationshipOrder relationship_order_; ///< Исходящие связи в порядке ключей.
+};
+
+/**
+ * @class Snapshot
+ * @brief Неизменяемая версия состояния CMDB: уровни и набор сегментов.
+ *
+ * Запросы по всем КЕ или связям обходят сегменты по очереди и объединяют результат,
+ * запросы по идентификатору обращаются только к сегменту-владельцу.
+ */
+class Snapshot {
+public:
+    using CIPtr = SnapshotShard::CIPtr;
+    using RelationshipPtr = SnapshotShard::RelationshipPtr;
+    using CIMap = SnapshotShard::CIMap;
+    using IdSet = SnapshotShard::IdSet;
+    using CIPropertyMap = SnapshotShard::CIPropertyMap;
+    using ReverseIndex = SnapshotShard::ReverseIndex;
+    using CIOrder = SnapshotShard::CIOrder;
+    using RelationshipOrder = SnapshotShard::RelationshipOrder;
+
+    /**
+     * @brief Тип списка уровней.
+     */
+    using Levels = std::vector<std::string>;
+
+    /**
+     * @brief Создать пустой снимок нулевого поколения.
+     * @param shard_count Количество сегментов (не меньше одного).
+     */
+    explicit Snapshot(size_t shard_count = 1);
+
+    /**
+     * @brief Получить номер поколения снимка.
+     *
+     * Номер монотонно растет с каждой опубликованной модификацией.
+     */
+    uint64_t getGeneration() const;
+
+    /**
+     * @brief Получить список уровней.
+     */
+    const Levels& getLevels() const;
+
+    /**
+     * @brief Получить количество сегментов.
+     */
+    size_t getShardCount() const;
+
+    /**
+     * @brief Получить сегмент по индексу.
+     */
+    const SnapshotShard& getShard(size_t index) const;
+
+    /**
+     * @brief Индекс сегмента, которому принадлежит КЕ с данным идентификатором.
+     */
+    size_t shardIndex(const std::string& id) const;
+
+    /**
+     * @brief Найти КЕ по идентификатору.
+     *
+     * @param id Идентификатор КЕ.
+     * @return Указатель на КЕ или nullptr.
+     */
+    CIPtr getCI(const std::string& id) const;
+
+    /**
+     * @brief Общее количество КЕ.
+     */
+    size_t getCICount() const;
+
+    /**
+     * @brief Общее количество связей.
+     */
+    size_t getRelationshipCount() const;
+
+    /**
+     * @brief Есть ли хотя бы одна КЕ с указанным свойством.
+     */
+    bool hasProperty(const std::string& property_name) const;
+
+    /**
+     * @brief Идентификаторы КЕ, у которых есть связь, ведущая в указанную КЕ.
+     *
+     * @param to_id Идентификатор целевой КЕ.
+     * @return Указатель на множество или nullptr, если входящих связей нет.
+     */
+    const IdSet* getDependents(const std::string& to_id) const;
+
+    /**
+     * @brief Обойти все КЕ.
+     * @param func Функция, вызываемая для каждого `CIPtr`.
+     */
+    template <typename Func>
+    void forEachCI(Func&& func) const;
+
+    /**
+     * @brief Обойти все связи.
+     * @param func Функция, вызываемая для каждого `RelationshipPtr`.
+     */
+    template <typename Func>
+    void forEachRelationship(Func&& func) const;
+
+    /**
+     * @brief Обойти исходящие связи КЕ.
+     * @param from_id Идентификатор исходной КЕ.
+     * @param func Функция, вызываемая для каждого `RelationshipPtr`.
+     */
+    template <typename Func>
+    void forEachRelationshipFrom(const std::string& from_id, Func&& func) const;
+
+    /**
+     * @brief Обойти КЕ в порядке возрастания идентификатора, начиная после заданного.
+     *
+     * Упорядоченные индексы сегментов объединяются слиянием, поэтому обход начинается сразу
+     * с нужной позиции в каждом сегменте.
+     *
+     * @param after Идентификатор, после которого начинается обход (nullopt - с начала).
+     * @param func Функция, вызываемая для каждого `CIPtr`; возврат false прекращает обход.
+     */
+    template <typename Func>
+    void forEachCIAfter(const std::optional<std::string>& after, Func&& func) const;
+
+    /**
+     * @brief Обойти связи в порядке (источник, цель, тип), начиная после заданного ключа.
+     * @param after Ключ, после которого начинается обход (nullopt - с начала).
+     * @param func Функция, вызываемая для каждого `RelationshipPtr`; возврат false прекращает обход.
+     */
+    template <typename Func>
+    void forEachRelationshipAfter(const std::optional<RelationshipKey>& after, Func&& func) const;
+
+private:
+    friend class SnapshotBuilder;
+
+    uint64_t generation_ = 0; ///< Номер поколения.
+    std::shared_ptr<const Levels> levels_; ///< Уровни.
+    std::vector<std::shared_ptr<const SnapshotShard>> shards_; ///< Сегменты.
+};
+
+/**
+ * @class SnapshotBuilder
+ * @brief Построитель следующей версии снимка.
+ *
+ * Изменение копирует путь к затронутому ключу в персистентных индексах сегмента; узлы,
+ * скопированные построителем, при последующих изменениях правятся на месте. После `build()`
+ * и `rebase()` узлы результата больше не изменяются построителем. Методы построителя
+ * поддерживают согласованность индекса свойств и обратного индекса связей.
+ *
+ * Изменять сегмент (или уровни) можно только под соответствующей блокировкой CMDB:
+ * при публикации измененные части переносятся в самый свежий снимок.
+ */
+class SnapshotBuilder {
+public:
+    /**
+     * @brief Создать построитель на основе опубликованного снимка.
+     * @param base Базовый снимок.
+     */
+    explicit SnapshotBuilder(const std::shared_ptr<const Snapshot>& base);
+
+    ~SnapshotBuilder();
+
+    /**
+     * @brief Текущее состояние построителя (с учетом уже внесенных изменений).
+     */
+    const Snapshot& view() const;
+
+    /**
+     * @brief Были ли внесены изменения.
+     */
+    bool isModified() const;
+
+    /**
+     * @brief Изменяемый список уровней.
+     */
+    Snapshot::Levels& levels();
+
+    /**
+     * @brief Добавить КЕ или заменить КЕ с тем же идентификатором с переиндексацией свойств.
+     * @param ci Новая версия КЕ.
+     */
+    void putCI(Snapshot::CIPtr ci);
+
+    /**
+     * @brief Добавить КЕ, идентификатора которой заведомо нет в снимке (без поиска прежней версии).
+     * @param ci Новая КЕ.
+     */
+    void insertCI(Snapshot::CIPtr ci);
+
+    /**
+     * @brief Удалить КЕ (без связей) и ее свойства из индекса.
+     * @param id Идентификатор КЕ.
+     * @return true, если КЕ была удалена.
+     */
+    bool eraseCI(const std::string& id);
+
+    /**
+     * @brief Добавить связь.
+     * @param relationship Связь.
+     */
+    void addRelationship(Snapshot::RelationshipPtr relationship);
+
+    /**
+     * @brief Удалить одну связь между КЕ.
+     * @param from_id Идентификатор исходной КЕ.
+     * @param to_id Идентификатор целевой КЕ.
+     * @param type Тип связи (если не задан - связь любого типа).
+     * @return true, если связь была удалена.
+     */
+    bool removeRelationship(const std::string& from_id, const std::string& to_id, const std::optional<std::string>& type);
+
+    /**
+     * @brief Удалить все входящие и исходящие связи КЕ.
+     * @param id Идентификатор КЕ.
+     * @return Количество удаленных связей.
+     */
+    size_t removeRelationshipsForId(const std::string& id);
+
+    /**
+     * @brief Перенести изменения вложенного построителя.
+     *
+     * Вложенный построитель должен быть создан из `build()` этого построителя, и сам построитель
+     * не должен изменяться, пока вложенный не перенесен. Так набор изменений можно применить
+     * целиком или отбросить, не затрагивая уже накопленные изменения.
+     *
+     * @param child Вложенный построитель.
+     */
+    void merge(SnapshotBuilder&& child);
+
+    /**
+     * @brief Получить итоговый снимок целиком (все сегменты берутся из построителя).
+     * @param generation Номер поколения нового снимка.
+     * @return Неизменяемый снимок.
+     */
+    std::shared_ptr<const Snapshot> build(uint64_t generation);
+
+    /**
+     * @brief Перенести измененные сегменты и уровни в более свежий снимок.
+     * @param latest Текущий опубликованный снимок.
+     * @param generation Номер поколения нового снимка.
+     * @return Неизменяемый снимок.
+     */
+    std::shared_ptr<const Snapshot> rebase(const Snapshot& latest, uint64_t generation);
+
+private:
+    class ShardBuilder;
+
+    /**
+     * @brief Построитель сегмента с указанным индексом (создается при первом обращении).
+     */
+    ShardBuilder& shard(size_t index);
+
+    /**
+     * @brief Закрепляет собранные сегменты и уровни за результатом: дальнейшие изменения их копируют.
+     */
+    void freeze();
+
+    /**
+     * @brief Построитель сегмента, владеющего КЕ с указанным идентификатором.
+     */
+    ShardBuilder& shardOf(const std::string& id);
+
+    std::shared_ptr<Snapshot> next_; ///< Собираемая версия.
+    std::shared_ptr<Snapshot::Levels> levels_; ///< Собственная копия уровней.
+    bool levels_modified_ = false; ///< Признак изменения уровней (сохраняется после freeze()).
+    std::vector<std::unique_ptr<ShardBuilder>> shards_; ///< Построители затронутых сегментов.
+};
+
+template <typename Func>
+void Snapshot::forEachCI(Func&& func) const {
+    for (const auto& shard : shards_) {
+        for (const auto& [id, ci] : shard->getCIMap()) {
+            func(ci);
+        }
+    }
+}
+
+template <typename Func>
+void Snapshot::forEachRelationship(Func&& func) const {
+    for (const auto& shard : shards_) {
+        for (const auto& relationship : shard->getRelationshipOrder()) {
+            func(relationship);
+        }
+    }
+}
+
+template <typename Func>
+void Snapshot::forEachRelationshipFrom(const std::string& from_id, Func&& func) const {
+    const auto& order = shards_[shardIndex(from_id)]->getRelationshipOrder();
+    auto last = order.upper_bound(RelationshipSource{from_id});
+
+    for (auto it = order.lower_bound(RelationshipSource{from_id}); it != last; ++it) {
+        func(*it);
+    }
+}
+
+template <typename Func>
+void Snapshot::forEachCIAfter(const std::optional<std::string>& after, Func&& func) const {
+    std::vector<std::pair<CIOrder::const_iterator, CIOrder::const_iterator>> heads;
+    heads.reserve(shards_.size());
+
+    for (const auto& shard : shards_) {
+        const auto& order = shard->getCIOrder();
+        auto it = after ? order.upper_bound(*after) : order.begin();
+
+        if (it != order.end()) {
+            heads.emplace_back(it, order.end());
+        }
+    }
+
+    while (!heads.empty()) {
+        auto head = std::min_element(heads.begin(), heads.end(), [](const auto& a, const auto& b) {
+            return (*a.first)->getId() < (*b.first)->getId();
+        });
+
+        if (!func(*head->first)) {
+            return;
+        }
+
+        if (++head->first == head->second) {
+            heads.erase(head);
+        }
+    }
+}
+
+template <typename Func>
+void Snapshot::forEachRelationshipAfter(const std::optional<RelationshipKey>& after, Func&& func) const {
+    std::vector<std::pair<RelationshipOrder::const_iterator, RelationshipOrder::const_iterator>> heads;
+    heads.reserve(shards_.size());
+
+    for (const auto& shard : shards_) {
+        const auto& order = shard->getRelationshipOrder();
+        auto it = after ? order.upper_bound(*after) : order.begin();
+
+        if (it != order.end()) {
+            heads.emplace_back(it, order.end());
+        }
+    }
+
+    RelationshipOrderLess less;
+
+    while (!heads.empty()) {
+        auto head = std::min_element(heads.begin(), heads.end(), [&less](const auto& a, const auto& b) {
+            return less(*a.first, *b.first);
+        });
+
+        if (!func(*head->first)) {
+            return;
+        }
+
+        if (++head->first == head->second) {
+            heads.erase(head);
+        }
+    }
+}
+
+} // namespace cmdb
@@ -0,0 +1,53 @@
+/**
+ * @file Transaction.h
+ * @brief Объявление операций и результата атомарной транзакции CMDB.
+ */
+
+#pragma once
+
+#include <boost/json.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cmdb {
+
+/**
+ * @struct TxOperation
+ * @brief Одна операция транзакции над КЕ или связью.
+ */
+struct TxOperation {
+    /**
+     * @brief Вид операции.
+     */
+    enum class Type {
+        AddCI,              ///< Добавить КЕ.
+        UpdateCI,           ///< Обновить КЕ (по JSON-объекту, как PATCH /ci).
+        RemoveCI,           ///< Удалить КЕ вместе со связями.
+        AddRelationship,    ///< Добавить связь.
+        RemoveRelationship  ///< Удалить связь.
+    };
+
+    Type type = Type::AddCI; ///< Вид операции.
+    std::string id; ///< Идентификатор КЕ (для связи - исходная КЕ).
+    std::string name; ///< Имя КЕ.
+    std::string ci_type; ///< Тип КЕ.
+    int level = 0; ///< Уровень КЕ.
+    std::unordered_map<std::string, std::string> properties; ///< Свойства добавляемой КЕ.
+    boost::json::object update; ///< Изменения КЕ для UpdateCI.
+    std::string to_id; ///< Идентификатор целевой КЕ связи.
+    std::optional<std::string> relationship_type; ///< Тип связи (для удаления - необязательный).
+};
+
+/**
+ * @struct TxResult
+ * @brief Результат транзакции.
+ */
+struct TxResult {
+    bool committed = false; ///< Транзакция зафиксирована целиком.
+    size_t failed_index = 0; ///< Индекс операции, на которой транзакция была отменена.
+    std::vector<std::string> messages; ///< Сообщения по выполненным операциям (последнее - причина отмены).
+};
+
+} // namespace cmdb
@@ -0,0 +1,158 @@
+#include "WritePipeline.h"
+#include <algorithm>
+#include <iostream>
+
+namespace cmdb {
+
+namespace {
+
+/**
+ * @brief Фиктивный узел очереди, никогда не передаваемый писателю.
+ */
+class StubMutation : public WritePipeline::Mutation {
+public:
+    void apply(SnapshotBuilder&) override {}
+    void fail(std::exception_ptr) override {}
+    void acknowledge() override {}
+};
+
+} // namespace
+
+WritePipeline::WritePipeline(Committer committer, size_t max_batch)
+    : committer_(std::move(committer)),
+      max_batch_(std::max<size_t>(max_batch, 1)),
+      stub_(std::make_unique<StubMutation>()),
+      head_(stub_.get()),
+      tail_(stub_.get()) {
+    writer_ = std::thread([this] { writerLoop(); });
+}
+
+WritePipeline::~WritePipeline() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_condition_.notify_one();
+
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+uint64_t WritePipeline::getBatchCount() const {
+    return batches_;
+}
+
+void WritePipeline::enqueue(Mutation* mutation) {
+    mutation->next_.store(nullptr);
+    Mutation* previous = head_.exchange(mutation);
+    previous->next_.store(mutation);
+}
+
+void WritePipeline::push(Mutation* mutation) {
+    enqueue(mutation);
+
+    if (idle_.exchange(false)) {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_condition_.notify_one();
+    }
+}
+
+WritePipeline::Mutation* WritePipeline::pop() {
+    Mutation* tail = tail_;
+    Mutation* next = tail->next_.load();
+
+    if (tail == stub_.get()) {
+        if (!next) {
+            return nullptr;
+        }
+
+        tail_ = next;
+        tail = next;
+        next = next->next_.load();
+    }
+
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+
+    // Производитель уже захватил голову, но еще не связал узел: заберем его позже.
+    if (tail != head_.load()) {
+        return nullptr;
+    }
+
+    enqueue(stub_.get());
+    next = tail->next_.load();
+
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+
+    return nullptr;
+}
+
+void WritePipeline::writerLoop() {
+    Batch batch;
+    batch.reserve(max_batch_);
+
+    while (true) {
+        while (batch.size() < max_batch_) {
+            Mutation* mutation = pop();
+            if (!mutation) {
+                break;
+            }
+
+            batch.push_back(mutation);
+        }
+
+        if (!batch.empty()) {
+            try {
+                committer_(batch);
+            } catch (...) {
+                auto error = std::current_exception();
+
+                try {
+                    std::rethrow_exception(error);
+                } catch (const std::exception& e) {
+                    std::cerr << "Ошибка фиксации пачки модификаций: " << e.what() << std::endl;
+                } catch (...) {
+                    std::cerr << "Ошибка фиксации пачки модификаций" << std::endl;
+                }
+
+                for (Mutation* mutation : batch) {
+                    mutation->fail(error);
+                }
+            }
+
+            ++batches_;
+
+            for (Mutation* mutation : batch) {
+                mutation->acknowledge();
+                delete mutation;
+            }
+
+            batch.clear();
+            continue;
+        }
+
+        if (stop_) {
+            break;
+        }
+
+        idle_ = true;
+
+        if (Mutation* mutation = pop()) {
+            idle_ = false;
+            batch.push_back(mutation);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_condition_.wait(lock, [this] { return !idle_ || stop_; });
+        idle_ = false;
+    }
+}
+
+} // namespace cmdb
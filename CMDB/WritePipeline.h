@@ -0,0 +1,244 @@
+/**
+ * @file WritePipeline.h
+ * @brief Объявление конвейера модификаций CMDB с единственным потоком-писателем.
+ *
+ * Потоки-производители помещают модификации в lock-free очередь MPSC (схема Вьюкова) и получают
+ * `std::future` с результатом. Поток-писатель забирает модификации пачками, применяет пачку к одному
+ * построителю снимка в одной критической секции и подтверждает все модификации пачки после публикации.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "Snapshot.h"
+
+namespace cmdb {
+
+/**
+ * @class WritePipeline
+ * @brief Очередь модификаций с пакетной фиксацией в отдельном потоке.
+ */
+class WritePipeline {
+public:
+    /**
+     * @brief Модификация, ожидающая применения (узел интрузивной очереди).
+     */
+    class Mutation {
+    public:
+        virtual ~Mutation() = default;
+
+        /**
+         * @brief Применить модификацию к построителю (вызывается потоком-писателем).
+         *
+         * Исключение передается вызывающему: функция фиксации отбрасывает изменения модификации
+         * и сообщает о нем через `fail()`.
+         */
+        virtual void apply(SnapshotBuilder& builder) = 0;
+
+        /**
+         * @brief Запомнить ошибку, которую получит ожидающий поток вместо результата.
+         */
+        virtual void fail(std::exception_ptr error) = 0;
+
+        /**
+         * @brief Передать результат ожидающему потоку (после публикации пачки).
+         */
+        virtual void acknowledge() = 0;
+
+    private:
+        friend class WritePipeline;
+
+        std::atomic<Mutation*> next_{nullptr}; ///< Следующий узел очереди.
+    };
+
+    /**
+     * @brief Тип пачки модификаций.
+     */
+    using Batch = std::vector<Mutation*>;
+
+    /**
+     * @brief Тип функции фиксации пачки: применить все модификации и опубликовать результат.
+     *
+     * Если функция завершилась исключением, пачка не опубликована, и каждая ее модификация
+     * подтверждается этой ошибкой.
+     */
+    using Committer = std::function<void(const Batch&)>;
+
+    /**
+     * @brief Максимальный размер пачки по умолчанию.
+     */
+    static constexpr size_t DEFAULT_MAX_BATCH = 256;
+
+    /**
+     * @brief Запустить поток-писатель.
+     * @param committer Функция фиксации пачки.
+     * @param max_batch Максимальное количество модификаций в пачке.
+     */
+    WritePipeline(Committer committer, size_t max_batch = DEFAULT_MAX_BATCH);
+
+    /**
+     * @brief Остановить поток-писатель, предварительно применив все поставленные модификации.
+     */
+    ~WritePipeline();
+
+    WritePipeline(const WritePipeline&) = delete;
+    WritePipeline& operator=(const WritePipeline&) = delete;
+
+    /**
+     * @brief Поставить модификацию в очередь.
+     *
+     * @param apply Функция, принимающая `SnapshotBuilder&` и возвращающая результат модификации.
+     * @return Future, который становится готовым после публикации пачки с этой модификацией.
+     */
+    template <typename Apply>
+    auto submit(Apply apply) -> std::future<decltype(apply(std::declval<SnapshotBuilder&>()))>;
+
+    /**
+     * @brief Поставить модификацию в очередь с уведомлением о фиксации.
+     *
+     * Вызывающий поток не ждет: `callback(error, result)` вызывается потоком-писателем после
+     * публикации пачки с этой модификацией, поэтому он должен быть коротким (например, передавать
+     * результат в цикл событий).
+     *
+     * @param apply Функция, принимающая `SnapshotBuilder&` и возвращающая результат модификации.
+     * @param callback Функция `void(std::exception_ptr, Result)`.
+     */
+    template <typename Apply, typename Callback>
+    void submit(Apply apply, Callback callback);
+
+    /**
+     * @brief Количество зафиксированных пачек.
+     */
+    uint64_t getBatchCount() const;
+
+private:
+    template <typename Apply, typename Result>
+    class TypedMutation;
+
+    template <typename Apply, typename Result, typename Callback>
+    class CallbackMutation;
+
+    /**
+     * @brief Связать узел с очередью (безопасно для нескольких производителей).
+     */
+    void enqueue(Mutation* mutation);
+
+    /**
+     * @brief Добавить узел в очередь и разбудить писателя, если он спит.
+     */
+    void push(Mutation* mutation);
+
+    /**
+     * @brief Извлечь узел из очереди (только поток-писатель).
+     * @return Узел или nullptr, если очередь пуста.
+     */
+    Mutation* pop();
+
+    /**
+     * @brief Цикл потока-писателя.
+     */
+    void writerLoop();
+
+    Committer committer_; ///< Функция фиксации пачки.
+    size_t max_batch_; ///< Максимальный размер пачки.
+
+    std::unique_ptr<Mutation> stub_; ///< Фиктивный узел очереди.
+    std::atomic<Mutation*> head_; ///< Последний добавленный узел (сторона производителей).
+    Mutation* tail_; ///< Следующий извлекаемый узел (сторона писателя).
+
+    std::atomic<bool> idle_{false}; ///< Писатель собирается заснуть или спит.
+    std::atomic<bool> stop_{false}; ///< Флаг остановки.
+    std::atomic<uint64_t> batches_{0}; ///< Количество зафиксированных пачек.
+    std::mutex wake_mutex_; ///< Мьютекс для пробуждения писателя.
+    std::condition_variable wake_condition_; ///< Условная переменная для пробуждения писателя.
+    std::thread writer_; ///< Поток-писатель.
+};
+
+/**
+ * @brief Модификация с типизированным результатом.
+ */
+template <typename Apply, typename Result>
+class WritePipeline::TypedMutation : public WritePipeline::Mutation {
+public:
+    explicit TypedMutation(Apply apply) : apply_(std::move(apply)) {}
+
+    std::future<Result> getFuture() { return promise_.get_future(); }
+
+    void apply(SnapshotBuilder& builder) override {
+        result_ = apply_(builder);
+    }
+
+    void fail(std::exception_ptr error) override {
+        error_ = std::move(error);
+    }
+
+    void acknowledge() override {
+        if (error_) {
+            promise_.set_exception(error_);
+        } else {
+            promise_.set_value(std::move(result_));
+        }
+    }
+
+private:
+    Apply apply_; ///< Модификация.
+    Result result_{}; ///< Результат модификации.
+    std::exception_ptr error_; ///< Исключение, возникшее при применении.
+    std::promise<Result> promise_; ///< Обещание для ожидающего потока.
+};
+
+/**
+ * @brief Модификация, результат которой передается функции обратного вызова.
+ */
+template <typename Apply, typename Result, typename Callback>
+class WritePipeline::CallbackMutation : public WritePipeline::Mutation {
+public:
+    CallbackMutation(Apply apply, Callback callback) : apply_(std::move(apply)), callback_(std::move(callback)) {}
+
+    void apply(SnapshotBuilder& builder) override {
+        result_ = apply_(builder);
+    }
+
+    void fail(std::exception_ptr error) override {
+        error_ = std::move(error);
+    }
+
+    void acknowledge() override {
+        callback_(error_, std::move(result_));
+    }
+
+private:
+    Apply apply_; ///< Модификация.
+    Callback callback_; ///< Получатель результата.
+    Result result_{}; ///< Результат модификации.
+    std::exception_ptr error_; ///< Исключение, возникшее при применении.
+};
+
+template <typename Apply>
+auto WritePipeline::submit(Apply apply) -> std::future<decltype(apply(std::declval<SnapshotBuilder&>()))> {
+    using Result = decltype(apply(std::declval<SnapshotBuilder&>()));
+
+    auto mutation = std::make_unique<TypedMutation<Apply, Result>>(std::move(apply));
+    auto future = mutation->getFuture();
+    push(mutation.release());
+
+    return future;
+}
+
+template <typename Apply, typename Callback>
+void WritePipeline::submit(Apply apply, Callback callback) {
+    using Result = decltype(apply(std::declval<SnapshotBuilder&>()));
+
+    push(new CallbackMutation<Apply, Result, Callback>(std::move(apply), std::move(callback)));
+}
+
+} // namespace cmdb
@@ -1,7 +1,30 @@
 #include "RequestHandler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
 #include "../View/ResponseFormatter.h"
 
+RequestHandler::RequestHandler(DataStore& store, const ResponseCacheConfig& cache,
+                               const CompressionConfig& compression)
+    : store_(store),
+      cache_(cache),
+      compression_(compression) {
+    std::ostringstream instance;
+    instance << std::hex << std::chrono::system_clock::now().time_since_epoch().count();
+    instance_ = instance.str();
+}
+
 void RequestHandler::handleRequest(http::request<http::string_body>& req, http::response<http::string_body>& res) {
+    std::unique_ptr<BodyStream> body;
+
+    if (handleRead(req, res, body)) {
+        if (body) {
+            ResponseFormatter::makeBodyResponse(res, *body);
+        }
+        return;
+    }
+
     std::string_view target = req.target();
     std::string_view api_path = "/api/v1/data";
 
@@ -59,17 +82,410 @@ void RequestHandler::handleRequest(http::request<http::string_body>& req, http::
             } else {
                 ResponseFormatter::makeErrorResponse(res, http::status::method_not_allowed, "Метод не разрешен");
             }
+        } else if (sub_target == "/tx") {
+            if (req.method() == http::verb::post) {
+                handleTransaction(req, res);
+            } else {
+                ResponseFormatter::makeErrorResponse(res, http::status::method_not_allowed, "Метод не разрешен");
+            }
         } else {
             ResponseFormatter::makeErrorResponse(res, http::status::not_found, "Not found");
         }
     } else {
         ResponseFormatter::makeErrorResponse(res, http::status::no_content, "Hello, from the Server!");
     }
+
+    encodeResponse(req, res);
+    compressResponse(req, res);
+}
+
+void RequestHandler::handleRequest(http::request<http::string_body>& req, http::response<http::string_body>& res,
+                                   std::function<void()> done, Dispatch dispatch) {
+    auto route = apiRoute(req);
+
+    if (route && *route == "/tx" && req.method() == http::verb::post) {
+        handleTransaction(req, res, [this, &req, &res, done = std::move(done)]() {
+            encodeResponse(req, res);
+            compressResponse(req, res);
+            done();
+        }, std::move(dispatch));
+        return;
+    }
+
+    handleRequest(req, res);
+    done();
+}
+
+bool RequestHandler::handleRead(http::request<http::string_body>& req, http::response<http::string_body>& res,
+                                std::unique_ptr<BodyStream>& body) {
+    auto route = apiRoute(req);
+
+    if (!route || (*route != "/all" && *route != "/ci" && *route != "/relationship")) {
+        return false;
+    }
+
+    // HEAD - проверка существования CI или связей по тем же фильтрам, что и у GET
+    bool head = req.method() == http::verb::head && *route != "/all";
+
+    if (req.method() != http::verb::get && !head) {
+        return false;
+    }
+
+    uint64_t generation = store_.getGeneration();
+    auto encoding = acceptedEncoding(req);
+    auto format = acceptedFormat(req);
+    std::string etag = makeETag(generation, encoding, format);
+
+    res.set(http::field::vary, varyHeader());
+
+    std::map<std::string, std::string> query_params = getQueryParams(req);
+    std::string_view if_none_match = req[http::field::if_none_match];
+    bool not_modified = matchesETag(if_none_match, etag, false);
+
+    // "*" совпадает, только если текущее представление есть: для /ci и /relationship - непустая выборка
+    if (!not_modified && matchesETag(if_none_match, etag, true)) {
+        not_modified = *route == "/all" || selectionExists(*route, query_params);
+    }
+
+    if (not_modified) {
+        ResponseFormatter::makeNotModifiedResponse(res, etag);
+        return true;
+    }
+
+    auto count = query_params.find("count");
+
+    if (head || (count != query_params.end() && *route != "/all")) {
+        // Ответ строится по размерам индексов или счетом без выборки объектов
+        bool only_count = !head;
+        if (count != query_params.end()) {
+            only_count = only_count && count->second == "true";
+            query_params.erase(count);
+        }
+
+        try {
+            if (!head && !only_count) {
+                throw std::invalid_argument("Не корректный count");
+            }
+
+            size_t limit = head ? 1 : std::numeric_limits<size_t>::max();
+            size_t total = *route == "/ci" ? store_.countCi(query_params, limit)
+                                           : store_.countRelationships(query_params, limit);
+
+            if (head) {
+                ResponseFormatter::makeExistsResponse(res, total > 0, etag, format);
+                return true;
+            }
+
+            ResponseFormatter::makeJSONResponse(res, json::object{{"count", total}});
+        } catch (const std::invalid_argument& e) {
+            ResponseFormatter::makeErrorResponse(res, http::status::bad_request, e.what());
+            encodeResponse(req, res);
+            return true;
+        }
+
+        encodeResponse(req, res);
+        compressResponse(req, res);
+
+        // Короткий ответ может остаться несжатым, и ETag должен соответствовать его кодированию
+        if (!res.count(http::field::content_encoding)) {
+            etag = makeETag(generation, Compressor::Encoding::Identity, format);
+        }
+        res.set(http::field::etag, etag);
+        return true;
+    }
+
+    if (encoding != Compressor::Encoding::Identity) {
+        res.set(http::field::content_encoding, Compressor::name(encoding));
+    }
+
+    if (exporter_ && *route == "/all" && query_params.empty() && format == WireFormat::Json) {
+        if (auto file = exporter_->current(generation, encoding)) {
+            ResponseFormatter::makeFileResponse(res, file->size());
+            res.set(http::field::etag, etag);
+            body = std::make_unique<FileStream>(std::move(file));
+            return true;
+        }
+    }
+
+    std::string key(*route);
+
+    for (const auto& [name, value] : query_params) {
+        key += key.size() == route->size() ? '?' : '&';
+        key += name;
+        key += '=';
+        key += value;
+    }
+
+    if (format == WireFormat::Cbor) {
+        key += "#cbor";
+    }
+
+    if (encoding != Compressor::Encoding::Identity) {
+        key += '#';
+        key += Compressor::name(encoding);
+    }
+
+    if (auto cached = cache_.get(key, generation)) {
+        ResponseFormatter::makeJSONResponse(res, *cached);
+        res.set(http::field::content_type, ResponseFormatter::contentType(format));
+        res.set(http::field::etag, etag);
+        return true;
+    }
+
+    try {
+        if (*route == "/all") {
+            body = store_.streamAllRecords(format);
+        } else {
+            // limit, cursor и fields задают страницу и проекцию и не участвуют в отборе
+            PageRequest page;
+            FieldSet fields;
+            auto limit = query_params.find("limit");
+            auto cursor = query_params.find("cursor");
+            auto projection = query_params.find("fields");
+
+            if (limit != query_params.end()) {
+                if (limit->second.empty() || limit->second.size() > 9 ||
+                    limit->second.find_first_not_of("0123456789") != std::string::npos) {
+                    throw std::invalid_argument("Не корректный limit");
+                }
+                page.limit = std::stoul(limit->second);
+                if (page.limit == 0) {
+                    throw std::invalid_argument("Не корректный limit");
+                }
+                query_params.erase(limit);
+            }
+
+            if (cursor != query_params.end()) {
+                page.cursor = cursor->second;
+                page.limit = page.limit > 0 ? page.limit : DEFAULT_PAGE_LIMIT;
+                query_params.erase(cursor);
+            }
+
+            if (projection != query_params.end()) {
+                fields = *route == "/ci" ? FieldSet::parseCI(projection->second)
+                                         : FieldSet::parseRelationship(projection->second);
+                query_params.erase(projection);
+            }
+
+            if (*route == "/ci") {
+                body = store_.streamCi(query_params, page, fields, format);
+            } else {
+                body = store_.streamRelationships(query_params, page, fields, format);
+            }
+        }
+    } catch (const std::invalid_argument& e) {
+        res.erase(http::field::content_encoding);
+        ResponseFormatter::makeErrorResponse(res, http::status::bad_request, e.what());
+        encodeResponse(req, res);
+        return true;
+    }
+
+    if (!body) {
+        // Пустая выборка: ответ 404 строится сразу, без повторного запроса в handleRequest
+        res.erase(http::field::content_encoding);
+        res.erase(http::field::vary);
+        ResponseFormatter::makeErrorResponse(res, http::status::not_found, "Не найдено");
+        encodeResponse(req, res);
+        return true;
+    }
+
+    if (encoding != Compressor::Encoding::Identity) {
+        body = std::make_unique<CompressingStream>(std::move(body), encoding, compression_.level);
+    }
+
+    if (cache_.enabled()) {
+        body = std::make_unique<CachingStream>(std::move(body), cache_, std::move(key), generation);
+    }
+
+    ResponseFormatter::makeStreamResponse(res, format);
+    res.set(http::field::etag, etag);
+
+    return true;
+}
+
+ResponseCache& RequestHandler::cache() {
+    return cache_;
+}
+
+void RequestHandler::setExporter(const Exporter* exporter) {
+    exporter_ = exporter;
+}
+
+std::string RequestHandler::makeETag(uint64_t generation, Compressor::Encoding encoding, WireFormat format) const {
+    std::string etag = "\"" + instance_ + "-" + std::to_string(generation);
+
+    if (format == WireFormat::Cbor) {
+        etag += "-cbor";
+    }
+
+    if (encoding != Compressor::Encoding::Identity) {
+        etag += '-';
+        etag += Compressor::name(encoding);
+    }
+
+    return etag + "\"";
+}
+
+Compressor::Encoding RequestHandler::acceptedEncoding(const http::request<http::string_body>& req) const {
+    if (compression_.level <= 0) {
+        return Compressor::Encoding::Identity;
+    }
+
+    return Compressor::negotiate(req[http::field::accept_encoding]);
+}
+
+WireFormat RequestHandler::acceptedFormat(const http::request<http::string_body>& req) {
+    return CborWriter::accepted(req[http::field::accept]) ? WireFormat::Cbor : WireFormat::Json;
+}
+
+const char* RequestHandler::varyHeader() const {
+    return compression_.level > 0 ? "Accept, Accept-Encoding" : "Accept";
+}
+
+json::value RequestHandler::parseBody(const http::request<http::string_body>& req) {
+    std::string_view content_type = req[http::field::content_type];
+
+    if (content_type.substr(0, content_type.find(';')) == ResponseFormatter::contentType(WireFormat::Cbor)) {
+        return CborReader::decode(req.body());
+    }
+
+    return json::parse(req.body());
+}
+
+void RequestHandler::encodeResponse(const http::request<http::string_body>& req,
+                                    http::response<http::string_body>& res) const {
+    if (res[http::field::content_type] != ResponseFormatter::contentType(WireFormat::Json) ||
+        res.count(http::field::content_encoding)) {
+        return;
+    }
+
+    res.set(http::field::vary, varyHeader());
+
+    if (acceptedFormat(req) != WireFormat::Cbor) {
+        return;
+    }
+
+    res.body() = CborWriter::encode(json::parse(res.body()));
+    res.set(http::field::content_type, ResponseFormatter::contentType(WireFormat::Cbor));
+    res.prepare_payload();
+}
+
+void RequestHandler::compressResponse(const http::request<http::string_body>& req,
+                                      http::response<http::string_body>& res) const {
+    if (compression_.level <= 0 || res.body().size() < std::max<size_t>(compression_.min_size, 1) ||
+        res.count(http::field::content_encoding)) {
+        return;
+    }
+
+    auto encoding = acceptedEncoding(req);
+    res.set(http::field::vary, varyHeader());
+
+    if (encoding == Compressor::Encoding::Identity) {
+        return;
+    }
+
+    res.body() = Compressor::compress(res.body(), encoding, compression_.level);
+    res.set(http::field::content_encoding, Compressor::name(encoding));
+    res.prepare_payload();
+}
+
+bool RequestHandler::selectionExists(std::string_view route, std::map<std::string, std::string> filters) {
+    for (const char* name : {"limit", "cursor", "fields", "count"}) {
+        filters.erase(name);
+    }
+
+    try {
+        return (route == "/ci" ? store_.countCi(filters, 1) : store_.countRelationships(filters, 1)) > 0;
+    } catch (const std::invalid_argument&) {
+        // Ошибку в фильтрах сообщит обычная обработка запроса
+        return false;
+    }
+}
+
+bool RequestHandler::matchesETag(std::string_view if_none_match, std::string_view etag, bool any) {
+    while (!if_none_match.empty()) {
+        size_t comma = if_none_match.find(',');
+        std::string_view tag = if_none_match.substr(0, comma);
+        if_none_match = comma == std::string_view::npos ? std::string_view() : if_none_match.substr(comma + 1);
+
+        size_t first = tag.find_first_not_of(" \t");
+        if (first == std::string_view::npos) {
+            continue;
+        }
+        tag = tag.substr(first, tag.find_last_not_of(" \t") - first + 1);
+
+        if (tag.substr(0, 2) == "W/") {
+            tag.remove_prefix(2);
+        }
+
+        if ((any && tag == "*") || tag == etag) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::optional<std::string_view> RequestHandler::apiRoute(const http::request<http::string_body>& req) {
+    std::string_view target = req.target();
+    std::string_view api_path = "/api/v1/data";
+
+    if (target.substr(0, api_path.size()) != api_path) {
+        return std::nullopt;
+    }
+
+    std::string_view sub_target = target.substr(api_path.size());
+
+    return sub_target.substr(0, sub_target.find('?'));
+}
+
+RequestHandler::Priority RequestHandler::classify(const http::request<http::string_body>& req) {
+    auto route = apiRoute(req);
+
+    if (!route) {
+        return Interactive;
+    }
+
+    std::string_view target = req.target();
+    std::string_view sub_target = *route;
+    size_t query_start = target.find('?');
+    std::string_view query = query_start == std::string_view::npos ? std::string_view() : target.substr(query_start + 1);
+
+    if (req.method() == http::verb::head) {
+        return Interactive;
+    }
+
+    if (req.method() == http::verb::get) {
+        if (sub_target == "/all") {
+            return Batch;
+        }
+
+        bool by_id = query.substr(0, 3) == "id=" || query.find("&id=") != std::string_view::npos;
+        bool count = ("&" + std::string(query) + "&").find("&count=true&") != std::string::npos;
+
+        if (sub_target == "/level" || sub_target == "/props" || (sub_target == "/ci" && by_id) || count) {
+            return Interactive;
+        }
+
+        return Normal;
+    }
+
+    if (sub_target == "/tx") {
+        return Batch;
+    }
+
+    const std::string& body = req.body();
+    size_t first = body.find_first_not_of(" \t\r\n");
+
+    if (first != std::string::npos && body[first] == '[') {
+        return Batch;
+    }
+
+    return Normal;
 }
 
 void RequestHandler::handleGetAll(http::response<http::string_body>& res) {
-    json::object records = store_.getAllRecords();
-    ResponseFormatter::makeJSONResponse(res, records);
+    ResponseFormatter::makeJSONResponse(res, *store_.streamAllRecords());
 }
 
 void RequestHandler::handleGetLevel(http::request<http::string_body>& req, http::response<http::string_body>& res) {
@@ -96,10 +512,10 @@ void RequestHandler::handleGetLevel(http::request<http::string_body>& req, http:
 
 void RequestHandler::handleGetCi(http::request<http::string_body>& req, http::response<http::string_body>& res) {
     std::map<std::string, std::string> query_params = getQueryParams(req);
-    json::array cis = store_.getCi(query_params);
+    auto cis = store_.streamCi(query_params);
 
-    if (!cis.empty()) {
-        ResponseFormatter::makeJSONResponse(res, cis);
+    if (cis) {
+        ResponseFormatter::makeJSONResponse(res, *cis);
     } else {
         ResponseFormatter::makeErrorResponse(res, http::status::not_found, "Не найдено");
     }
@@ -108,10 +524,10 @@ void RequestHandler::handleGetCi(http::request<http::string_body>& req, http::re
 void RequestHandler::handleGetRelationships(http::request<http::string_body>& req, http::response<http::string_body>& res) {
     std::map<std::string, std::string> query_params =getQueryParams(req);
 
-    json::array relationships = store_.getRelationships(query_params);
+    auto relationships = store_.streamRelationships(query_params);
 
-    if (!relationships.empty()) {
-        ResponseFormatter::makeJSONResponse(res, relationships);
+    if (relationships) {
+        ResponseFormatter::makeJSONResponse(res, *relationships);
     } else {
         ResponseFormatter::makeErrorResponse(res, http::status::not_found, "Не найдено");
     }
@@ -119,7 +535,7 @@ void RequestHandler::handleGetRelationships(http::request<http::string_body>& re
 
 void RequestHandler::handleAddLevel(http::request<http::string_body>& req, http::response<http::string_body>& res) {
     try {
-        auto json_data = json::parse(req.body()).as_object();
+        auto json_data = parseBody(req).as_object();
         auto result = store_.addLevel(json_data);
 
         if (isResultSuccess(result)) {
@@ -135,7 +551,7 @@ void RequestHandler::handleAddLevel(http::request<http::string_body>& req, http:
 
 void RequestHandler::handleAddCi(http::request<http::string_body>& req, http::response<http::string_body>& res) {
     try {
-        auto json_data = json::parse(req.body());
+        auto json_data = parseBody(req);
         boost::json::object result;
 
         if (json_data.is_array()) {
@@ -161,7 +577,7 @@ void RequestHandler::handleAddCi(http::request<http::string_body>& req, http::re
 
 void RequestHandler::handleAddRelationships(http::request<http::string_body>& req, http::response<http::string_body>& res) {
     try {
-        auto json_data = json::parse(req.body());
+        auto json_data = parseBody(req);
         boost::json::object result;
 
         if (json_data.is_array()) {
@@ -237,7 +653,7 @@ void RequestHandler::handleDeleteRelationships(http::request<http::string_body>&
 
 void RequestHandler::handleUpdateCi(http::request<http::string_body>& req, http::response<http::string_body>& res) {
     try {
-        auto json_data = json::parse(req.body());
+        auto json_data = parseBody(req);
         boost::json::object result;
 
         if (json_data.is_array()) {
@@ -262,7 +678,7 @@ void RequestHandler::handleUpdateCi(http::request<http::string_body>& req, http:
 }
 
 void RequestHandler::handleUpdateLevel(http::request<http::string_body>& req, http::response<http::string_body>& res) {
-    auto json_data = json::parse(req.body()).as_object();
+    auto json_data = parseBody(req).as_object();
     auto result = store_.updateLevel(json_data);
 
     if (isResultSuccess(result)) {
@@ -273,6 +689,79 @@ void RequestHandler::handleUpdateLevel(http::request<http::string_body>& req, ht
 
 }
 
+void RequestHandler::handleTransaction(http::request<http::string_body>& req, http::response<http::string_body>& res) {
+    try {
+        auto json_data = parseBody(req);
+        auto result = store_.applyTransaction(json_data);
+
+        makeTransactionResponse(result, res);
+    } catch (const std::exception& e) {
+        ResponseFormatter::makeErrorResponse(res, http::status::bad_request, e.what());
+    } catch (...) {
+        ResponseFormatter::makeErrorResponse(res, http::status::bad_request, "Не корректный JSON");
+    }
+}
+
+void RequestHandler::handleTransaction(http::request<http::string_body>& req, http::response<http::string_body>& res,
+                                       std::function<void()> done, Dispatch dispatch) {
+    json::value json_data;
+
+    try {
+        json_data = parseBody(req);
+    } catch (const std::exception& e) {
+        ResponseFormatter::makeErrorResponse(res, http::status::bad_request, e.what());
+        done();
+        return;
+    }
+
+    // Ошибка до передачи результата отвечает 400, как и в синхронной обработке
+    auto answered = std::make_shared<std::atomic<bool>>(false);
+
+    try {
+        // Поток-писатель только передает результат, ответ формируется через dispatch
+        store_.applyTransaction(json_data, [&res, answered, done, dispatch = std::move(dispatch)](json::object result) {
+            answered->store(true);
+
+            auto finish = [&res, done, result = std::move(result)]() mutable {
+                makeTransactionResponse(result, res);
+                done();
+            };
+
+            if (dispatch) {
+                dispatch(std::move(finish));
+            } else {
+                finish();
+            }
+        });
+    } catch (const std::exception& e) {
+        if (answered->load()) {
+            throw;
+        }
+
+        ResponseFormatter::makeErrorResponse(res, http::status::bad_request, e.what());
+        done();
+    }
+}
+
+void RequestHandler::makeTransactionResponse(json::object& result, http::response<http::string_body>& res) {
+    if (isResultSuccess(result)) {
+        ResponseFormatter::makeJSONResponse(res, result);
+        return;
+    }
+
+    std::string message = "Транзакция отменена";
+
+    if (result.contains("failed_index")) {
+        message += ": операция " + std::to_string(result.at("failed_index").as_int64());
+    }
+
+    if (result.contains("message")) {
+        message += ": " + boost::json::value_to<std::string>(result.at("message"));
+    }
+
+    ResponseFormatter::makeErrorResponse(res, http::status::bad_request, message);
+}
+
 std::map<std::string, std::string> RequestHandler::getQueryParams(http::request<http::string_body>& req) {
     std::map<std::string, std::string> query_params;
     std::string_view target = req.target();
@@ -294,7 +783,7 @@ std::map<std::string, std::string> RequestHandler::getQueryParams(http::request<
     return query_params;
 }
 
-bool RequestHandler::isResultSuccess(json::object& result) {
+bool RequestHandler::isResultSuccess(const json::object& result) {
     if (!result.contains("status")) {
         return true;
     }
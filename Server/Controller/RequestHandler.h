@@ -7,24 +7,66 @@
 
 #include <boost/beast/http.hpp>
 #include <boost/asio.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <sstream>
+#include <string_view>
 #include <map>
 #include "../Model/DataStore.h"
+#include "../Model/Exporter.h"
+#include "ResponseCache.h"
+#include "../View/Compressor.h"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace net = boost::asio;
 
 /**
  * @class RequestHandler
  * @brief Класс, обрабатывающий входящие HTTP-запросы и взаимодействующий с хранилищем данных (DataStore).
+ *
+ * Ответы на чтение GET /all, /ci и /relationship помечаются ETag из поколения CMDB. Запрос
+ * с совпадающим If-None-Match получает 304 без обращения к данным, а тела ответов текущего
+ * поколения отдаются из LRU-кэша (ResponseCache). Если подключена выгрузка (Exporter) и ее
+ * поколение текущее, GET /all без параметров отдается из готового файла выгрузки.
+ *
+ * Если клиент принимает gzip или deflate (Accept-Encoding), ответы сжимаются: потоковые - по мере
+ * передачи, остальные - целиком, если тело не меньше min_size. Кэш и выгрузка хранят ответы
+ * уже сжатыми, а ETag различает кодирования.
  */
 class RequestHandler {
 public:
+    /**
+     * @enum Priority
+     * @brief Класс запроса для выбора полосы пула обработчиков (значение - номер полосы).
+     */
+    enum Priority : size_t {
+        Interactive = 0,  ///< Точечные чтения: CI по id, уровень, свойства.
+        Normal = 1,       ///< Выборки с фильтрами и одиночные модификации.
+        Batch = 2,        ///< Полная выгрузка, транзакции и пакетные добавления.
+    };
+
+    static constexpr size_t PRIORITY_COUNT = 3; ///< Количество классов запросов.
+
+    static constexpr size_t DEFAULT_PAGE_LIMIT = 50; ///< Размер страницы, если передан только cursor.
+
+    /**
+     * @brief Определение класса запроса по маршруту, методу и телу.
+     * @param req HTTP-запрос.
+     * @return Класс запроса.
+     */
+    static Priority classify(const http::request<http::string_body>& req);
+
     /**
      * @brief Конструктор.
      * @param store Ссылка на объект DataStore для доступа к данным.
+     * @param cache Параметры кэша ответов на чтение.
+     * @param compression Параметры сжатия ответов.
      */
-    explicit RequestHandler(DataStore& store) : store_(store) {}
+    explicit RequestHandler(DataStore& store, const ResponseCacheConfig& cache = {},
+                            const CompressionConfig& compression = {});
 
     /**
      * @brief Основной метод обработки запроса.
@@ -33,6 +75,93 @@ public:
      */
     void handleRequest(http::request<http::string_body>& req, http::response<http::string_body>& res);
 
+    /**
+     * @brief Функция, выполняющая переданный шаг обработки в потоке вызывающей стороны.
+     */
+    using Dispatch = std::function<void(std::function<void()>)>;
+
+    /**
+     * @brief Обработка запроса без ожидания фиксации модификаций в вызывающем потоке.
+     *
+     * Транзакции (POST /tx) передаются конвейеру модификаций CMDB. Поток-писатель только
+     * передает результат фиксации: формирование, кодирование и сжатие ответа и вызов `done`
+     * выполняются через `dispatch` (без него - в потоке-писателе). Остальные запросы
+     * обрабатываются синхронно и `done` вызывается до возврата. Без конвейера все запросы
+     * обрабатываются синхронно.
+     *
+     * @param req HTTP-запрос (должен существовать до вызова `done`).
+     * @param res HTTP-ответ (должен существовать до вызова `done`).
+     * @param done Функция завершения.
+     * @param dispatch Исполнитель завершающего шага транзакции.
+     */
+    void handleRequest(http::request<http::string_body>& req, http::response<http::string_body>& res,
+                       std::function<void()> done, Dispatch dispatch = {});
+
+    /**
+     * @brief Асинхронная обработка запроса в стиле Asio.
+     *
+     * Принимает любой маркер завершения с сигнатурой `void()`: функцию обратного вызова,
+     * `net::use_future` или, в сборке с C++20, `net::use_awaitable`
+     * (`co_await handler.asyncHandleRequest(req, res, net::use_awaitable)`). Обработчик
+     * завершения и формирование ответа на транзакцию выполняются через связанный с ним исполнитель.
+     *
+     * @param req HTTP-запрос.
+     * @param res HTTP-ответ.
+     * @param token Маркер завершения.
+     */
+    template <class CompletionToken>
+    auto asyncHandleRequest(http::request<http::string_body>& req, http::response<http::string_body>& res,
+                            CompletionToken&& token) {
+        return net::async_initiate<CompletionToken, void()>(
+            [this, &req, &res](auto handler) {
+                using Handler = decltype(handler);
+
+                auto executor = net::get_associated_executor(handler);
+                auto shared = std::make_shared<Handler>(std::move(handler));
+
+                handleRequest(req, res,
+                    [executor, shared]() {
+                        net::post(executor, std::move(*shared));
+                    },
+                    [executor](std::function<void()> step) {
+                        net::post(executor, std::move(step));
+                    });
+            },
+            token);
+    }
+
+    /**
+     * @brief Обработка запросов на чтение GET /all, GET /ci и GET /relationship.
+     *
+     * Если If-None-Match совпадает с ETag текущего поколения, формирует ответ 304. Если ответ
+     * есть в кэше, формирует его целиком. Для GET /all с готовой выгрузкой текущего поколения
+     * заполняет заголовки (Content-Length) и возвращает в body источник из файла выгрузки. Иначе для непустого результата заполняет заголовки
+     * (Transfer-Encoding: chunked) и возвращает в body источник, который сериализует данные
+     * по частям во время записи и сохраняет результат в кэш; на пустую выборку сразу формирует ответ 404. Параметры limit и cursor у /ci и
+     * /relationship задают страницу, fields - выдаваемые поля; некорректные значения дают
+     * ответ 400. С count=true у /ci и /relationship ответ - `{"count":N}`, а HEAD отвечает
+     * 200 или 404 без тела; в обоих случаях объекты не выбираются. Для остальных запросов
+     * ответ не изменяется.
+     *
+     * @param req HTTP-запрос.
+     * @param res HTTP-ответ.
+     * @param body Источник тела потокового ответа (nullptr, если тело уже в res).
+     * @return true, если ответ подготовлен; false, если запрос нужно обработать через handleRequest.
+     */
+    bool handleRead(http::request<http::string_body>& req, http::response<http::string_body>& res,
+                    std::unique_ptr<BodyStream>& body);
+
+    /**
+     * @brief Кэш ответов на чтение.
+     */
+    ResponseCache& cache();
+
+    /**
+     * @brief Подключает файл полной выгрузки для ответов на GET /all.
+     * @param exporter Выгрузка (nullptr - отключить; должна пережить обработчик или быть отключена).
+     */
+    void setExporter(const Exporter* exporter);
+
 private:
     /**
      * @brief Обработка запроса получения всех данных.
@@ -94,6 +223,73 @@ private:
      */
     void handleUpdateLevel(http::request<http::string_body>& req, http::response<http::string_body>& res);
 
+    /**
+     * @brief Обработка запроса на атомарное выполнение набора операций.
+     */
+    void handleTransaction(http::request<http::string_body>& req, http::response<http::string_body>& res);
+
+    /**
+     * @brief Обработка запроса на атомарное выполнение набора операций без ожидания фиксации.
+     */
+    void handleTransaction(http::request<http::string_body>& req, http::response<http::string_body>& res,
+                           std::function<void()> done, Dispatch dispatch);
+
+    /**
+     * @brief Формирование ответа по результату транзакции.
+     */
+    static void makeTransactionResponse(json::object& result, http::response<http::string_body>& res);
+
+    /**
+     * @brief Путь запроса внутри API без параметров (nullopt, если запрос не к API).
+     */
+    static std::optional<std::string_view> apiRoute(const http::request<http::string_body>& req);
+
+    /**
+     * @brief ETag ответа для поколения CMDB (включает метку запуска процесса, кодирование и формат).
+     */
+    std::string makeETag(uint64_t generation, Compressor::Encoding encoding, WireFormat format) const;
+
+    /**
+     * @brief Формат ответа по заголовку Accept (CBOR, если клиент предпочитает application/cbor).
+     */
+    static WireFormat acceptedFormat(const http::request<http::string_body>& req);
+
+    /**
+     * @brief Значение заголовка Vary для ответов, зависящих от Accept и Accept-Encoding.
+     */
+    const char* varyHeader() const;
+
+    /**
+     * @brief Разбирает тело запроса: CBOR при Content-Type application/cbor, иначе JSON.
+     * @throws std::exception Некорректное тело.
+     */
+    static json::value parseBody(const http::request<http::string_body>& req);
+
+    /**
+     * @brief Перекодирует готовый JSON-ответ в CBOR, если клиент его предпочитает.
+     */
+    void encodeResponse(const http::request<http::string_body>& req, http::response<http::string_body>& res) const;
+
+    /**
+     * @brief Кодирование ответа на запрос (Identity, если сжатие выключено или клиент его не принимает).
+     */
+    Compressor::Encoding acceptedEncoding(const http::request<http::string_body>& req) const;
+
+    /**
+     * @brief Сжимает готовое тело ответа, если клиент это допускает и тело не меньше min_size.
+     */
+    void compressResponse(const http::request<http::string_body>& req, http::response<http::string_body>& res) const;
+
+    /**
+     * @brief Проверка, что заголовок If-None-Match содержит etag или (если any) "*".
+     */
+    static bool matchesETag(std::string_view if_none_match, std::string_view etag, bool any);
+
+    /**
+     * @brief Есть ли хотя бы один CI или связь, отобранные фильтрами запроса (без limit, cursor, fields и count).
+     */
+    bool selectionExists(std::string_view route, std::map<std::string, std::string> filters);
+
     /**
      * @brief Обработка запроса на получение списка свойств CI.
      */
@@ -104,7 +300,7 @@ private:
      * @param result JSON-объект с результатом.
      * @return true, если результат успешный.
      */
-    bool isResultSuccess(json::object& result);
+    static bool isResultSuccess(const json::object& result);
 
     /**
      * @brief Извлечение параметров запроса из URI.
@@ -114,4 +310,8 @@ private:
     std::map<std::string, std::string> getQueryParams(http::request<http::string_body>& req);
 
     DataStore& store_; ///< Ссылка на объект хранилища данных.
+    ResponseCache cache_; ///< Кэш ответов на чтение.
+    const Exporter* exporter_ = nullptr; ///< Файл полной выгрузки (может отсутствовать).
+    CompressionConfig compression_; ///< Параметры сжатия ответов.
+    std::string instance_; ///< Метка запуска процесса для ETag (поколения начинаются заново после перезапуска).
 };
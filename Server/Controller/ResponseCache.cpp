@@ -0,0 +1,94 @@
+#include "ResponseCache.h"
+
+ResponseCache::ResponseCache(const ResponseCacheConfig& config) : config_(config) {
+}
+
+bool ResponseCache::enabled() const {
+    return config_.max_entries > 0;
+}
+
+size_t ResponseCache::maxEntrySize() const {
+    return config_.max_entry_size;
+}
+
+std::shared_ptr<const std::string> ResponseCache::get(const std::string& key, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return nullptr;
+    }
+
+    if (it->second->generation != generation) {
+        entries_.erase(it->second);
+        index_.erase(it);
+        return nullptr;
+    }
+
+    entries_.splice(entries_.begin(), entries_, it->second);
+
+    return it->second->body;
+}
+
+void ResponseCache::put(const std::string& key, uint64_t generation, std::string body) {
+    if (!enabled() || body.size() > config_.max_entry_size) {
+        return;
+    }
+
+    auto shared = std::make_shared<const std::string>(std::move(body));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        if (it->second->generation > generation) {
+            return;
+        }
+
+        it->second->generation = generation;
+        it->second->body = std::move(shared);
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+
+    entries_.push_front({key, generation, std::move(shared)});
+    index_.emplace(key, entries_.begin());
+
+    if (entries_.size() > config_.max_entries) {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
+
+size_t ResponseCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+CachingStream::CachingStream(std::unique_ptr<BodyStream> inner, ResponseCache& cache, std::string key, uint64_t generation)
+    : inner_(std::move(inner)),
+      cache_(cache),
+      key_(std::move(key)),
+      generation_(generation) {
+}
+
+bool CachingStream::next(std::string& out, size_t limit) {
+    size_t start = out.size();
+    bool more = inner_->next(out, limit);
+
+    if (!overflow_) {
+        if (body_.size() + (out.size() - start) > cache_.maxEntrySize()) {
+            overflow_ = true;
+            body_ = std::string();
+        } else {
+            body_.append(out, start, std::string::npos);
+        }
+    }
+
+    if (!more && !overflow_) {
+        cache_.put(key_, generation_, std::move(body_));
+        overflow_ = true;
+    }
+
+    return more;
+}
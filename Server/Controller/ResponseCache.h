@@ -0,0 +1,117 @@
+/**
+ * @file ResponseCache.h
+ * @brief Заголовочный файл LRU-кэша сериализованных ответов на чтение.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "../View/BodyStream.h"
+
+/**
+ * @struct ResponseCacheConfig
+ * @brief Параметры кэша ответов.
+ */
+struct ResponseCacheConfig {
+    size_t max_entries = 64;                  ///< Максимум ответов в кэше (0 - кэш выключен).
+    size_t max_entry_size = 1024 * 1024;      ///< Максимальный размер кэшируемого ответа, байт.
+};
+
+/**
+ * @class ResponseCache
+ * @brief Ограниченный LRU-кэш тел ответов по нормализованному маршруту и параметрам запроса.
+ *
+ * Каждая запись помечена поколением CMDB, для которого построен ответ. Запись другого поколения
+ * считается отсутствующей и удаляется при обращении, поэтому модификации не требуют явного
+ * сброса кэша. Объем кэша ограничен max_entries * max_entry_size; ответы больше max_entry_size
+ * не кэшируются.
+ */
+class ResponseCache {
+public:
+    /**
+     * @brief Конструктор.
+     * @param config Параметры кэша.
+     */
+    explicit ResponseCache(const ResponseCacheConfig& config = {});
+
+    /**
+     * @brief Кэш включен.
+     */
+    bool enabled() const;
+
+    /**
+     * @brief Максимальный размер кэшируемого ответа, байт.
+     */
+    size_t maxEntrySize() const;
+
+    /**
+     * @brief Ищет ответ и делает его самым свежим.
+     * @param key Ключ запроса.
+     * @param generation Текущее поколение CMDB.
+     * @return Тело ответа или nullptr, если ответа нет или он построен для другого поколения.
+     */
+    std::shared_ptr<const std::string> get(const std::string& key, uint64_t generation);
+
+    /**
+     * @brief Сохраняет ответ, вытесняя самый давний при переполнении.
+     * @param key Ключ запроса.
+     * @param generation Поколение CMDB, для которого построен ответ.
+     * @param body Тело ответа (не сохраняется, если больше max_entry_size).
+     */
+    void put(const std::string& key, uint64_t generation, std::string body);
+
+    /**
+     * @brief Количество ответов в кэше.
+     */
+    size_t size() const;
+
+private:
+    /**
+     * @struct Entry
+     * @brief Запись кэша.
+     */
+    struct Entry {
+        std::string key;                            ///< Ключ запроса.
+        uint64_t generation;                        ///< Поколение CMDB.
+        std::shared_ptr<const std::string> body;    ///< Тело ответа.
+    };
+
+    ResponseCacheConfig config_;                                            ///< Параметры кэша.
+    mutable std::mutex mutex_;                                              ///< Мьютекс записей.
+    std::list<Entry> entries_;                                              ///< Записи, начиная с самой свежей.
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;     ///< Записи по ключу.
+};
+
+/**
+ * @class CachingStream
+ * @brief Источник тела, который передает части другого источника и сохраняет тело в кэш.
+ *
+ * Копия тела накапливается, пока она не превышает max_entry_size, и попадает в кэш, только
+ * если источник выдал тело полностью (передача не прервана).
+ */
+class CachingStream : public BodyStream {
+public:
+    /**
+     * @brief Конструктор.
+     * @param inner Исходный источник тела.
+     * @param cache Кэш ответов.
+     * @param key Ключ запроса.
+     * @param generation Поколение CMDB, прочитанное до построения ответа.
+     */
+    CachingStream(std::unique_ptr<BodyStream> inner, ResponseCache& cache, std::string key, uint64_t generation);
+
+    bool next(std::string& out, size_t limit) override;
+
+private:
+    std::unique_ptr<BodyStream> inner_;     ///< Исходный источник тела.
+    ResponseCache& cache_;                  ///< Кэш ответов.
+    std::string key_;                       ///< Ключ запроса.
+    uint64_t generation_;                   ///< Поколение CMDB.
+    std::string body_;                      ///< Накопленная копия тела.
+    bool overflow_ = false;                 ///< Тело больше max_entry_size и не будет сохранено.
+};
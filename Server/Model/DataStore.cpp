@@ -1,49 +1,51 @@
 #include "DataStore.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
 
     json::object DataStore::getAllRecords() {
         json::object result;
+        auto snapshot = cmdb_.snapshot();
 
-        if (auto levels = cmdb_.getLevels()) {
-            json::array levelsArray;
-
-            for (const auto& level : *levels) {
-                levelsArray.push_back(json::value(level));
-            }
-
-            result["levels"] = levelsArray;
+        json::array levelsArray;
+        for (const auto& level : snapshot->getLevels()) {
+            levelsArray.push_back(json::value(level));
         }
+        result["levels"] = levelsArray;
 
-        if (auto cis = cmdb_.getCIs()) {
+        if (snapshot->getCICount() > 0) {
             json::array cisArray;
-            for (const auto& ciPtr : *cis) {
-                if (ciPtr) {
-                    json::object ciObject;
-                    ciObject = ciPtr->asJSON();
-                    cisArray.push_back(ciObject);
-                }
-            }
+            snapshot->forEachCI([&](const cmdb::CMDB::CIPtr& ciPtr) {
+                cisArray.push_back(ciPtr->asJSON());
+            });
             result["cis"] = cisArray;
         }
 
-        if (auto relationships = cmdb_.getRelationships()) {
+        if (snapshot->getRelationshipCount() > 0) {
             json::array relationshipsArray;
-            for (const auto& relationshipPtr : *relationships) {
-                if (relationshipPtr) {
-                    json::object relationshipObject;
-                    relationshipObject["from_id"] = relationshipPtr->getSource();
-                    relationshipObject["to_id"] = relationshipPtr->getDestination();
-                    relationshipObject["type"] = relationshipPtr->getType();
-                    relationshipsArray.push_back(relationshipObject);
-                }
-            }
+            snapshot->forEachRelationship([&](const cmdb::CMDB::RelationshipPtr& relationshipPtr) {
+                json::object relationshipObject;
+                relationshipObject["from_id"] = relationshipPtr->getSource();
+                relationshipObject["to_id"] = relationshipPtr->getDestination();
+                relationshipObject["type"] = relationshipPtr->getType();
+                relationshipsArray.push_back(relationshipObject);
+            });
             result["relationships"] = relationshipsArray;
         }
 
         return result;
     }
 
+    uint64_t DataStore::getGeneration() const {
+        return cmdb_.getGeneration();
+    }
+
+    std::unique_ptr<BodyStream> DataStore::streamAllRecords(WireFormat format) {
+        return std::make_unique<AllRecordsStream>(cmdb_.snapshot(), format);
+    }
+
     json::array DataStore::getAllLevels() {
         json::array levelsArray;
 
@@ -79,6 +81,39 @@ DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
         return result;
     }
 
+    std::unique_ptr<BodyStream> DataStore::streamCi(const std::map<std::string, std::string>& filters,
+                                                    const PageRequest& page, const FieldSet& fields,
+                                                    WireFormat format) {
+        if (page.limit > 0) {
+            std::optional<std::string> after;
+            if (!page.cursor.empty()) {
+                after = decodeCursor('c', page.cursor);
+            }
+
+            bool more = false;
+            auto cis = cmdb_.getCIs(filters, after, page.limit, more);
+            std::string prefix = pagePrefix(format, cis->size());
+            std::string suffix = pageSuffix(format, 'c', cis->empty() ? std::string() : cis->back()->getId(), more);
+
+            return std::make_unique<ArrayStream<cmdb::CMDB::CIPtr>>(std::move(cis), std::move(prefix), std::move(suffix),
+                                                                    fields, format);
+        }
+
+        auto cis = cmdb_.getCIs(filters);
+
+        if (cis->empty()) {
+            return nullptr;
+        }
+
+        std::string prefix = arrayPrefix(format, cis->size());
+        return std::make_unique<ArrayStream<cmdb::CMDB::CIPtr>>(std::move(cis), std::move(prefix),
+                                                                format == WireFormat::Json ? "]" : "", fields, format);
+    }
+
+    size_t DataStore::countCi(const std::map<std::string, std::string>& filters, size_t limit) {
+        return cmdb_.countCIs(filters, limit);
+    }
+
     json::array DataStore::getRelationships(const std::map<std::string, std::string>& filters) {
         std::shared_ptr<std::vector<cmdb::CMDB::RelationshipPtr>> rels = cmdb_.getRelationships(filters);
 
@@ -93,6 +128,151 @@ DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
         return result;
     }
 
+    std::unique_ptr<BodyStream> DataStore::streamRelationships(const std::map<std::string, std::string>& filters,
+                                                               const PageRequest& page, const FieldSet& fields,
+                                                               WireFormat format) {
+        if (page.limit > 0) {
+            std::optional<cmdb::RelationshipKey> after;
+            if (!page.cursor.empty()) {
+                std::string key = decodeCursor('r', page.cursor);
+                size_t first = key.find('\0');
+                size_t second = first == std::string::npos ? first : key.find('\0', first + 1);
+
+                if (second == std::string::npos) {
+                    throw std::invalid_argument("Некорректный курсор");
+                }
+
+                after = cmdb::RelationshipKey{key.substr(0, first), key.substr(first + 1, second - first - 1),
+                                              key.substr(second + 1)};
+            }
+
+            bool more = false;
+            auto rels = cmdb_.getRelationships(filters, after, page.limit, more);
+
+            std::string last;
+            if (!rels->empty()) {
+                const auto& rel = *rels->back();
+                last = rel.getSource() + '\0' + rel.getDestination() + '\0' + rel.getType();
+            }
+            std::string prefix = pagePrefix(format, rels->size());
+            std::string suffix = pageSuffix(format, 'r', last, more);
+
+            return std::make_unique<ArrayStream<cmdb::CMDB::RelationshipPtr>>(std::move(rels), std::move(prefix),
+                                                                              std::move(suffix), fields, format);
+        }
+
+        auto rels = cmdb_.getRelationships(filters);
+
+        if (rels->empty()) {
+            return nullptr;
+        }
+
+        std::string prefix = arrayPrefix(format, rels->size());
+        return std::make_unique<ArrayStream<cmdb::CMDB::RelationshipPtr>>(std::move(rels), std::move(prefix),
+                                                                          format == WireFormat::Json ? "]" : "", fields,
+                                                                          format);
+    }
+
+    size_t DataStore::countRelationships(const std::map<std::string, std::string>& filters, size_t limit) {
+        return cmdb_.countRelationships(filters, limit);
+    }
+
+    namespace {
+        const char kCursorAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    }
+
+    std::string DataStore::encodeCursor(char kind, const std::string& key) {
+        std::string data = kind + key;
+        std::string result;
+        result.reserve((data.size() + 2) / 3 * 4);
+
+        for (size_t i = 0; i < data.size(); i += 3) {
+            uint32_t chunk = static_cast<uint8_t>(data[i]) << 16;
+            size_t count = std::min<size_t>(3, data.size() - i);
+
+            if (count > 1) {
+                chunk |= static_cast<uint8_t>(data[i + 1]) << 8;
+            }
+            if (count > 2) {
+                chunk |= static_cast<uint8_t>(data[i + 2]);
+            }
+
+            for (size_t j = 0; j <= count; ++j) {
+                result += kCursorAlphabet[(chunk >> (18 - 6 * j)) & 0x3F];
+            }
+        }
+
+        return result;
+    }
+
+    std::string DataStore::decodeCursor(char kind, const std::string& cursor) {
+        std::string data;
+        uint32_t chunk = 0;
+        int bits = 0;
+
+        for (char c : cursor) {
+            const char* pos = c == '\0' ? nullptr : std::strchr(kCursorAlphabet, c);
+            if (pos == nullptr) {
+                throw std::invalid_argument("Некорректный курсор");
+            }
+
+            chunk = (chunk << 6) | static_cast<uint32_t>(pos - kCursorAlphabet);
+            bits += 6;
+
+            if (bits >= 8) {
+                bits -= 8;
+                data += static_cast<char>((chunk >> bits) & 0xFF);
+            }
+        }
+
+        if (data.empty() || data[0] != kind) {
+            throw std::invalid_argument("Некорректный курсор");
+        }
+
+        return data.substr(1);
+    }
+
+    std::string DataStore::arrayPrefix(WireFormat format, size_t count) {
+        if (format == WireFormat::Json) {
+            return "[";
+        }
+
+        std::string prefix;
+        CborWriter::writeHead(prefix, CborWriter::Array, count);
+        return prefix;
+    }
+
+    std::string DataStore::pagePrefix(WireFormat format, size_t count) {
+        if (format == WireFormat::Json) {
+            return "{\"items\":[";
+        }
+
+        std::string prefix;
+        CborWriter::writeHead(prefix, CborWriter::Map, 2);
+        CborWriter::writeString(prefix, "items");
+        CborWriter::writeHead(prefix, CborWriter::Array, count);
+        return prefix;
+    }
+
+    std::string DataStore::pageSuffix(WireFormat format, char kind, const std::string& last_key, bool more) {
+        if (format == WireFormat::Cbor) {
+            std::string suffix;
+            CborWriter::writeString(suffix, "next_cursor");
+            if (more) {
+                CborWriter::writeString(suffix, encodeCursor(kind, last_key));
+            } else {
+                CborWriter::writeNull(suffix);
+            }
+            return suffix;
+        }
+
+        if (!more) {
+            return "],\"next_cursor\":null}";
+        }
+
+        return "],\"next_cursor\":\"" + encodeCursor(kind, last_key) + "\"}";
+    }
+
     json::object DataStore::addLevel(const json::object& level) {
         json::object result;
 
@@ -110,30 +290,25 @@ DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
         return result;
     }
 
-    bool DataStore::addCiToCMDB(const json::object& ci, std::string& message, std::string& ciId) {
+    bool DataStore::parseCiData(const json::object& ci, cmdb::CMDB::CIData& data, std::string& message) {
         if (!ci.contains("id") || !ci.contains("name") || !ci.contains("type") || !ci.contains("level")) {
             message = "Не запонены обязательные поля.";
             return false;
         }
 
-        ciId = boost::json::value_to<std::string>(ci.at("id"));
-        std::string name = boost::json::value_to<std::string>(ci.at("name"));
-        std::string ciType = boost::json::value_to<std::string>(ci.at("type"));
-        int level = boost::json::value_to<int>(ci.at("level"));
+        data.id = boost::json::value_to<std::string>(ci.at("id"));
+        data.name = boost::json::value_to<std::string>(ci.at("name"));
+        data.type = boost::json::value_to<std::string>(ci.at("type"));
+        data.level = boost::json::value_to<int>(ci.at("level"));
 
-        if (isCIexists(ciId)) {
-            message = "КЕ с таким id " + ciId + " уже существует.";
-            return false;
-        }
-
-        std::unordered_map<std::string, std::string> properties;
         if (ci.contains("properties")) {
             if (!ci.at("properties").is_object()) {
                 message = "Data Store (AddCi): Свойства должны быть объектом JSON.";
                 return false;
             }
 
-            auto propertiesJson = ci.at("properties").as_object();
+            const auto& propertiesJson = ci.at("properties").as_object();
+            data.properties.reserve(propertiesJson.size());
 
             for (auto it = propertiesJson.begin(); it != propertiesJson.end(); ++it) {
                 if (!it->value().is_string()) {
@@ -141,16 +316,32 @@ DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
                     return false;
                 }
 
-                properties[it->key()] = boost::json::value_to<std::string>(it->value());
+                data.properties[it->key()] = boost::json::value_to<std::string>(it->value());
             }
         }
 
-        if (!cmdb_.addCI(ciId, name, ciType, level, properties)) {
-            message = "Ошибка добавления КЕ в CMDB.";
+        return true;
+    }
+
+    bool DataStore::addCiToCMDB(const json::object& ci, std::string& message, std::string& ciId) {
+        cmdb::CMDB::CIData data;
+
+        if (!parseCiData(ci, data, message)) {
+            ciId = data.id;
             return false;
         }
 
-        message = ciId + " добавлен";
+        ciId = data.id;
+
+        if (!cmdb_.addCI(data.id, data.name, data.type, data.level, data.properties)) {
+            // Причина отказа выясняется только на пути ошибки, успешное добавление обходится без поиска
+            message = cmdb_.getCI(data.id)
+                ? "КЕ с таким id " + data.id + " уже существует."
+                : "Уровень " + std::to_string(data.level) + " не существует.";
+            return false;
+        }
+
+        message = data.id + " добавлен";
 
         return true;
     }
@@ -176,7 +367,12 @@ DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
     boost::json::object DataStore::addCis(const boost::json::array& cis) {
         boost::json::object result;
         boost::json::array cis_add;
-        int addedCount = 0;
+        cis_add.reserve(cis.size());
+
+        std::vector<cmdb::CMDB::CIData> batch;
+        std::vector<size_t> positions;
+        batch.reserve(cis.size());
+        positions.reserve(cis.size());
 
         for (const auto& ciValue : cis) {
             boost::json::object entry;
@@ -189,43 +385,61 @@ DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
                 continue;
             }
 
-            const boost::json::object& ci = ciValue.as_object();
+            cmdb::CMDB::CIData data;
             std::string message;
-            std::string ciId = "unknown";
 
-            if (addCiToCMDB(ci, message, ciId)) {
-                ++addedCount;
-            }
+            bool parsed = parseCiData(ciValue.as_object(), data, message);
 
-            entry["id"] = ciId;
+            entry["id"] = data.id.empty() ? "unknown" : data.id;
             entry["message"] = message;
 
+            if (parsed) {
+                positions.push_back(cis_add.size());
+                batch.push_back(std::move(data));
+            }
+
             cis_add.push_back(entry);
         }
 
+        auto bulk = cmdb_.addCIs(std::move(batch));
+
+        for (size_t i = 0; i < positions.size(); ++i) {
+            cis_add[positions[i]].as_object()["message"] = bulk.messages[i];
+        }
+
         result["cis_add"] = cis_add;
 
         boost::json::object info;
         info["total"] = static_cast<int>(cis.size());
-        info["added"] = addedCount;
+        info["added"] = static_cast<int>(bulk.added);
         result["info"] = info;
 
-        result["status"] = addedCount > 0 ? "success" : "failure";
+        result["status"] = bulk.added > 0 ? "success" : "failure";
 
         return result;
     }
 
-    bool DataStore::addRelationshipToCMDB(const json::object& ci, std::string& message) {
-        if (!ci.contains("source") || !ci.contains("destination") || !ci.contains("type")) {
+    bool DataStore::parseRelationshipData(const json::object& relationship, cmdb::CMDB::RelationshipData& data, std::string& message) {
+        if (!relationship.contains("source") || !relationship.contains("destination") || !relationship.contains("type")) {
             message = "Не запонены обязательные поля.";
             return false;
         }
 
-        std::string source = boost::json::value_to<std::string>(ci.at("source"));
-        std::string destination = boost::json::value_to<std::string>(ci.at("destination"));
-        std::string type = boost::json::value_to<std::string>(ci.at("type"));
-        
-        if (!cmdb_.addRelationship(source, destination, type)) {
+        data.from_id = boost::json::value_to<std::string>(relationship.at("source"));
+        data.to_id = boost::json::value_to<std::string>(relationship.at("destination"));
+        data.type = boost::json::value_to<std::string>(relationship.at("type"));
+
+        return true;
+    }
+
+    bool DataStore::addRelationshipToCMDB(const json::object& ci, std::string& message) {
+        cmdb::CMDB::RelationshipData data;
+
+        if (!parseRelationshipData(ci, data, message)) {
+            return false;
+        }
+
+        if (!cmdb_.addRelationship(data.from_id, data.to_id, data.type)) {
             message = "НЕ добавлено";    
             return false;
         }
@@ -256,40 +470,51 @@ DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
     boost::json::object DataStore::addRelationships(const json::array& relationships) {
         boost::json::object result;
         boost::json::array rel_add;
-        int addedCount = 0;
+        rel_add.reserve(relationships.size());
+
+        std::vector<cmdb::CMDB::RelationshipData> batch;
+        std::vector<size_t> positions;
+        batch.reserve(relationships.size());
+        positions.reserve(relationships.size());
 
         for (const auto& relationshipValue : relationships) {
             boost::json::object entry;
+            entry["relationship"] = relationshipValue;
 
             if (!relationshipValue.is_object()) {
-                entry["relationship"] = relationshipValue;
                 entry["message"] = "Элемент не является объектом JSON.";
 
                 rel_add.push_back(entry);
                 continue;
             }
 
-            const boost::json::object& rel = relationshipValue.as_object();
+            cmdb::CMDB::RelationshipData data;
             std::string message;
 
-            if (addRelationshipToCMDB(rel, message)) {
-                ++addedCount;
+            if (parseRelationshipData(relationshipValue.as_object(), data, message)) {
+                positions.push_back(rel_add.size());
+                batch.push_back(std::move(data));
             }
 
-            entry["relationship"] = relationshipValue;
             entry["message"] = message;
 
             rel_add.push_back(entry);
         }
 
+        auto bulk = cmdb_.addRelationships(batch);
+
+        for (size_t i = 0; i < positions.size(); ++i) {
+            rel_add[positions[i]].as_object()["message"] = bulk.messages[i];
+        }
+
         result["rels_add"] = rel_add;
 
         boost::json::object info;
         info["total"] = static_cast<int>(rel_add.size());
-        info["added"] = addedCount;
+        info["added"] = static_cast<int>(bulk.added);
         result["info"] = info;
 
-        result["status"] = addedCount > 0 ? "success" : "failure";
+        result["status"] = bulk.added > 0 ? "success" : "failure";
 
         return result;
     }
@@ -467,6 +692,207 @@ DataStore::DataStore(cmdb::CMDB& cmdb) : cmdb_(cmdb) {}
         return result;
     }
 
-    bool DataStore::isCIexists(std::string id) {
-        return cmdb_.getCI(id) != nullptr ? true : false;
+    bool DataStore::parseTxOperation(const json::value& value, cmdb::TxOperation& operation, std::string& message) {
+        if (!value.is_object() || !value.as_object().contains("op") || !value.as_object().at("op").is_string()) {
+            message = "Операция должна быть объектом JSON с полем op.";
+            return false;
+        }
+
+        const auto& op = value.as_object();
+        std::string kind = boost::json::value_to<std::string>(op.at("op"));
+
+        if (kind == "add_ci" || kind == "update_ci") {
+            if (!op.contains("ci") || !op.at("ci").is_object()) {
+                message = "Не заполнен объект ci.";
+                return false;
+            }
+
+            const auto& ci = op.at("ci").as_object();
+            if (!ci.contains("id") || !ci.at("id").is_string()) {
+                message = "Не запонен ID.";
+                return false;
+            }
+
+            operation.id = boost::json::value_to<std::string>(ci.at("id"));
+
+            if (kind == "update_ci") {
+                operation.type = cmdb::TxOperation::Type::UpdateCI;
+                operation.update = ci;
+                return true;
+            }
+
+            if (!ci.contains("name") || !ci.contains("type") || !ci.contains("level")) {
+                message = "Не запонены обязательные поля.";
+                return false;
+            }
+
+            if (!ci.at("name").is_string() || !ci.at("type").is_string() || !ci.at("level").is_int64()) {
+                message = "Поля name и type должны быть строками, level - целым числом.";
+                return false;
+            }
+
+            operation.type = cmdb::TxOperation::Type::AddCI;
+            operation.name = boost::json::value_to<std::string>(ci.at("name"));
+            operation.ci_type = boost::json::value_to<std::string>(ci.at("type"));
+            operation.level = static_cast<int>(ci.at("level").as_int64());
+
+            if (ci.contains("properties")) {
+                if (!ci.at("properties").is_object()) {
+                    message = "Свойства должны быть объектом JSON.";
+                    return false;
+                }
+
+                for (const auto& [key, property] : ci.at("properties").as_object()) {
+                    if (!property.is_string()) {
+                        message = "Значение свойства должны быть строковыми.";
+                        return false;
+                    }
+
+                    operation.properties[std::string(key)] = boost::json::value_to<std::string>(property);
+                }
+            }
+
+            return true;
+        }
+
+        if (kind == "remove_ci") {
+            if (!op.contains("id") || !op.at("id").is_string()) {
+                message = "Не запонен ID.";
+                return false;
+            }
+
+            operation.type = cmdb::TxOperation::Type::RemoveCI;
+            operation.id = boost::json::value_to<std::string>(op.at("id"));
+
+            return true;
+        }
+
+        if (kind == "add_relationship" || kind == "remove_relationship") {
+            if (!op.contains("relationship") || !op.at("relationship").is_object()) {
+                message = "Не заполнен объект relationship.";
+                return false;
+            }
+
+            const auto& rel = op.at("relationship").as_object();
+            bool needs_type = kind == "add_relationship";
+
+            if (!rel.contains("source") || !rel.contains("destination") || (needs_type && !rel.contains("type"))) {
+                message = "Не запонены обязательные поля.";
+                return false;
+            }
+
+            if (!rel.at("source").is_string() || !rel.at("destination").is_string() ||
+                (rel.contains("type") && !rel.at("type").is_string())) {
+                message = "Поля source, destination и type должны быть строками.";
+                return false;
+            }
+
+            operation.type = needs_type ? cmdb::TxOperation::Type::AddRelationship : cmdb::TxOperation::Type::RemoveRelationship;
+            operation.id = boost::json::value_to<std::string>(rel.at("source"));
+            operation.to_id = boost::json::value_to<std::string>(rel.at("destination"));
+
+            if (rel.contains("type")) {
+                operation.relationship_type = boost::json::value_to<std::string>(rel.at("type"));
+            }
+
+            return true;
+        }
+
+        message = "Неизвестная операция " + kind + ".";
+        return false;
+    }
+
+    bool DataStore::parseTransaction(const json::value& body, std::vector<cmdb::TxOperation>& operations, json::object& error) {
+        const json::array* operations_json = nullptr;
+
+        if (body.is_array()) {
+            operations_json = &body.as_array();
+        } else if (body.is_object() && body.as_object().contains("operations") && body.as_object().at("operations").is_array()) {
+            operations_json = &body.as_object().at("operations").as_array();
+        }
+
+        if (!operations_json || operations_json->empty()) {
+            error["status"] = "failure";
+            error["message"] = "Нет операций.";
+            return false;
+        }
+
+        operations.resize(operations_json->size());
+
+        for (size_t i = 0; i < operations.size(); ++i) {
+            std::string message;
+
+            if (!parseTxOperation((*operations_json)[i], operations[i], message)) {
+                error["status"] = "failure";
+                error["failed_index"] = static_cast<int>(i);
+                error["message"] = message;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    json::object DataStore::txResultToJson(const cmdb::TxResult& tx, size_t total) {
+        json::object result;
+        json::array results;
+
+        for (const auto& message : tx.messages) {
+            results.push_back(json::value(message));
+        }
+
+        result["status"] = tx.committed ? "success" : "failure";
+        result["committed"] = tx.committed;
+        result["total"] = static_cast<int>(total);
+        result["results"] = results;
+
+        if (!tx.committed) {
+            result["failed_index"] = static_cast<int>(tx.failed_index);
+            result["message"] = tx.messages.empty() ? std::string() : tx.messages.back();
+        }
+
+        return result;
+    }
+
+    json::object DataStore::applyTransaction(const json::value& body) {
+        std::vector<cmdb::TxOperation> operations;
+        json::object error;
+
+        if (!parseTransaction(body, operations, error)) {
+            return error;
+        }
+
+        return txResultToJson(cmdb_.applyTransaction(operations), operations.size());
+    }
+
+    void DataStore::applyTransaction(const json::value& body, std::function<void(json::object)> done) {
+        std::vector<cmdb::TxOperation> operations;
+        json::object error;
+
+        if (!parseTransaction(body, operations, error)) {
+            done(std::move(error));
+            return;
+        }
+
+        size_t total = operations.size();
+
+        cmdb_.applyTransaction(std::move(operations), [total, done = std::move(done)](std::exception_ptr failure, cmdb::TxResult tx) {
+            if (failure) {
+                json::object result;
+                result["status"] = "failure";
+                result["message"] = "Транзакция не выполнена.";
+
+                try {
+                    std::rethrow_exception(failure);
+                } catch (const std::exception& e) {
+                    result["message"] = e.what();
+                } catch (...) {
+                }
+
+                done(std::move(result));
+                return;
+            }
+
+            done(txResultToJson(tx, total));
+        });
     }
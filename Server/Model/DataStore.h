@@ -6,14 +6,27 @@
 #pragma once
 
 #include <boost/json.hpp>
+#include <functional>
+#include <memory>
+#include <limits>
 #include <string>
 #include <map>
 #include <unordered_map>
 #include <thread>
 #include "../../CMDB/CMDB.h"
+#include "../View/BodyStream.h"
 
 namespace json = boost::json;
 
+/**
+ * @struct PageRequest
+ * @brief Параметры постраничной выборки CI или связей.
+ */
+struct PageRequest {
+    size_t limit = 0;       ///< Максимум элементов на странице (0 - выборка без страниц).
+    std::string cursor;     ///< Курсор, выданный с предыдущей страницей (пусто - первая страница).
+};
+
 /**
  * @class DataStore
  * @brief Класс-адаптер, предоставляющий API для работы с объектами CMDB: уровнями, CI и связями.
@@ -26,12 +39,28 @@ public:
      */
     DataStore(cmdb::CMDB& cmdb);
 
+    /**
+     * @brief Получить текущее поколение данных (растет с каждой модификацией).
+     */
+    uint64_t getGeneration() const;
+
     /**
      * @brief Получить все данные: уровни, CI и связи.
      * @return JSON-объект с полной структурой данных.
      */
     json::object getAllRecords();
 
+    /**
+     * @brief Получить все данные в виде потока частей тела ответа.
+     *
+     * Результат совпадает с сериализацией getAllRecords, но строится по мере передачи
+     * из одного снимка CMDB, без промежуточного JSON-объекта всей базы.
+     *
+     * @param format Формат тела.
+     * @return Источник тела ответа.
+     */
+    std::unique_ptr<BodyStream> streamAllRecords(WireFormat format = WireFormat::Json);
+
     /**
      * @brief Получить список всех уровней.
      * @return JSON-массив с уровнями.
@@ -52,6 +81,32 @@ public:
      */
     json::array getCi(const std::map<std::string, std::string>& filters);
 
+    /**
+     * @brief Получить список CI по фильтрам в виде потока частей тела ответа.
+     *
+     * С page.limit > 0 тело - страница `{"items":[...],"next_cursor":"..."}`, где next_cursor
+     * равен null на последней странице. Курсор указывает на последнюю выданную КЕ, поэтому
+     * изменения базы между запросами страниц не приводят к пропускам и повторам.
+     *
+     * @param filters Карта фильтров (ключ-значение).
+     * @param page Параметры страницы.
+     * @param fields Выдаваемые поля CI.
+     * @param format Формат тела.
+     * @return Источник тела ответа или nullptr, если CI не найдены (только без страниц).
+     * @throws std::invalid_argument Некорректный курсор.
+     */
+    std::unique_ptr<BodyStream> streamCi(const std::map<std::string, std::string>& filters, const PageRequest& page = {},
+                                         const FieldSet& fields = {}, WireFormat format = WireFormat::Json);
+
+    /**
+     * @brief Подсчитать CI по фильтрам без выборки самих CI.
+     * @param filters Карта фильтров (ключ-значение).
+     * @param limit Достаточное число CI (1 - проверка существования).
+     * @return Число CI, не больше limit.
+     */
+    size_t countCi(const std::map<std::string, std::string>& filters,
+                   size_t limit = std::numeric_limits<size_t>::max());
+
     /**
      * @brief Получить список связей по фильтрам.
      * @param filters Карта фильтров (ключ-значение).
@@ -59,6 +114,31 @@ public:
      */
     json::array getRelationships(const std::map<std::string, std::string>& filters);
 
+    /**
+     * @brief Получить список связей по фильтрам в виде потока частей тела ответа.
+     *
+     * Страницы устроены так же, как у streamCi.
+     *
+     * @param filters Карта фильтров (ключ-значение).
+     * @param page Параметры страницы.
+     * @param fields Выдаваемые поля связей.
+     * @param format Формат тела.
+     * @return Источник тела ответа или nullptr, если связи не найдены (только без страниц).
+     * @throws std::invalid_argument Некорректный курсор.
+     */
+    std::unique_ptr<BodyStream> streamRelationships(const std::map<std::string, std::string>& filters,
+                                                    const PageRequest& page = {}, const FieldSet& fields = {},
+                                                    WireFormat format = WireFormat::Json);
+
+    /**
+     * @brief Подсчитать связи по фильтрам без выборки самих связей.
+     * @param filters Карта фильтров (ключ-значение).
+     * @param limit Достаточное число связей (1 - проверка существования).
+     * @return Число связей, не больше limit.
+     */
+    size_t countRelationships(const std::map<std::string, std::string>& filters,
+                              size_t limit = std::numeric_limits<size_t>::max());
+
     /**
      * @brief Добавить новый уровень.
      * @param level JSON-объект уровня.
@@ -144,6 +224,29 @@ public:
      */
     json::object updateLevel(const json::object& level);
 
+    /**
+     * @brief Атомарно выполнить набор операций над CI и связями.
+     *
+     * Тело - массив операций или объект с массивом `operations`. Операция задается полем `op`:
+     * `add_ci`, `update_ci` (объект `ci`), `remove_ci` (поле `id`), `add_relationship`,
+     * `remove_relationship` (объект `relationship`).
+     *
+     * @param body JSON-тело запроса.
+     * @return JSON-объект с результатом по каждой операции.
+     */
+    json::object applyTransaction(const json::value& body);
+
+    /**
+     * @brief Выполнить набор операций, не ожидая фиксации в вызывающем потоке.
+     *
+     * Результат тот же, что у синхронного варианта. С конвейером модификаций `done` вызывается
+     * потоком-писателем CMDB после групповой фиксации, иначе - до возврата из метода.
+     *
+     * @param body JSON-тело запроса.
+     * @param done Получатель JSON-объекта с результатом.
+     */
+    void applyTransaction(const json::value& body, std::function<void(json::object)> done);
+
     /**
      * @brief Получить список всех доступных свойств CI.
      * @return JSON-объект с именами свойств.
@@ -154,6 +257,51 @@ private:
     std::unordered_map<int, std::unordered_map<std::string, std::string>> data_; ///< Внутреннее хранилище данных.
     cmdb::CMDB& cmdb_; ///< Ссылка на CMDB-объект.
 
+    /**
+     * @brief Разобрать тело транзакции в список операций.
+     * @param body JSON-тело запроса.
+     * @param operations Разобранные операции.
+     * @param error JSON-объект ошибки, если тело некорректно.
+     * @return true, если разбор успешен.
+     */
+    bool parseTransaction(const json::value& body, std::vector<cmdb::TxOperation>& operations, json::object& error);
+
+    /**
+     * @brief Закодировать ключ последнего элемента страницы в курсор (base64url).
+     * @param kind Вид элемента: 'c' - CI, 'r' - связь.
+     * @param key Ключ элемента.
+     */
+    static std::string encodeCursor(char kind, const std::string& key);
+
+    /**
+     * @brief Раскодировать курсор, выданный encodeCursor.
+     * @param kind Ожидаемый вид элемента.
+     * @param cursor Курсор из запроса.
+     * @return Ключ элемента.
+     * @throws std::invalid_argument Курсор поврежден или выдан для другого вида элементов.
+     */
+    static std::string decodeCursor(char kind, const std::string& cursor);
+
+    /**
+     * @brief Начало тела-массива из count элементов.
+     */
+    static std::string arrayPrefix(WireFormat format, size_t count);
+
+    /**
+     * @brief Начало тела страницы из count элементов (объект с массивом items).
+     */
+    static std::string pagePrefix(WireFormat format, size_t count);
+
+    /**
+     * @brief Завершение тела страницы: курсор следующей страницы и закрывающие скобки.
+     */
+    static std::string pageSuffix(WireFormat format, char kind, const std::string& last_key, bool more);
+
+    /**
+     * @brief Сформировать JSON-ответ по результату транзакции.
+     */
+    static json::object txResultToJson(const cmdb::TxResult& tx, size_t total);
+
     /**
      * @brief Добавить CI в CMDB.
      */
@@ -165,7 +313,17 @@ private:
     bool updateCiInCMDB(const json::object& ci, std::string& message, std::string& ciId);
 
     /**
-     * @brief Проверка существования CI по ID.
+     * @brief Разобрать операцию транзакции.
+     */
+    bool parseTxOperation(const json::value& value, cmdb::TxOperation& operation, std::string& message);
+
+    /**
+     * @brief Разобрать JSON-объект CI в данные для добавления.
+     */
+    bool parseCiData(const json::object& ci, cmdb::CMDB::CIData& data, std::string& message);
+
+    /**
+     * @brief Разобрать JSON-объект связи в данные для добавления.
      */
-    bool isCIexists(std::string id);
+    bool parseRelationshipData(const json::object& relationship, cmdb::CMDB::RelationshipData& data, std::string& message);
 };
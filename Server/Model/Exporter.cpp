@@ -0,0 +1,166 @@
+#include "Exporter.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+
+Exporter::Exporter(cmdb::CMDB& cmdb, const ExporterConfig& config, const CompressionConfig& compression)
+    : cmdb_(cmdb),
+      config_(config),
+      compression_(compression) {
+    std::error_code ec;
+    std::filesystem::create_directories(config_.directory, ec);
+    if (ec) {
+        std::cerr << "Не удалось создать каталог выгрузки " << config_.directory << ": " << ec.message() << "\n";
+    }
+
+    for (const auto& entry : std::filesystem::directory_iterator(config_.directory, ec)) {
+        if (entry.path().filename().string().rfind("cmdb-all-", 0) == 0) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+    thread_ = std::thread([this] { run(); });
+}
+
+Exporter::~Exporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+std::shared_ptr<const BodyFile> Exporter::current(uint64_t generation, Compressor::Encoding encoding) const {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+
+    if (generation_ != generation) {
+        return nullptr;
+    }
+
+    switch (encoding) {
+    case Compressor::Encoding::Identity: return file_;
+    case Compressor::Encoding::Gzip: return gzip_file_;
+    case Compressor::Encoding::Deflate: break;
+    }
+
+    return nullptr;
+}
+
+void Exporter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Выгрузка пересобирается, когда поколение CMDB не менялось целый период settle.
+    uint64_t seen = cmdb_.getGeneration();
+    bool first = true;
+
+    while (first || !cv_.wait_for(lock, config_.settle, [this] { return stop_; })) {
+        uint64_t generation = cmdb_.getGeneration();
+
+        if (generation != seen) {
+            seen = generation;
+        } else if (!current(generation)) {
+            lock.unlock();
+            rebuild();
+            lock.lock();
+        }
+        first = false;
+    }
+}
+
+bool Exporter::rebuild() {
+    auto snapshot = cmdb_.snapshot();
+    uint64_t generation = snapshot->getGeneration();
+
+    std::string name = "cmdb-all-" + std::to_string(generation) + ".json";
+    std::string path = (std::filesystem::path(config_.directory) / name).string();
+    std::string gzip_path = path + ".gz";
+    bool compress = compression_.level > 0;
+
+    uint64_t size = 0;
+    uint64_t gzip_size = 0;
+    {
+        std::ofstream out(path + ".tmp", std::ios::binary | std::ios::trunc);
+        std::ofstream gzip_out;
+        if (compress) {
+            gzip_out.open(gzip_path + ".tmp", std::ios::binary | std::ios::trunc);
+        }
+
+        if (!out || (compress && !gzip_out)) {
+            std::cerr << "Не удалось открыть файл выгрузки " << path << ".tmp\n";
+            std::remove((path + ".tmp").c_str());
+            std::remove((gzip_path + ".tmp").c_str());
+            return false;
+        }
+
+        AllRecordsStream stream(snapshot);
+        std::unique_ptr<Compressor> compressor;
+        if (compress) {
+            compressor = std::make_unique<Compressor>(Compressor::Encoding::Gzip, compression_.level);
+        }
+
+        std::string chunk;
+        std::string packed;
+        bool more = true;
+
+        while (more) {
+            chunk.clear();
+            more = stream.next(chunk, 1024 * 1024);
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            size += chunk.size();
+
+            if (compressor) {
+                packed.clear();
+                compressor->write(packed, chunk, !more);
+                gzip_out.write(packed.data(), static_cast<std::streamsize>(packed.size()));
+                gzip_size += packed.size();
+            }
+        }
+
+        if (!out.flush() || (compress && !gzip_out.flush())) {
+            std::cerr << "Ошибка записи файла выгрузки " << path << ".tmp\n";
+            std::remove((path + ".tmp").c_str());
+            std::remove((gzip_path + ".tmp").c_str());
+            return false;
+        }
+    }
+
+    auto file = publish(path + ".tmp", path, size);
+    if (!file) {
+        std::remove((gzip_path + ".tmp").c_str());
+        return false;
+    }
+
+    std::shared_ptr<const BodyFile> gzip_file;
+    if (compress) {
+        gzip_file = publish(gzip_path + ".tmp", gzip_path, gzip_size);
+    }
+
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    file_ = std::move(file);
+    gzip_file_ = std::move(gzip_file);
+    generation_ = generation;
+
+    return true;
+}
+
+std::shared_ptr<const BodyFile> Exporter::publish(const std::string& temp, const std::string& path, uint64_t size) {
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Не удалось переименовать файл выгрузки " << temp << "\n";
+        std::remove(temp.c_str());
+        return nullptr;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Не удалось открыть файл выгрузки " << path << "\n";
+        std::remove(path.c_str());
+        return nullptr;
+    }
+
+    return std::make_shared<const BodyFile>(path, fd, size);
+}
@@ -0,0 +1,95 @@
+/**
+ * @file Exporter.h
+ * @brief Заголовочный файл класса Exporter, поддерживающего готовый файл полной выгрузки CMDB.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../../CMDB/CMDB.h"
+#include "../View/BodyStream.h"
+#include "../View/Compressor.h"
+
+/**
+ * @struct ExporterConfig
+ * @brief Параметры файла выгрузки.
+ */
+struct ExporterConfig {
+    std::string directory;                      ///< Каталог файлов выгрузки (пустой - выгрузка выключена).
+    std::chrono::milliseconds settle{500};      ///< Время без модификаций перед пересборкой выгрузки.
+};
+
+/**
+ * @class Exporter
+ * @brief Фоновый поток, который держит сериализованную полную выгрузку (GET /all) в файле.
+ *
+ * Поток следит за поколением CMDB и, когда поколение не меняется в течение settle, записывает
+ * выгрузку снимка во временный файл, переименовывает его в cmdb-all-<поколение>.json и публикует.
+ * Если сжатие включено, рядом записывается сжатая копия cmdb-all-<поколение>.json.gz для клиентов,
+ * принимающих gzip. Опубликованный файл отдается сессиями без копирования в пользовательское
+ * пространство (sendfile), пока поколение CMDB совпадает с поколением файла. Предыдущая версия удаляется,
+ * когда ее перестают передавать (BodyFile).
+ */
+class Exporter {
+public:
+    /**
+     * @brief Конструктор. Создает каталог, удаляет оставшиеся в нем выгрузки и запускает фоновый поток.
+     * @param cmdb Экземпляр CMDB (должен пережить выгрузку).
+     * @param config Параметры выгрузки.
+     * @param compression Параметры сжатия (уровень 0 - сжатая копия не записывается).
+     */
+    Exporter(cmdb::CMDB& cmdb, const ExporterConfig& config, const CompressionConfig& compression = {});
+
+    /**
+     * @brief Деструктор. Останавливает фоновый поток.
+     */
+    ~Exporter();
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+    /**
+     * @brief Файл выгрузки для заданного поколения.
+     * @param generation Текущее поколение CMDB.
+     * @param encoding Кодирование ответа (сжатая копия есть только для gzip).
+     * @return Файл или nullptr, если выгрузка этого поколения в этом кодировании еще не готова.
+     */
+    std::shared_ptr<const BodyFile> current(uint64_t generation,
+                                            Compressor::Encoding encoding = Compressor::Encoding::Identity) const;
+
+private:
+    /**
+     * @brief Цикл фонового потока.
+     */
+    void run();
+
+    /**
+     * @brief Записывает выгрузку текущего снимка CMDB и публикует ее.
+     * @return true, если выгрузка опубликована.
+     */
+    bool rebuild();
+
+    /**
+     * @brief Переименовывает временный файл в окончательный и открывает его на чтение.
+     * @return Файл или nullptr при ошибке (файлы удаляются).
+     */
+    static std::shared_ptr<const BodyFile> publish(const std::string& temp, const std::string& path, uint64_t size);
+
+    cmdb::CMDB& cmdb_;                          ///< Экземпляр CMDB.
+    ExporterConfig config_;                     ///< Параметры выгрузки.
+    CompressionConfig compression_;             ///< Параметры сжатия.
+    mutable std::mutex file_mutex_;             ///< Мьютекс опубликованной выгрузки.
+    std::shared_ptr<const BodyFile> file_;      ///< Опубликованный файл выгрузки.
+    std::shared_ptr<const BodyFile> gzip_file_; ///< Сжатая копия опубликованной выгрузки (может отсутствовать).
+    uint64_t generation_ = 0;                   ///< Поколение опубликованной выгрузки.
+    std::mutex mutex_;                          ///< Мьютекс ожидания периода.
+    std::condition_variable cv_;                ///< Условная переменная остановки.
+    bool stop_ = false;                         ///< Флаг остановки потока.
+    std::thread thread_;                        ///< Фоновый поток.
+};
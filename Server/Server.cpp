@@ -1,60 +1,135 @@
 #include "Server.h"
+#include <algorithm>
 
 
-Server::Server(int port, size_t thread_count, std::string db)
-    : db_(std::move(db)),
-      ioc_(thread_count),
-      acceptor_(ioc_, {tcp::v4(), static_cast<net::ip::port_type>(port)}),
-      pool_(thread_count),
-      cmdb_(cmdb::CMDB::getInstance(db_)),
+Server::Server(const ServerConfig& config)
+    : config_(config),
+      cmdb_(cmdb::CMDB::getInstance(config_.db, config_.shard_count)),
       data_store_(cmdb_),
-      handler_(data_store_) {}
+      handler_(data_store_, config_.response_cache, config_.compression) {
+    config_.io_threads = std::max<size_t>(config_.io_threads, 1);
+
+#ifndef SO_REUSEPORT
+    if (config_.reuse_port) {
+        std::cerr << "SO_REUSEPORT не поддерживается, используется общий acceptor\n";
+        config_.reuse_port = false;
+    }
+#endif
+
+    size_t loop_count = config_.reuse_port ? config_.io_threads : 1;
+    int concurrency_hint = config_.reuse_port ? 1 : static_cast<int>(config_.io_threads);
+
+    for (size_t i = 0; i < loop_count; ++i) {
+        loops_.push_back(std::make_unique<EventLoop>(concurrency_hint));
+        openAcceptor(*loops_.back(), i == 0 ? static_cast<unsigned short>(config_.port) : getPort());
+    }
+
+    if (config_.write_batch > 0) {
+        cmdb_.enableWritePipeline(config_.write_batch);
+    }
+
+    if (!config_.exporter.directory.empty()) {
+        exporter_ = std::make_unique<Exporter>(cmdb_, config_.exporter, config_.compression);
+        handler_.setExporter(exporter_.get());
+    }
+
+    if (config_.handler_threads > 0) {
+        size_t capacity = config_.session.max_pending;
+        size_t batch_concurrency = config_.batch_concurrency > 0
+            ? config_.batch_concurrency
+            : std::max<size_t>(1, config_.handler_threads / 2);
+
+        std::vector<ThreadPool::Lane> lanes(RequestHandler::PRIORITY_COUNT);
+        lanes[RequestHandler::Interactive] = {capacity, 8, 0};
+        lanes[RequestHandler::Normal] = {capacity, 4, 0};
+        lanes[RequestHandler::Batch] = {capacity, 1, batch_concurrency};
+
+        size_t max_threads = std::max(config_.handler_threads, config_.handler_pool.max_threads);
+        pool_ = std::make_unique<ThreadPool>(config_.handler_threads, std::move(lanes), max_threads,
+                                             config_.handler_placement);
+
+        if (max_threads > config_.handler_threads) {
+            controller_ = std::make_unique<PoolController>(*pool_, config_.handler_pool);
+        }
+    }
+}
 
 Server::~Server() {
+    controller_.reset();
+    pool_.reset();
+    handler_.setExporter(nullptr);
+    exporter_.reset();
     cmdb_.saveToFile();
 }
 
 void Server::Run() {
-    std::cout << "HTTP сервер запущен на порту " << acceptor_.local_endpoint().port() << "\n";
-    acceptConnections();
-    ioc_.run();
+    std::cout << "HTTP сервер запущен на порту " << getPort() << "\n";
+
+    for (auto& loop : loops_) {
+        acceptConnections(*loop);
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(config_.io_threads - 1);
+
+    for (size_t i = 1; i < config_.io_threads; ++i) {
+        threads.emplace_back([this, i] { runLoop(i); });
+    }
+
+    runLoop(0);
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
 }
 
-void Server::acceptConnections() {
-    acceptor_.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
-        if (!ec) {
-            pool_.enqueue([this, socket = std::make_shared<tcp::socket>(std::move(socket))]() mutable {
-                session(socket);
-            });
-        }
-        acceptConnections();
-    });
+void Server::Stop() {
+    for (auto& loop : loops_) {
+        loop->ioc.stop();
+    }
+}
+
+unsigned short Server::getPort() const {
+    return loops_.front()->acceptor.local_endpoint().port();
 }
 
-void Server::session(std::shared_ptr<tcp::socket> socket) {
-    try {
-        beast::flat_buffer buffer;
-        http::request<http::string_body> req;
-        http::read(*socket, buffer, req);
+void Server::openAcceptor(EventLoop& loop, unsigned short port) {
+    tcp::endpoint endpoint{tcp::v4(), port};
 
-        http::response<http::string_body> res;
-        handler_.handleRequest(req, res);
+    loop.acceptor.open(endpoint.protocol());
+    loop.acceptor.set_option(net::socket_base::reuse_address(true));
 
-        http::write(*socket, res);
+#ifdef SO_REUSEPORT
+    if (config_.reuse_port) {
+        using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        loop.acceptor.set_option(reuse_port(true));
+    }
+#endif
 
-        beast::error_code ec;
-        socket->shutdown(tcp::socket::shutdown_send, ec);
+    loop.acceptor.bind(endpoint);
+    loop.acceptor.listen(config_.backlog);
+}
 
-        if (ec && ec != beast::errc::not_connected) {
-            throw beast::system_error(ec);
+void Server::acceptConnections(EventLoop& loop) {
+    loop.acceptor.async_accept(net::make_strand(loop.ioc), [this, &loop](boost::system::error_code ec, tcp::socket socket) {
+        if (ec == net::error::operation_aborted) {
+            return;
         }
 
-    } catch (const beast::system_error& e) {
-        if (e.code() == http::error::end_of_stream) {
-            return;
+        if (!ec) {
+            size_t active = ++connections_;
+            bool overloaded = config_.max_connections > 0 && active > config_.max_connections;
+
+            std::make_shared<Session>(std::move(socket), handler_, pool_.get(), config_.session, connections_)->run(overloaded);
         }
-        std::cerr << "Beast ошибка: " << e.what() << "\n";
-    } catch (const std::exception& e) {
-        std::cerr << "Ошибка: " << e.what() << "\n";
+        acceptConnections(loop);
+    });
+}
+
+void Server::runLoop(size_t index) {
+    if (config_.pin_threads) {
+        Topology::pinCurrentThread({Topology::system().cpu(index)});
     }
+
+    loops_[index % loops_.size()]->ioc.run();
 }
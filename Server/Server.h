@@ -12,8 +12,13 @@
 #include <iostream>
 #include <unordered_map>
 #include <thread>
+#include <memory>
+#include <vector>
 #include "ThreadPool/ThreadPool.h"
+#include "ThreadPool/PoolController.h"
+#include "Session.h"
 #include "Model/DataStore.h"
+#include "Model/Exporter.h"
 #include "Controller/RequestHandler.h"
 #include "../CMDB/CMDB.h"
 
@@ -23,22 +28,52 @@ namespace net = boost::asio;
 namespace json = boost::json;
 using tcp = net::ip::tcp;
 
+/**
+ * @struct ServerConfig
+ * @brief Параметры запуска сервера.
+ */
+struct ServerConfig {
+    int port = 8080;                                          ///< Порт для прослушивания (0 - выбирается системой).
+    size_t io_threads = std::thread::hardware_concurrency();  ///< Количество потоков ввода-вывода.
+    size_t handler_threads = 0;                               ///< Количество потоков обработчиков (0 - обработка в потоках ввода-вывода).
+    PoolControllerConfig handler_pool{1, 0};                  ///< Пределы адаптивного числа обработчиков (max_threads 0 - число постоянно).
+    size_t batch_concurrency = 0;                             ///< Максимум одновременно выполняемых пакетных запросов (0 - половина потоков обработчиков).
+    std::string db = "cmdb.bin";                              ///< Путь или идентификатор базы данных.
+    size_t shard_count = cmdb::CMDB::DEFAULT_SHARD_COUNT;     ///< Количество сегментов хранилища CMDB.
+    size_t write_batch = 0;                                   ///< Размер пачки конвейера модификаций (0 - модификации применяются в потоках запросов).
+    size_t max_connections = 0;                               ///< Максимум открытых соединений, сверх него отвечаем 503 (0 - без ограничения).
+    int backlog = net::socket_base::max_listen_connections;   ///< Длина очереди ожидающих приема соединений.
+    bool reuse_port = false;                                  ///< Отдельные acceptor и io_context на каждый поток ввода-вывода (SO_REUSEPORT).
+    bool pin_threads = false;                                 ///< Привязывать потоки ввода-вывода к ядрам процессора.
+    ThreadPool::Placement handler_placement = ThreadPool::Placement::Floating; ///< Размещение потоков обработчиков.
+    SessionConfig session;                                    ///< Параметры HTTP-сессий.
+    ResponseCacheConfig response_cache;                       ///< Параметры кэша ответов на чтение.
+    CompressionConfig compression;                            ///< Параметры сжатия ответов (gzip / deflate).
+    ExporterConfig exporter;                                  ///< Параметры файла полной выгрузки (GET /all через sendfile).
+};
+
 /**
  * @class Server
- * @brief Класс, реализующий асинхронный HTTP-сервер с обработкой запросов в пуле потоков.
+ * @brief Класс, реализующий асинхронный HTTP-сервер.
  *
- * Сервер принимает входящие соединения, распределяет задачи по потокам и обрабатывает HTTP-запросы,
- * используя RequestHandler и доступ к данным через DataStore и CMDB.
+ * Сервер принимает входящие соединения и обслуживает каждое асинхронной сессией (Session).
+ * По умолчанию один acceptor и один io_context выполняются всеми потоками ввода-вывода.
+ * В режиме reuse_port у каждого потока свой цикл событий: io_context и acceptor, открытый
+ * с SO_REUSEPORT на общем порту, так что ядро распределяет соединения между потоками,
+ * а каждое соединение от приема до закрытия обслуживается одним потоком.
+ * Обработка запросов может быть вынесена в отдельный пул потоков. В пуле три полосы по классам
+ * запросов (RequestHandler::classify) с весами 8:4:1, а пакетные запросы занимают не больше
+ * batch_concurrency потоков, поэтому выгрузки и пакетные добавления не задерживают точечные чтения.
+ * Если handler_pool.max_threads больше handler_threads, число обработчиков подбирает PoolController
+ * по времени ожидания запросов в очереди и загрузке процессора.
  */
 class Server {
 public:
     /**
      * @brief Конструктор сервера.
-     * @param port Порт для прослушивания входящих соединений.
-     * @param thread_count Количество рабочих потоков.
-     * @param db Путь или идентификатор базы данных.
+     * @param config Параметры запуска.
      */
-    Server(int port, size_t thread_count, std::string db);
+    explicit Server(const ServerConfig& config);
 
     /**
      * @brief Деструктор сервера.
@@ -46,27 +81,54 @@ public:
     ~Server();
 
     /**
-     * @brief Запускает сервер: инициализирует прослушивание и потоковый пул.
+     * @brief Запускает сервер и блокируется до его остановки.
      */
     void Run();
 
+    /**
+     * @brief Останавливает сервер. Может вызываться из любого потока.
+     */
+    void Stop();
+
+    /**
+     * @brief Получить порт, на котором сервер принимает соединения.
+     */
+    unsigned short getPort() const;
+
 private:
     /**
-     * @brief Принимает входящие соединения и запускает сессию обработки запроса.
+     * @struct EventLoop
+     * @brief Цикл событий: контекст ввода/вывода и принимающий соединения acceptor.
+     */
+    struct EventLoop {
+        explicit EventLoop(int concurrency_hint) : ioc(concurrency_hint), acceptor(ioc) {}
+
+        net::io_context ioc;             ///< Контекст ввода/вывода Boost.Asio.
+        tcp::acceptor acceptor;          ///< Acceptor для входящих соединений.
+    };
+
+    /**
+     * @brief Открывает acceptor цикла событий на заданном порту.
+     */
+    void openAcceptor(EventLoop& loop, unsigned short port);
+
+    /**
+     * @brief Принимает входящие соединения и запускает для каждого асинхронную сессию.
      */
-    void acceptConnections();
+    void acceptConnections(EventLoop& loop);
 
     /**
-     * @brief Обрабатывает отдельную сессию HTTP-запроса.
-     * @param socket Указатель на сокет подключения.
+     * @brief Выполняет цикл событий в потоке ввода-вывода с заданным номером.
      */
-    void session(std::shared_ptr<tcp::socket> socket);
+    void runLoop(size_t index);
 
-    std::string db_;                      ///< Имя или путь к базе данных.
-    net::io_context ioc_;                ///< Контекст ввода/вывода Boost.Asio.
-    tcp::acceptor acceptor_;             ///< Acceptor для входящих соединений.
-    ThreadPool pool_;                    ///< Пул потоков для обработки запросов.
+    ServerConfig config_;                ///< Параметры запуска.
+    std::atomic<size_t> connections_{0}; ///< Количество открытых соединений.
+    std::vector<std::unique_ptr<EventLoop>> loops_; ///< Циклы событий (один или по одному на поток).
     cmdb::CMDB& cmdb_;                   ///< Ссылка на объект CMDB.
     DataStore data_store_;              ///< Объект хранилища данных.
     RequestHandler handler_;            ///< Объект обработчика HTTP-запросов.
+    std::unique_ptr<Exporter> exporter_; ///< Файл полной выгрузки (может отсутствовать).
+    std::unique_ptr<ThreadPool> pool_;   ///< Пул потоков обработчиков (может отсутствовать).
+    std::unique_ptr<PoolController> controller_; ///< Регулятор числа обработчиков (может отсутствовать).
 };
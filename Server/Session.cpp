@@ -0,0 +1,389 @@
+#include "Session.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include "View/ResponseFormatter.h"
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Пауза перед повторной постановкой части ответа в заполненную полосу пула.
+ */
+constexpr std::chrono::milliseconds CHUNK_RETRY_DELAY{5};
+
+} // namespace
+
+
+Session::Session(tcp::socket&& socket, RequestHandler& handler, ThreadPool* offload, const SessionConfig& config,
+                 std::atomic<size_t>& connections)
+    : stream_(std::move(socket)),
+      send_timer_(stream_.get_executor()),
+      handler_(handler),
+      offload_(offload),
+      config_(config),
+      connections_(connections) {
+}
+
+Session::~Session() {
+    --connections_;
+}
+
+void Session::run(bool overloaded) {
+    overloaded_ = overloaded;
+
+    net::dispatch(stream_.get_executor(), beast::bind_front_handler(&Session::doRead, shared_from_this()));
+}
+
+void Session::doRead() {
+    parser_.emplace();
+    parser_->header_limit(static_cast<std::uint32_t>(config_.header_limit));
+    parser_->body_limit(config_.body_limit);
+
+    stream_.expires_after(config_.idle_timeout);
+
+    http::async_read_header(stream_, buffer_, *parser_, beast::bind_front_handler(&Session::onReadHeader, shared_from_this()));
+}
+
+void Session::onReadHeader(beast::error_code ec, std::size_t bytes_transferred) {
+    if (ec || overloaded_) {
+        onRead(ec, bytes_transferred);
+        return;
+    }
+
+    stream_.expires_after(config_.read_timeout);
+
+    http::async_read(stream_, buffer_, *parser_, beast::bind_front_handler(&Session::onRead, shared_from_this()));
+}
+
+void Session::onRead(beast::error_code ec, std::size_t) {
+    if (ec == http::error::end_of_stream) {
+        doClose();
+        return;
+    }
+
+    if (ec == http::error::header_limit) {
+        reject(http::status::request_header_fields_too_large, "Слишком большие заголовки запроса");
+        return;
+    }
+
+    if (ec == http::error::body_limit) {
+        reject(http::status::payload_too_large, "Слишком большое тело запроса");
+        return;
+    }
+
+    if (ec) {
+        if (ec != net::error::operation_aborted && ec != beast::error::timeout) {
+            std::cerr << "Beast ошибка: " << ec.message() << "\n";
+        }
+        return;
+    }
+
+    stream_.expires_never();
+
+    if (overloaded_) {
+        reject(http::status::service_unavailable, "Сервер перегружен");
+        return;
+    }
+
+    req_ = parser_->release();
+
+    if (!offload_) {
+        handle();
+        return;
+    }
+
+    lane_ = RequestHandler::classify(req_);
+
+    bool queued = offload_->enqueueTo(lane_, [self = shared_from_this()]() {
+        self->handle();
+    });
+
+    if (!queued) {
+        reject(http::status::service_unavailable, "Сервер перегружен");
+    }
+}
+
+void Session::handle() {
+    res_ = {};
+    res_.version(req_.version());
+
+    auto self = shared_from_this();
+
+#ifdef CMDB_WITH_COROUTINES
+    if (!offload_) {
+        net::co_spawn(stream_.get_executor(), [self]() -> net::awaitable<void> {
+            if (!self->openStream()) {
+                co_await self->handler_.asyncHandleRequest(self->req_, self->res_, net::use_awaitable);
+            }
+        }, [self](std::exception_ptr error) {
+            if (error) {
+                self->fail(error);
+            }
+            self->onHandled();
+        });
+        return;
+    }
+#endif
+
+    try {
+        if (openStream()) {
+            net::post(stream_.get_executor(), beast::bind_front_handler(&Session::onHandled, self));
+            return;
+        }
+
+        handler_.asyncHandleRequest(req_, res_, net::bind_executor(stream_.get_executor(),
+            beast::bind_front_handler(&Session::onHandled, self)));
+    } catch (...) {
+        fail(std::current_exception());
+        net::post(stream_.get_executor(), beast::bind_front_handler(&Session::onHandled, self));
+    }
+}
+
+bool Session::openStream() {
+    if (!handler_.handleRead(req_, res_, body_)) {
+        return false;
+    }
+
+    if (body_ && !body_->file() && req_.version() < 11) {
+        ResponseFormatter::makeBodyResponse(res_, *body_);
+        body_.reset();
+    }
+
+    return true;
+}
+
+void Session::fail(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        std::cerr << "Ошибка: " << e.what() << "\n";
+    } catch (...) {
+    }
+
+    body_.reset();
+    res_ = {};
+    res_.version(req_.version());
+    ResponseFormatter::makeErrorResponse(res_, http::status::internal_server_error, "Внутренняя ошибка сервера");
+}
+
+void Session::onHandled() {
+    res_.keep_alive(config_.keep_alive && req_.keep_alive());
+
+    if (body_) {
+        doWriteHeader();
+        return;
+    }
+
+    doWrite();
+}
+
+void Session::reject(http::status status, const std::string& message) {
+    res_ = {};
+    ResponseFormatter::makeErrorResponse(res_, status, message);
+
+    if (status == http::status::service_unavailable) {
+        res_.set(http::field::retry_after, std::to_string(config_.retry_after.count()));
+    }
+
+    res_.keep_alive(false);
+
+    doWrite();
+}
+
+void Session::doWrite() {
+    stream_.expires_after(config_.write_timeout);
+
+    http::async_write(stream_, res_, beast::bind_front_handler(&Session::onWrite, shared_from_this()));
+}
+
+void Session::onWrite(beast::error_code ec, std::size_t) {
+    if (ec) {
+        if (ec != beast::error::timeout) {
+            std::cerr << "Beast ошибка: " << ec.message() << "\n";
+        }
+        return;
+    }
+
+    if (!res_.keep_alive()) {
+        doClose();
+        return;
+    }
+
+    doRead();
+}
+
+void Session::doWriteHeader() {
+    header_.emplace(res_.base());
+    serializer_.emplace(*header_);
+
+    stream_.expires_after(config_.write_timeout);
+
+    if (body_->file()) {
+        file_offset_ = 0;
+        http::async_write_header(stream_, *serializer_, beast::bind_front_handler(&Session::onSendFile, shared_from_this()));
+        return;
+    }
+
+    http::async_write_header(stream_, *serializer_, beast::bind_front_handler(&Session::onWriteChunk, shared_from_this()));
+}
+
+void Session::doWriteChunk() {
+    if (!offload_ || !body_) {
+        produceChunk();
+        writeChunk();
+        return;
+    }
+
+    // Часть сериализуется и сжимается в полосе запроса пула обработчиков, с учетом ее ограничений
+    bool queued = offload_->enqueueTo(lane_, [self = shared_from_this()]() {
+        self->produceChunk();
+        net::post(self->stream_.get_executor(), beast::bind_front_handler(&Session::writeChunk, self));
+    });
+
+    if (!queued) {
+        // Полоса заполнена: уже начатый ответ не отклоняется, постановка повторяется позже
+        send_timer_.expires_after(CHUNK_RETRY_DELAY);
+        send_timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+            if (!ec) {
+                self->doWriteChunk();
+            }
+        });
+    }
+}
+
+void Session::produceChunk() {
+    chunk_.clear();
+
+    try {
+        if (body_ && !body_->next(chunk_, config_.chunk_size)) {
+            body_.reset();
+        }
+    } catch (...) {
+        chunk_error_ = std::current_exception();
+    }
+}
+
+void Session::writeChunk() {
+    if (chunk_error_) {
+        abort(std::exchange(chunk_error_, nullptr));
+        return;
+    }
+
+    stream_.expires_after(config_.write_timeout);
+
+    if (chunk_.empty()) {
+        net::async_write(stream_, http::make_chunk_last(), beast::bind_front_handler(&Session::onWrite, shared_from_this()));
+        return;
+    }
+
+    net::async_write(stream_, http::make_chunk(net::buffer(chunk_)),
+                     beast::bind_front_handler(&Session::onWriteChunk, shared_from_this()));
+}
+
+void Session::onWriteChunk(beast::error_code ec, std::size_t) {
+    if (ec) {
+        if (ec != beast::error::timeout) {
+            std::cerr << "Beast ошибка: " << ec.message() << "\n";
+        }
+        return;
+    }
+
+    doWriteChunk();
+}
+
+void Session::doSendFile() {
+    const BodyFile& file = *body_->file();
+
+    if (file_offset_ == file.size()) {
+        send_timer_.cancel();
+        body_.reset();
+        onWrite({}, 0);
+        return;
+    }
+
+#ifdef __linux__
+    beast::error_code ec;
+    stream_.socket().native_non_blocking(true, ec);
+
+    off_t offset = static_cast<off_t>(file_offset_);
+    size_t count = static_cast<size_t>(std::min<uint64_t>(file.size() - file_offset_, config_.chunk_size * 16));
+    ssize_t sent = ::sendfile(stream_.socket().native_handle(), file.fd(), &offset, count);
+
+    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        std::cerr << "Ошибка sendfile: " << std::strerror(errno) << "\n";
+        send_timer_.cancel();
+        body_.reset();
+        return;
+    }
+
+    if (sent > 0) {
+        file_offset_ = static_cast<uint64_t>(offset);
+    }
+
+    // Следующая порция - когда сокет снова готов к записи; ожидание ограничено write_timeout.
+    send_timer_.expires_after(config_.write_timeout);
+    send_timer_.async_wait([weak = weak_from_this()](beast::error_code ec) {
+        if (auto self = weak.lock(); self && !ec) {
+            beast::error_code ignored;
+            self->stream_.socket().cancel(ignored);
+        }
+    });
+
+    stream_.socket().async_wait(tcp::socket::wait_write, [self = shared_from_this()](beast::error_code ec) {
+        self->onSendFile(ec, 0);
+    });
+#else
+    chunk_.clear();
+
+    try {
+        body_->next(chunk_, config_.chunk_size);
+    } catch (...) {
+        abort(std::current_exception());
+        return;
+    }
+
+    file_offset_ += chunk_.size();
+
+    stream_.expires_after(config_.write_timeout);
+
+    net::async_write(stream_, net::buffer(chunk_), beast::bind_front_handler(&Session::onSendFile, shared_from_this()));
+#endif
+}
+
+void Session::onSendFile(beast::error_code ec, std::size_t) {
+    if (ec) {
+        if (ec != beast::error::timeout && ec != net::error::operation_aborted) {
+            std::cerr << "Beast ошибка: " << ec.message() << "\n";
+        }
+        send_timer_.cancel();
+        body_.reset();
+        return;
+    }
+
+    doSendFile();
+}
+
+void Session::abort(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        std::cerr << "Ошибка потокового ответа: " << e.what() << "\n";
+    } catch (...) {
+    }
+
+    // Заголовки уже отправлены, поэтому об ошибке клиент узнает по оборванному соединению
+    send_timer_.cancel();
+    body_.reset();
+    stream_.close();
+}
+
+void Session::doClose() {
+    beast::error_code ec;
+    stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+}
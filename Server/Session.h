@@ -0,0 +1,215 @@
+/**
+ * @file Session.h
+ * @brief Заголовочный файл класса Session, реализующего асинхронную HTTP-сессию.
+ */
+
+#pragma once
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include "ThreadPool/ThreadPool.h"
+#include "Controller/RequestHandler.h"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+/**
+ * @struct SessionConfig
+ * @brief Параметры HTTP-сессий.
+ */
+struct SessionConfig {
+    bool keep_alive = true;                       ///< Сохранять соединение между запросами (HTTP/1.1 keep-alive).
+    std::chrono::seconds idle_timeout{30};        ///< Время ожидания заголовков следующего запроса.
+    std::chrono::seconds read_timeout{30};        ///< Время чтения тела запроса.
+    std::chrono::seconds write_timeout{30};       ///< Время записи ответа.
+    size_t header_limit = 8 * 1024;               ///< Максимальный размер заголовков запроса, байт.
+    size_t body_limit = 8 * 1024 * 1024;          ///< Максимальный размер тела запроса, байт.
+    size_t max_pending = 0;                       ///< Максимум запросов в очереди каждой полосы пула обработчиков (0 - без ограничения).
+    std::chrono::seconds retry_after{1};          ///< Значение Retry-After в ответах 503.
+    size_t chunk_size = 64 * 1024;                ///< Размер части потокового ответа, байт.
+};
+
+/**
+ * @class Session
+ * @brief Асинхронная сессия одного соединения.
+ *
+ * Чтение и запись выполняются асинхронно на io_context, поэтому медленный клиент не занимает поток.
+ * Обработка запроса выполняется в потоке ввода-вывода либо, если задан пул обработчиков,
+ * переносится в него, а ответ отправляется обратно на strand соединения. Транзакции не занимают
+ * поток на время групповой фиксации: обработка завершается, когда конвейер модификаций
+ * подтвердит фиксацию. В сборке с CMDB_WITH_COROUTINES запросы без пула обработчиков
+ * выполняются сопрограммой (co_spawn), ожидающей asyncHandleRequest через co_await.
+ *
+ * Если клиент и настройки допускают keep-alive, после ответа сессия читает следующий запрос из того же
+ * соединения. Запросы, отправленные клиентом подряд без ожидания ответов (pipelining), остаются в буфере
+ * чтения и обрабатываются строго по очереди, поэтому ответы уходят в порядке запросов.
+ *
+ * Большие ответы (GET /all и выборки CI и связей) передаются частями (chunked transfer encoding):
+ * следующая часть сериализуется только после записи предыдущей в сокет, поэтому память на
+ * соединение ограничена размером части (chunk_size), а медленный клиент замедляет сериализацию.
+ * При пуле обработчиков сериализация и сжатие частей выполняются в полосе запроса (например,
+ * Batch для GET /all) и подчиняются ее ограничению параллельности; потоки ввода-вывода только
+ * записывают готовые части.
+ * Если часть не удалось получить (ошибка чтения файла или сжатия), передача прерывается
+ * закрытием соединения. Клиентам HTTP/1.0 такие ответы отправляются целиком. Тело из готового файла (выгрузка GET /all)
+ * передается с Content-Length; в Linux - системным вызовом sendfile без копирования в
+ * пользовательское пространство, порциями по мере готовности сокета к записи.
+ *
+ * Каждая фаза ограничена по времени: ожидание и чтение заголовков (idle_timeout), чтение тела
+ * (read_timeout) и запись ответа (write_timeout). Запросы сверх header_limit / body_limit отклоняются
+ * ответами 431 / 413. Сессия, принятая сверх лимита соединений, или запрос, не поместившийся
+ * в очередь пула обработчиков, получают 503 с Retry-After, после чего соединение закрывается.
+ */
+class Session : public std::enable_shared_from_this<Session> {
+public:
+    /**
+     * @brief Конструктор сессии.
+     * @param socket Принятый сокет (его исполнитель должен быть strand).
+     * @param handler Обработчик HTTP-запросов.
+     * @param offload Пул для обработки запросов (nullptr - обработка в потоке ввода-вывода).
+     * @param config Параметры сессии.
+     * @param connections Счетчик открытых соединений, уже учитывающий это соединение; уменьшается при завершении сессии.
+     */
+    Session(tcp::socket&& socket, RequestHandler& handler, ThreadPool* offload, const SessionConfig& config,
+            std::atomic<size_t>& connections);
+
+    /**
+     * @brief Деструктор. Освобождает место в счетчике соединений.
+     */
+    ~Session();
+
+    /**
+     * @brief Запускает сессию.
+     * @param overloaded Соединение принято сверх лимита: на запрос будет отправлен ответ 503.
+     */
+    void run(bool overloaded = false);
+
+private:
+    /**
+     * @brief Начинает асинхронное чтение заголовков запроса.
+     */
+    void doRead();
+
+    /**
+     * @brief Завершение чтения заголовков, начало чтения тела запроса.
+     */
+    void onReadHeader(beast::error_code ec, std::size_t bytes_transferred);
+
+    /**
+     * @brief Завершение чтения запроса.
+     */
+    void onRead(beast::error_code ec, std::size_t bytes_transferred);
+
+    /**
+     * @brief Запускает обработку прочитанного запроса; по ее завершении на strand соединения
+     *        вызывается onHandled.
+     */
+    void handle();
+
+    /**
+     * @brief Готовит ответ на чтение (304, ответ из кэша или потоковый ответ), если запрос его допускает.
+     * @return true, если ответ готов и обработчик запроса вызывать не нужно.
+     */
+    bool openStream();
+
+    /**
+     * @brief Заменяет ответ ответом 500 после исключения обработчика.
+     */
+    void fail(std::exception_ptr error);
+
+    /**
+     * @brief Завершение обработки запроса, начало записи ответа.
+     */
+    void onHandled();
+
+    /**
+     * @brief Отправляет ответ с ошибкой и закрывает соединение после записи.
+     */
+    void reject(http::status status, const std::string& message);
+
+    /**
+     * @brief Начинает асинхронную запись ответа.
+     */
+    void doWrite();
+
+    /**
+     * @brief Завершение записи ответа.
+     */
+    void onWrite(beast::error_code ec, std::size_t bytes_transferred);
+
+    /**
+     * @brief Начинает запись заголовков потокового ответа.
+     */
+    void doWriteHeader();
+
+    /**
+     * @brief Получает следующую часть потокового ответа: в полосе запроса пула обработчиков
+     *        (если он задан) или в потоке ввода-вывода, затем записывает ее через writeChunk.
+     */
+    void doWriteChunk();
+
+    /**
+     * @brief Сериализует следующую часть в chunk_; исключение источника сохраняется в chunk_error_.
+     */
+    void produceChunk();
+
+    /**
+     * @brief Записывает подготовленную часть (после последней - завершающую часть)
+     *        или прерывает ответ после ошибки источника.
+     */
+    void writeChunk();
+
+    /**
+     * @brief Завершение записи заголовков или части потокового ответа.
+     */
+    void onWriteChunk(beast::error_code ec, std::size_t bytes_transferred);
+
+    /**
+     * @brief Передает следующую порцию тела из файла (после последней вызывает onWrite).
+     */
+    void doSendFile();
+
+    /**
+     * @brief Завершение ожидания готовности сокета или записи порции тела из файла.
+     */
+    void onSendFile(beast::error_code ec, std::size_t bytes_transferred);
+
+    /**
+     * @brief Прерывает потоковый ответ после ошибки источника тела: части больше не
+     *        отправляются, соединение закрывается.
+     */
+    void abort(std::exception_ptr error);
+
+    /**
+     * @brief Закрывает соединение на запись.
+     */
+    void doClose();
+
+    beast::tcp_stream stream_;                ///< Поток соединения.
+    beast::flat_buffer buffer_;               ///< Буфер чтения.
+    std::optional<http::request_parser<http::string_body>> parser_; ///< Парсер текущего запроса.
+    http::request<http::string_body> req_;    ///< Текущий запрос.
+    http::response<http::string_body> res_;   ///< Ответ на текущий запрос.
+    std::unique_ptr<BodyStream> body_;        ///< Источник тела потокового ответа.
+    std::optional<http::response<http::empty_body>> header_;                 ///< Заголовки потокового ответа.
+    std::optional<http::response_serializer<http::empty_body>> serializer_;  ///< Сериализатор заголовков.
+    std::string chunk_;                       ///< Текущая часть потокового ответа.
+    std::exception_ptr chunk_error_;          ///< Ошибка получения текущей части.
+    size_t lane_ = 0;                         ///< Полоса пула обработчиков текущего запроса.
+    uint64_t file_offset_ = 0;                ///< Передано байт тела из файла.
+    net::steady_timer send_timer_;            ///< Ожидание сокета при передаче файла; пауза перед повторной постановкой части в пул.
+    RequestHandler& handler_;                 ///< Обработчик HTTP-запросов.
+    ThreadPool* offload_;                     ///< Пул обработчиков (может отсутствовать).
+    SessionConfig config_;                    ///< Параметры сессии.
+    std::atomic<size_t>& connections_;        ///< Счетчик открытых соединений сервера.
+    bool overloaded_ = false;                 ///< Соединение принято сверх лимита.
+};
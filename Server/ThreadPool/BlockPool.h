@@ -0,0 +1,129 @@
+/**
+ * @file BlockPool.h
+ * @brief Пул блоков фиксированного размера с кэшем на поток.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+/**
+ * @class BlockPool
+ * @brief Пул блоков памяти одного размера.
+ *
+ * Каждый поток держит собственный список свободных блоков и обращается к общему списку
+ * (под мьютексом) только пачками по BATCH блоков: когда свой список пуст или переполнен.
+ * Блок может быть освобожден не тем потоком, который его выделил - он просто попадает
+ * в кэш освобождающего потока. Память возвращается системе только при завершении процесса.
+ *
+ * @tparam BlockSize Размер блока в байтах.
+ */
+template <size_t BlockSize>
+class BlockPool {
+public:
+    static constexpr size_t BATCH = 64; ///< Размер пачки обмена с общим списком.
+
+    /**
+     * @brief Выделить блок.
+     */
+    static void* allocate() {
+        Cache& local = cache();
+
+        if (!local.head) {
+            local.refill();
+        }
+
+        if (!local.head) {
+            return ::operator new(SIZE);
+        }
+
+        Block* block = local.head;
+        local.head = block->next;
+        --local.count;
+
+        return block;
+    }
+
+    /**
+     * @brief Освободить блок.
+     */
+    static void deallocate(void* pointer) {
+        Cache& local = cache();
+
+        Block* block = static_cast<Block*>(pointer);
+        block->next = local.head;
+        local.head = block;
+        ++local.count;
+
+        if (local.count > 2 * BATCH) {
+            local.spill(BATCH);
+        }
+    }
+
+private:
+    /**
+     * @struct Block
+     * @brief Свободный блок в списке.
+     */
+    struct Block {
+        Block* next; ///< Следующий свободный блок.
+    };
+
+    static constexpr size_t SIZE = BlockSize < sizeof(Block) ? sizeof(Block) : BlockSize; ///< Фактический размер блока.
+
+    /**
+     * @struct Cache
+     * @brief Список свободных блоков потока.
+     */
+    struct Cache {
+        Block* head = nullptr; ///< Первый свободный блок.
+        size_t count = 0;      ///< Количество свободных блоков.
+
+        /**
+         * @brief Забрать пачку блоков из общего списка.
+         */
+        void refill() {
+            std::lock_guard<std::mutex> lock(shared_mutex);
+
+            while (shared_head && count < BATCH) {
+                Block* block = shared_head;
+                shared_head = block->next;
+                block->next = head;
+                head = block;
+                ++count;
+            }
+        }
+
+        /**
+         * @brief Отдать блоки в общий список.
+         */
+        void spill(size_t amount) {
+            std::lock_guard<std::mutex> lock(shared_mutex);
+
+            while (head && amount-- > 0) {
+                Block* block = head;
+                head = block->next;
+                block->next = shared_head;
+                shared_head = block;
+                --count;
+            }
+        }
+
+        /**
+         * @brief При завершении потока все блоки уходят в общий список.
+         */
+        ~Cache() {
+            spill(count);
+        }
+    };
+
+    static Cache& cache() {
+        thread_local Cache local;
+        return local;
+    }
+
+    inline static std::mutex shared_mutex;     ///< Мьютекс общего списка.
+    inline static Block* shared_head = nullptr; ///< Общий список свободных блоков.
+};
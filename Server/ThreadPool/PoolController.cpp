@@ -0,0 +1,102 @@
+#include "PoolController.h"
+#include <algorithm>
+
+
+PoolController::PoolController(ThreadPool& pool, const PoolControllerConfig& config)
+    : pool_(pool),
+      config_(config),
+      last_wall_(Clock::now()),
+      last_cpu_(std::clock()) {
+    if (config_.max_threads == 0 || config_.max_threads > pool_.maxThreads()) {
+        config_.max_threads = pool_.maxThreads();
+    }
+    config_.min_threads = std::clamp<size_t>(config_.min_threads, 1, config_.max_threads);
+
+    pool_.resize(std::clamp(pool_.size(), config_.min_threads, config_.max_threads));
+
+    sendProbe();
+    thread_ = std::thread([this] { run(); });
+}
+
+PoolController::~PoolController() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+std::chrono::microseconds PoolController::latency() const {
+    return std::chrono::microseconds(latency_.load(std::memory_order_relaxed));
+}
+
+double PoolController::cpuLoad() const {
+    return cpu_load_.load(std::memory_order_relaxed);
+}
+
+void PoolController::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!cv_.wait_for(lock, config_.interval, [this] { return stop_; })) {
+        lock.unlock();
+        tick();
+        lock.lock();
+    }
+}
+
+void PoolController::tick() {
+    auto now = Clock::now();
+    std::clock_t cpu = std::clock();
+
+    double wall_seconds = std::chrono::duration<double>(now - last_wall_).count();
+    double cpu_seconds = static_cast<double>(cpu - last_cpu_) / CLOCKS_PER_SEC;
+    double cores = std::max(1u, std::thread::hardware_concurrency());
+    double load = wall_seconds > 0 ? cpu_seconds / (wall_seconds * cores) : 0.0;
+
+    last_wall_ = now;
+    last_cpu_ = cpu;
+    cpu_load_.store(load, std::memory_order_relaxed);
+
+    // Пока проба не выполнена, ее ожидание растет - это тоже измерение.
+    bool done = probe_->done.load(std::memory_order_acquire);
+    std::int64_t waited = done
+        ? probe_->waited.load(std::memory_order_relaxed)
+        : std::chrono::duration_cast<std::chrono::microseconds>(now - probe_->sent).count();
+    latency_.store(waited, std::memory_order_relaxed);
+
+    size_t queued = pool_.pending();
+
+    if (done) {
+        sendProbe();
+    }
+
+    size_t threads = pool_.size();
+    std::int64_t target = config_.target_latency.count();
+
+    if (waited > target && load < config_.max_cpu) {
+        calm_ticks_ = 0;
+
+        if (threads < config_.max_threads) {
+            pool_.resize(threads + 1);
+        }
+    } else if (waited * 2 <= target && queued == 0) {
+        if (++calm_ticks_ >= config_.shrink_after && threads > config_.min_threads) {
+            pool_.resize(threads - 1);
+            calm_ticks_ = 0;
+        }
+    } else {
+        calm_ticks_ = 0;
+    }
+}
+
+void PoolController::sendProbe() {
+    probe_ = std::make_shared<Probe>();
+    probe_->sent = Clock::now();
+
+    pool_.enqueue([probe = probe_]() {
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - probe->sent);
+        probe->waited.store(waited.count(), std::memory_order_relaxed);
+        probe->done.store(true, std::memory_order_release);
+    });
+}
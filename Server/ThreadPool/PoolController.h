@@ -0,0 +1,108 @@
+/**
+ * @file PoolController.h
+ * @brief Заголовочный файл класса PoolController, подбирающего число потоков пула по нагрузке.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "ThreadPool.h"
+
+/**
+ * @struct PoolControllerConfig
+ * @brief Параметры адаптивного управления пулом потоков.
+ */
+struct PoolControllerConfig {
+    size_t min_threads = 1;                                  ///< Минимальное число потоков.
+    size_t max_threads = 0;                                  ///< Максимальное число потоков (0 - максимум пула).
+    std::chrono::milliseconds interval{100};                 ///< Период измерений.
+    std::chrono::microseconds target_latency{5000};          ///< Допустимое время ожидания задачи в очереди.
+    double max_cpu = 0.9;                                    ///< Загрузка процессора, выше которой потоки не добавляются.
+    size_t shrink_after = 20;                                ///< Число спокойных периодов подряд перед удалением потока.
+};
+
+/**
+ * @class PoolController
+ * @brief Фоновый регулятор числа активных потоков ThreadPool.
+ *
+ * Раз в interval регулятор ставит в пул пробную задачу и измеряет, сколько она ждала начала
+ * выполнения. Если ожидание больше target_latency, а процессор загружен меньше max_cpu
+ * (потоки простаивают на блокировках или вводе-выводе), добавляется один поток. Если ожидание
+ * меньше половины target_latency и очередь пуста shrink_after периодов подряд, один поток
+ * убирается. Число потоков остается в пределах [min_threads, max_threads].
+ */
+class PoolController {
+public:
+    /**
+     * @brief Конструктор. Запускает поток регулятора.
+     * @param pool Управляемый пул (должен пережить регулятор).
+     * @param config Параметры регулирования.
+     */
+    PoolController(ThreadPool& pool, const PoolControllerConfig& config);
+
+    /**
+     * @brief Деструктор. Останавливает поток регулятора.
+     */
+    ~PoolController();
+
+    PoolController(const PoolController&) = delete;
+    PoolController& operator=(const PoolController&) = delete;
+
+    /**
+     * @brief Последнее измеренное время ожидания задачи в очереди.
+     */
+    std::chrono::microseconds latency() const;
+
+    /**
+     * @brief Последняя измеренная загрузка процессора (доля от всех ядер).
+     */
+    double cpuLoad() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @struct Probe
+     * @brief Пробная задача: время постановки и измеренное ожидание.
+     */
+    struct Probe {
+        Clock::time_point sent;                         ///< Время постановки в пул.
+        std::atomic<bool> done{false};                  ///< Задача начала выполняться.
+        std::atomic<std::int64_t> waited{0};            ///< Ожидание в очереди, мкс.
+    };
+
+    /**
+     * @brief Цикл регулятора.
+     */
+    void run();
+
+    /**
+     * @brief Одно измерение и, при необходимости, изменение числа потоков.
+     */
+    void tick();
+
+    /**
+     * @brief Ставит в пул новую пробную задачу.
+     */
+    void sendProbe();
+
+    ThreadPool& pool_;                                  ///< Управляемый пул.
+    PoolControllerConfig config_;                       ///< Параметры регулирования.
+    std::shared_ptr<Probe> probe_;                      ///< Текущая пробная задача.
+    Clock::time_point last_wall_;                       ///< Время предыдущего измерения.
+    std::clock_t last_cpu_;                             ///< Процессорное время процесса при предыдущем измерении.
+    size_t calm_ticks_ = 0;                             ///< Число спокойных периодов подряд.
+    std::atomic<std::int64_t> latency_{0};              ///< Последнее ожидание, мкс.
+    std::atomic<double> cpu_load_{0.0};                 ///< Последняя загрузка процессора.
+    std::mutex mutex_;                                  ///< Мьютекс ожидания периода.
+    std::condition_variable cv_;                        ///< Условная переменная остановки.
+    bool stop_ = false;                                 ///< Флаг остановки.
+    std::thread thread_;                                ///< Поток регулятора.
+};
@@ -0,0 +1,163 @@
+/**
+ * @file Task.h
+ * @brief Перемещаемая задача пула потоков без выделения памяти для небольших функций.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "BlockPool.h"
+
+/**
+ * @class Task
+ * @brief Задача без аргументов и результата, аналог std::function<void()> только с перемещением.
+ *
+ * Функции до INLINE_SIZE байт хранятся прямо в объекте (этого хватает для лямбд с несколькими
+ * указателями и shared_ptr). Более крупные функции размещаются в пуле блоков LARGE_SIZE байт,
+ * и только функции больше LARGE_SIZE - в куче. В отличие от std::function допускаются функции
+ * только с перемещением (например, std::packaged_task).
+ */
+class Task {
+public:
+    static constexpr size_t INLINE_SIZE = 64;  ///< Размер встроенного буфера.
+    static constexpr size_t LARGE_SIZE = 512;  ///< Размер блока пула для крупных функций.
+
+    /**
+     * @brief Пустая задача.
+     */
+    Task() noexcept = default;
+
+    /**
+     * @brief Создать задачу из функции.
+     * @param func Функция без аргументов.
+     */
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F&& func) {
+        using Func = std::decay_t<F>;
+
+        if constexpr (fitsInline<Func>()) {
+            new (storage) Func(std::forward<F>(func));
+            vtable = &inlineTable<Func>;
+        } else {
+            void* block = sizeof(Func) <= LARGE_SIZE && alignof(Func) <= alignof(std::max_align_t)
+                ? BlockPool<LARGE_SIZE>::allocate()
+                : ::operator new(sizeof(Func));
+            *reinterpret_cast<Func**>(storage) = new (block) Func(std::forward<F>(func));
+            vtable = &boxedTable<Func>;
+        }
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    /**
+     * @brief Перемещающий конструктор.
+     */
+    Task(Task&& other) noexcept : vtable(other.vtable) {
+        if (vtable) {
+            vtable->move(storage, other.storage);
+            other.reset();
+        }
+    }
+
+    /**
+     * @brief Перемещающее присваивание.
+     */
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+
+            if (other.vtable) {
+                vtable = other.vtable;
+                vtable->move(storage, other.storage);
+                other.reset();
+            }
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief Деструктор.
+     */
+    ~Task() {
+        reset();
+    }
+
+    /**
+     * @brief Выполнить задачу.
+     */
+    void operator()() {
+        vtable->invoke(storage);
+    }
+
+    /**
+     * @brief Проверка, что задача не пуста.
+     */
+    explicit operator bool() const noexcept {
+        return vtable != nullptr;
+    }
+
+private:
+    /**
+     * @struct VTable
+     * @brief Операции над хранимой функцией.
+     */
+    struct VTable {
+        void (*invoke)(void* storage);              ///< Вызвать функцию.
+        void (*move)(void* to, void* from);         ///< Переместить функцию (источник затем уничтожается).
+        void (*destroy)(void* storage);             ///< Уничтожить функцию.
+    };
+
+    template <class Func>
+    static constexpr bool fitsInline() {
+        return sizeof(Func) <= INLINE_SIZE
+            && alignof(Func) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<Func>;
+    }
+
+    template <class Func>
+    static void deallocate(Func* func) {
+        func->~Func();
+
+        if (sizeof(Func) <= LARGE_SIZE && alignof(Func) <= alignof(std::max_align_t)) {
+            BlockPool<LARGE_SIZE>::deallocate(func);
+        } else {
+            ::operator delete(func);
+        }
+    }
+
+    template <class Func>
+    inline static const VTable inlineTable = {
+        [](void* storage) { (*static_cast<Func*>(storage))(); },
+        [](void* to, void* from) { new (to) Func(std::move(*static_cast<Func*>(from))); },
+        [](void* storage) { static_cast<Func*>(storage)->~Func(); }
+    };
+
+    template <class Func>
+    inline static const VTable boxedTable = {
+        [](void* storage) { (**static_cast<Func**>(storage))(); },
+        [](void* to, void* from) { *static_cast<Func**>(to) = *static_cast<Func**>(from); *static_cast<Func**>(from) = nullptr; },
+        [](void* storage) {
+            if (Func* func = *static_cast<Func**>(storage)) {
+                deallocate(func);
+            }
+        }
+    };
+
+    /**
+     * @brief Уничтожить хранимую функцию.
+     */
+    void reset() noexcept {
+        if (vtable) {
+            vtable->destroy(storage);
+            vtable = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[INLINE_SIZE]; ///< Встроенный буфер.
+    const VTable* vtable = nullptr;                               ///< Операции над функцией.
+};
@@ -1,44 +1,466 @@
 #include "ThreadPool.h"
+#include <algorithm>
 
 
-ThreadPool::ThreadPool(size_t threads) : stop(false) {
-    for (size_t i = 0; i < threads; ++i) {
-        workers.emplace_back([this] { this->worker(); });
+namespace {
+
+thread_local const ThreadPool* current_pool = nullptr;  ///< Пул, которому принадлежит текущий поток.
+thread_local size_t current_index = 0;                  ///< Номер текущего потока в пуле.
+
+std::atomic<size_t> producer_seed{0};                   ///< Начальные входящие очереди внешних потоков.
+thread_local size_t next_inbox = producer_seed.fetch_add(1, std::memory_order_relaxed); ///< Входящая очередь для следующей внешней задачи потока.
+
+constexpr size_t MAX_LANES = 64;                        ///< Максимум полос (выбор полосы использует 64-битную маску).
+
+} // namespace
+
+ThreadPool::Worker::Worker(size_t lanes)
+    : inbox(lanes),
+      inbox_size(new std::atomic<size_t>[lanes]),
+      credit(lanes, 0) {
+    for (size_t i = 0; i < lanes; ++i) {
+        inbox_size[i].store(0, std::memory_order_relaxed);
     }
 }
 
-ThreadPool::~ThreadPool() {
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex);
-        stop = true;
+ThreadPool::ThreadPool(size_t threads, std::vector<Lane> lane_configs, size_t max_threads, Placement placement)
+    : stop(false), placement(placement) {
+    threads = std::max<size_t>(threads, 1);
+    max_threads = std::max(max_threads, threads);
+    active = threads;
+
+    if (lane_configs.empty()) {
+        lane_configs.emplace_back();
     }
-    cv.notify_all();
+    lane_configs.resize(std::min(lane_configs.size(), MAX_LANES));
+
+    for (const auto& config : lane_configs) {
+        lanes.push_back(std::make_unique<LaneState>());
+        lanes.back()->config = config;
+        lanes.back()->config.weight = std::max<size_t>(config.weight, 1);
+    }
+
+    for (size_t i = 0; i < max_threads; ++i) {
+        queues.push_back(std::make_unique<Worker>(lanes.size()));
+    }
+
+    const Topology& topology = Topology::system();
+
+    for (size_t i = 0; i < max_threads; ++i) {
+        for (size_t offset = 1; offset < max_threads; ++offset) {
+            queues[i]->victims.push_back((i + offset) % max_threads);
+        }
+
+        if (placement != Placement::Floating) {
+            std::stable_partition(queues[i]->victims.begin(), queues[i]->victims.end(), [&](size_t victim) {
+                return topology.node(victim) == topology.node(i);
+            });
+        }
+    }
+
+    for (size_t i = 0; i < max_threads; ++i) {
+        workers.emplace_back([this, i] { this->worker(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    stop = true;
+    wakeAll();
+    dormant_cv.notify_all();
+
     for (std::thread& worker : workers) {
         worker.join();
     }
 }
 
-void ThreadPool::enqueue(std::function<void()> func) {
+void ThreadPool::enqueue(Task func) {
+    push(makeNode(std::move(func)), defaultLane());
+}
+
+bool ThreadPool::tryEnqueue(Task func, size_t max_queued) {
+    if (max_queued > 0 && queued.load(std::memory_order_relaxed) >= max_queued) {
+        return false;
+    }
+
+    push(makeNode(std::move(func)), defaultLane());
+
+    return true;
+}
+
+bool ThreadPool::enqueueTo(size_t lane, Task func) {
+    auto& state = *lanes[std::min(lane, lanes.size() - 1)];
+    size_t capacity = state.config.capacity;
+
+    if (state.queued.fetch_add(1, std::memory_order_relaxed) >= capacity && capacity > 0) {
+        state.queued.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    push(makeNode(std::move(func)), std::min(lane, lanes.size() - 1));
+
+    return true;
+}
+
+void ThreadPool::enqueueBulk(std::vector<Task> funcs) {
+    if (funcs.empty()) {
+        return;
+    }
+
+    queued.fetch_add(funcs.size(), std::memory_order_relaxed);
+
+    if (current_pool == this) {
+        for (auto& func : funcs) {
+            queues[current_index]->local.push(makeNode(std::move(func)));
+        }
+    } else {
+        lanes[0]->queued.fetch_add(funcs.size(), std::memory_order_relaxed);
+
+        size_t targets = active.load(std::memory_order_relaxed);
+        size_t chunks = std::min(funcs.size(), targets);
+        size_t first = next_inbox;
+        next_inbox += chunks;
+
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            auto& target = *queues[(first + chunk) % targets];
+            size_t begin = funcs.size() * chunk / chunks;
+            size_t end = funcs.size() * (chunk + 1) / chunks;
+
+            std::lock_guard<std::mutex> lock(target.inbox_mutex);
+
+            for (size_t i = begin; i < end; ++i) {
+                target.inbox[0].push_back(makeNode(std::move(funcs[i])));
+            }
+            target.inbox_size[0].store(target.inbox[0].size(), std::memory_order_relaxed);
+        }
+    }
+
+    wake(funcs.size());
+}
+
+size_t ThreadPool::pending() const {
+    return queued.load(std::memory_order_relaxed);
+}
+
+size_t ThreadPool::pending(size_t lane) const {
+    return lanes[std::min(lane, lanes.size() - 1)]->queued.load(std::memory_order_relaxed);
+}
+
+size_t ThreadPool::laneCount() const {
+    return lanes.size();
+}
+
+void ThreadPool::resize(size_t threads) {
+    threads = std::clamp<size_t>(threads, 1, queues.size());
+
+    if (active.exchange(threads) == threads) {
+        return;
+    }
+
     {
-        std::lock_guard<std::mutex> lock(queue_mutex);
-        tasks.push(std::move(func));
+        std::lock_guard<std::mutex> lock(park_mutex);
     }
-    cv.notify_one();
+    dormant_cv.notify_all();
+    wakeAll();
 }
 
-void ThreadPool::worker() {
-    while (true) {
-        std::function<void()> task;
+size_t ThreadPool::size() const {
+    return active.load(std::memory_order_relaxed);
+}
+
+size_t ThreadPool::maxThreads() const {
+    return queues.size();
+}
+
+Task* ThreadPool::makeNode(Task&& func) {
+    return new (NodePool::allocate()) Task(std::move(func));
+}
+
+void ThreadPool::releaseNode(Task* task) {
+    task->~Task();
+    NodePool::deallocate(task);
+}
+
+size_t ThreadPool::defaultLane() {
+    if (current_pool == this) {
+        return NO_LANE;
+    }
+
+    lanes[0]->queued.fetch_add(1, std::memory_order_relaxed);
+
+    return 0;
+}
+
+void ThreadPool::push(Task* task, size_t lane) {
+    queued.fetch_add(1, std::memory_order_relaxed);
+
+    if (lane == NO_LANE) {
+        queues[current_index]->local.push(task);
+    } else {
+        // Очередь выбирается счетчиком потока: внешние потоки не конкурируют за общий счетчик
+        auto& target = *queues[next_inbox++ % active.load(std::memory_order_relaxed)];
+
+        std::lock_guard<std::mutex> lock(target.inbox_mutex);
+        target.inbox[lane].push_back(task);
+        target.inbox_size[lane].store(target.inbox[lane].size(), std::memory_order_relaxed);
+    }
+
+    notify();
+}
+
+void ThreadPool::notify() {
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+
+    // Пока разбуженный поток не вышел из ожидания, новые задачи найдет он: повторно не будим
+    if (searching.load(std::memory_order_seq_cst) == 0 && signaled.load(std::memory_order_seq_cst) == 0
+        && sleepers.load(std::memory_order_seq_cst) > 0) {
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            cv.wait(lock, [this] { return stop || !tasks.empty(); });
+            std::lock_guard<std::mutex> lock(park_mutex);
+            size_t pending = signaled.load(std::memory_order_relaxed);
+
+            if (pending >= waiting) {
+                return;
+            }
+            signaled.store(pending + 1, std::memory_order_seq_cst);
+        }
+        cv.notify_one();
+    }
+}
+
+void ThreadPool::wake(size_t count) {
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+
+    size_t sleeping = sleepers.load(std::memory_order_seq_cst);
+
+    if (sleeping == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+    }
+
+    if (count >= sleeping) {
+        cv.notify_all();
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        cv.notify_one();
+    }
+}
+
+void ThreadPool::wakeAll() {
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+    }
+    cv.notify_all();
+}
+
+bool ThreadPool::waitActive(size_t index) {
+    std::unique_lock<std::mutex> lock(park_mutex);
+    dormant_cv.wait(lock, [&] { return stop || index < active.load(std::memory_order_seq_cst); });
+
+    return !stop;
+}
+
+bool ThreadPool::acquireSlot(LaneState& state) {
+    size_t limit = state.config.max_concurrency;
+
+    if (limit == 0) {
+        return true;
+    }
+
+    size_t running = state.running.load(std::memory_order_relaxed);
+
+    while (running < limit) {
+        if (state.running.compare_exchange_weak(running, running + 1, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::releaseSlot(LaneState& state) {
+    if (state.config.max_concurrency == 0) {
+        return;
+    }
+
+    state.running.fetch_sub(1, std::memory_order_acq_rel);
+
+    if (state.queued.load(std::memory_order_relaxed) > 0) {
+        notify();
+    }
+}
+
+Task* ThreadPool::takeInbox(Worker& queue, size_t lane) {
+    if (queue.inbox_size[lane].load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(queue.inbox_mutex);
+
+    if (queue.inbox[lane].empty()) {
+        return nullptr;
+    }
+
+    Task* task = queue.inbox[lane].front();
+    queue.inbox[lane].pop_front();
+    queue.inbox_size[lane].store(queue.inbox[lane].size(), std::memory_order_relaxed);
+
+    return task;
+}
+
+Task* ThreadPool::takeLane(size_t index, size_t lane) {
+    Task* task = takeInbox(*queues[index], lane);
+
+    for (size_t i = 0; !task && i < queues[index]->victims.size(); ++i) {
+        task = takeInbox(*queues[queues[index]->victims[i]], lane);
+    }
+
+    if (task) {
+        lanes[lane]->queued.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return task;
+}
+
+Task* ThreadPool::findTask(size_t index, size_t& lane) {
+    auto& own = *queues[index];
+    lane = NO_LANE;
 
-            if (stop && tasks.empty())
+    // Пустой дек проверяется без барьера pop(): задачи в него кладет только сам поток
+    if (!own.local.empty()) {
+        if (Task* task = own.local.pop()) {
+            return task;
+        }
+    }
+
+    std::uint64_t tried = 0;
+
+    for (size_t attempt = 0; attempt < lanes.size(); ++attempt) {
+        size_t best = NO_LANE;
+        std::int64_t total = 0;
+
+        for (size_t l = 0; l < lanes.size(); ++l) {
+            auto& state = *lanes[l];
+            size_t limit = state.config.max_concurrency;
+
+            if ((tried >> l & 1) || state.queued.load(std::memory_order_relaxed) == 0
+                || (limit > 0 && state.running.load(std::memory_order_relaxed) >= limit)) {
+                continue;
+            }
+
+            own.credit[l] += static_cast<std::int64_t>(state.config.weight);
+            total += static_cast<std::int64_t>(state.config.weight);
+
+            if (best == NO_LANE || own.credit[l] > own.credit[best]) {
+                best = l;
+            }
+        }
+
+        if (best == NO_LANE) {
+            break;
+        }
+
+        own.credit[best] -= total;
+        tried |= std::uint64_t(1) << best;
+
+        auto& state = *lanes[best];
+
+        if (!acquireSlot(state)) {
+            continue;
+        }
+
+        if (Task* task = takeLane(index, best)) {
+            lane = best;
+            return task;
+        }
+
+        if (state.config.max_concurrency > 0) {
+            state.running.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    for (size_t victim : own.victims) {
+        if (Task* task = queues[victim]->local.steal()) {
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+void ThreadPool::worker(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    if (placement == Placement::Pinned) {
+        Topology::pinCurrentThread({Topology::system().cpu(index)});
+    } else if (placement == Placement::NumaNodes) {
+        Topology::pinCurrentThread(Topology::system().nodeCpus(Topology::system().node(index)));
+    }
+
+    while (true) {
+        if (index >= active.load(std::memory_order_relaxed) && queues[index]->local.empty()) {
+            // Пробуждение могло достаться этому потоку: передаем его активным потокам
+            notify();
+
+            if (!waitActive(index)) {
                 return;
+            }
+        }
+
+        size_t lane = NO_LANE;
+        Task* task = findTask(index, lane);
+
+        if (!task) {
+            searching.fetch_add(1, std::memory_order_seq_cst);
+            task = findTask(index, lane);
+
+            if (!task) {
+                std::uint64_t key = epoch.load(std::memory_order_seq_cst);
+                sleepers.fetch_add(1, std::memory_order_seq_cst);
+                searching.fetch_sub(1, std::memory_order_seq_cst);
+
+                task = findTask(index, lane);
+
+                if (!task && stop && queued.load(std::memory_order_seq_cst) == 0) {
+                    sleepers.fetch_sub(1, std::memory_order_seq_cst);
+                    return;
+                }
+
+                if (!task) {
+                    std::unique_lock<std::mutex> lock(park_mutex);
+                    ++waiting;
+                    cv.wait(lock, [&] { return epoch.load(std::memory_order_seq_cst) != key; });
+                    --waiting;
+
+                    if (size_t pending = signaled.load(std::memory_order_relaxed); pending > 0) {
+                        signaled.store(pending - 1, std::memory_order_seq_cst);
+                    }
+                }
+
+                sleepers.fetch_sub(1, std::memory_order_seq_cst);
+
+                if (!task) {
+                    continue;
+                }
+            } else if (searching.fetch_sub(1, std::memory_order_seq_cst) == 1 && queued.load(std::memory_order_relaxed) > 1) {
+                notify();
+            }
+        }
+
+        if (queued.fetch_sub(1, std::memory_order_seq_cst) == 1 && stop) {
+            wakeAll();
+        }
+
+        (*task)();
+        releaseNode(task);
 
-            task = std::move(tasks.front());
-            tasks.pop();
+        if (lane != NO_LANE) {
+            releaseSlot(*lanes[lane]);
         }
-        task();
     }
 }
@@ -5,27 +5,82 @@
 
 #pragma once
 
-#include <vector>
-#include <queue>
-#include <thread>
-#include <mutex>
+#include <atomic>
 #include <condition_variable>
-#include <functional>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "Task.h"
+#include "Topology.h"
+#include "WorkStealingDeque.h"
 
 /**
  * @class ThreadPool
  * @brief Класс для управления пулом потоков и асинхронным выполнением задач.
  *
- * Класс создает фиксированное количество потоков, которые обрабатывают 
- * задачи из очереди. Задачи можно добавлять через метод enqueue.
+ * Пул создает фиксированное количество потоков с перехватом задач (work stealing). У каждого
+ * потока есть lock-free дек для задач, порожденных им самим, и входящая очередь для задач
+ * из внешних потоков; внешние задачи распределяются по входящим очередям по кругу, поэтому
+ * постановка не конкурирует за одну блокировку. Свободный поток сначала берет свои задачи,
+ * затем перехватывает чужие и только после этого засыпает на счетчике событий. Новая задача
+ * будит спящий поток, только если никто уже не ищет работу и ни один разбуженный поток еще
+ * не вышел из ожидания; нашедший задачу поток будит следующего, поэтому потоки подключаются
+ * по мере роста нагрузки без лавины пробуждений. Внешний поток выбирает входящую очередь своим
+ * счетчиком, поэтому постановка из внешних потоков не конкурирует за общие переменные.
+ * Задачи можно добавлять через методы enqueue, enqueueTo, enqueueBulk и submit.
+ *
+ * Внешние задачи делятся на полосы приоритета (Lane). У полосы есть емкость (сверх нее enqueueTo
+ * отказывает), вес и ограничение числа одновременно выполняемых задач. Поток выбирает полосу
+ * взвешенным циклическим алгоритмом (smooth weighted round robin) среди непустых полос, не
+ * достигших своего ограничения, поэтому тяжелые задачи не задерживают легкие дольше, чем
+ * позволяют веса. Полоса 0 используется методами enqueue, tryEnqueue и enqueueBulk.
+ *
+ * Число активных потоков можно менять во время работы (resize) в пределах, заданных при создании:
+ * лишние потоки засыпают, а их задачи перехватывают оставшиеся потоки.
+ *
+ * Потоки могут быть привязаны к процессорам (Placement::Pinned) или к узлам NUMA
+ * (Placement::NumaNodes); потоки распределяются по узлам поочередно и перехватывают задачи
+ * сначала у потоков своего узла, поэтому данные задачи реже переходят между узлами.
+ *
+ * Задачи хранятся в объектах Task со встроенным буфером, а узлы очередей берутся из пула блоков,
+ * поэтому постановка небольшой задачи не выделяет память.
  */
 class ThreadPool {
 public:
+    /**
+     * @struct Lane
+     * @brief Параметры полосы приоритета.
+     */
+    struct Lane {
+        size_t capacity = 0;           ///< Максимум задач в очереди полосы (0 - без ограничения).
+        size_t weight = 1;             ///< Вес полосы при выборе следующей задачи.
+        size_t max_concurrency = 0;    ///< Максимум одновременно выполняемых задач полосы (0 - без ограничения).
+    };
+
+    /**
+     * @enum Placement
+     * @brief Размещение рабочих потоков по процессорам.
+     */
+    enum class Placement {
+        Floating,   ///< Потоки не привязаны, планировщик ОС размещает их сам.
+        Pinned,     ///< Каждый поток привязан к своему процессору.
+        NumaNodes,  ///< Каждый поток привязан к процессорам своего узла NUMA.
+    };
+
     /**
      * @brief Конструктор пула потоков.
      * @param threads Количество потоков в пуле.
+     * @param lanes Полосы приоритета (если не заданы - одна полоса без ограничений).
+     * @param max_threads Максимальное число потоков для resize (0 - равно threads).
+     * @param placement Размещение потоков по процессорам.
      */
-    explicit ThreadPool(size_t threads);
+    explicit ThreadPool(size_t threads, std::vector<Lane> lanes = {}, size_t max_threads = 0,
+                        Placement placement = Placement::Floating);
 
     /**
      * @brief Деструктор. Останавливает все потоки и завершает выполнение задач.
@@ -36,17 +91,198 @@ public:
      * @brief Добавляет задачу в очередь для выполнения.
      * @param func Функция без аргументов, которая будет выполнена в одном из потоков.
      */
-    void enqueue(std::function<void()> func);
+    void enqueue(Task func);
+
+    /**
+     * @brief Добавляет задачу в очередь, если очередь не переполнена.
+     * @param func Функция без аргументов, которая будет выполнена в одном из потоков.
+     * @param max_queued Максимальная длина очереди (0 - без ограничения).
+     * @return true, если задача поставлена в очередь.
+     */
+    bool tryEnqueue(Task func, size_t max_queued);
+
+    /**
+     * @brief Добавляет задачу в полосу приоритета с учетом ее емкости.
+     * @param lane Номер полосы.
+     * @param func Функция без аргументов, которая будет выполнена в одном из потоков.
+     * @return true, если задача поставлена в очередь; false, если полоса заполнена.
+     */
+    bool enqueueTo(size_t lane, Task func);
+
+    /**
+     * @brief Добавляет пачку задач, блокируя каждую входящую очередь один раз
+     *        и пробуждая не больше потоков, чем задач в пачке.
+     * @param funcs Задачи.
+     */
+    void enqueueBulk(std::vector<Task> funcs);
+
+    /**
+     * @brief Добавляет задачу и возвращает future с ее результатом.
+     * @param func Функция без аргументов.
+     * @return future с результатом или исключением функции.
+     */
+    template <class F>
+    std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& func) {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+
+        std::packaged_task<Result()> task(std::forward<F>(func));
+        auto future = task.get_future();
+
+        enqueue([task = std::move(task)]() mutable { task(); });
+
+        return future;
+    }
+
+    /**
+     * @brief Количество задач, ожидающих выполнения.
+     */
+    size_t pending() const;
+
+    /**
+     * @brief Количество задач полосы, ожидающих выполнения.
+     */
+    size_t pending(size_t lane) const;
+
+    /**
+     * @brief Количество полос приоритета.
+     */
+    size_t laneCount() const;
+
+    /**
+     * @brief Изменяет число активных потоков.
+     * @param threads Новое число потоков (ограничивается диапазоном [1, maxThreads()]).
+     */
+    void resize(size_t threads);
+
+    /**
+     * @brief Текущее число активных потоков.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Максимальное число потоков.
+     */
+    size_t maxThreads() const;
 
 private:
+    using NodePool = BlockPool<sizeof(Task)>;
+
+    static constexpr size_t NO_LANE = static_cast<size_t>(-1); ///< Задача из локального дека потока.
+
+    /**
+     * @struct LaneState
+     * @brief Параметры и счетчики полосы.
+     */
+    struct LaneState {
+        Lane config;                                ///< Параметры.
+        std::atomic<size_t> queued{0};              ///< Задач в очереди.
+        std::atomic<size_t> running{0};             ///< Задач выполняется (учитывается при max_concurrency).
+    };
+
+    /**
+     * @struct Worker
+     * @brief Очереди одного рабочего потока.
+     */
+    struct Worker {
+        explicit Worker(size_t lanes);
+
+        WorkStealingDeque<Task> local;                          ///< Задачи, порожденные этим потоком.
+        std::mutex inbox_mutex;                                 ///< Мьютекс входящих очередей.
+        std::vector<std::deque<Task*>> inbox;                   ///< Задачи из внешних потоков по полосам.
+        std::unique_ptr<std::atomic<size_t>[]> inbox_size;      ///< Размеры входящих очередей (для проверки без блокировки).
+        std::vector<std::int64_t> credit;                       ///< Текущие веса полос (выбор полосы этим потоком).
+        std::vector<size_t> victims;                            ///< Порядок перехвата: сначала потоки своего узла.
+    };
+
+    /**
+     * @brief Метод, выполняемый каждым потоком. Ищет задачи и выполняет их.
+     * @param index Номер потока.
+     */
+    void worker(size_t index);
+
+    /**
+     * @brief Размещает задачу в узле из пула.
+     */
+    static Task* makeNode(Task&& func);
+
+    /**
+     * @brief Уничтожает задачу и возвращает узел в пул.
+     */
+    static void releaseNode(Task* task);
+
+    /**
+     * @brief Полоса для задачи без явной полосы: локальный дек в потоке пула, иначе полоса 0.
+     */
+    size_t defaultLane();
+
+    /**
+     * @brief Ставит задачу в очередь и будит один спящий поток.
+     * @param task Задача.
+     * @param lane Полоса (счетчик полосы уже увеличен) или NO_LANE для локального дека.
+     */
+    void push(Task* task, size_t lane);
+
+    /**
+     * @brief Находит задачу для потока: свой дек, затем полосы по весам, затем перехват.
+     * @param index Номер потока.
+     * @param lane Полоса найденной задачи (NO_LANE для задач из деков).
+     */
+    Task* findTask(size_t index, size_t& lane);
+
+    /**
+     * @brief Берет задачу полосы из своей входящей очереди или из чужих.
+     */
+    Task* takeLane(size_t index, size_t lane);
+
+    /**
+     * @brief Извлекает задачу полосы из входящей очереди потока.
+     */
+    static Task* takeInbox(Worker& queue, size_t lane);
+
+    /**
+     * @brief Занимает место выполнения в полосе с ограничением параллельности.
+     */
+    static bool acquireSlot(LaneState& state);
+
+    /**
+     * @brief Освобождает место выполнения в полосе.
+     */
+    void releaseSlot(LaneState& state);
+
+    /**
+     * @brief Будит один спящий поток, если такие есть и никто уже не ищет задачи.
+     */
+    void notify();
+
+    /**
+     * @brief Будит до count спящих потоков одним событием.
+     */
+    void wake(size_t count);
+
+    /**
+     * @brief Будит все спящие потоки (остановка пула).
+     */
+    void wakeAll();
+
     /**
-     * @brief Метод, выполняемый каждым потоком. Ожидает задачи и выполняет их.
+     * @brief Ожидает, пока поток снова станет активным или пул остановится.
+     * @return false, если пул остановлен.
      */
-    void worker();
+    bool waitActive(size_t index);
 
-    std::vector<std::thread> workers;               ///< Вектор рабочих потоков.
-    std::queue<std::function<void()>> tasks;        ///< Очередь задач.
-    std::mutex queue_mutex;                         ///< Мьютекс для синхронизации доступа к очереди.
-    std::condition_variable cv;                     ///< Условная переменная для уведомления потоков.
-    bool stop;                                      ///< Флаг завершения работы пула.
+    std::vector<std::thread> workers;                   ///< Вектор рабочих потоков.
+    std::vector<std::unique_ptr<Worker>> queues;        ///< Очереди рабочих потоков.
+    std::vector<std::unique_ptr<LaneState>> lanes;      ///< Полосы приоритета.
+    std::atomic<size_t> active{0};                      ///< Количество активных потоков.
+    std::atomic<size_t> queued{0};                      ///< Количество задач в очередях.
+    std::atomic<std::uint64_t> epoch{0};                ///< Счетчик событий (для засыпания без потерянных пробуждений).
+    std::atomic<size_t> sleepers{0};                    ///< Количество засыпающих потоков.
+    std::atomic<size_t> searching{0};                   ///< Количество потоков, ищущих задачи.
+    std::atomic<size_t> signaled{0};                    ///< Разбуженные потоки, еще не вышедшие из ожидания (меняется под park_mutex).
+    size_t waiting = 0;                                 ///< Количество потоков в ожидании на cv (под park_mutex).
+    std::mutex park_mutex;                              ///< Мьютекс для засыпания потоков.
+    std::condition_variable cv;                         ///< Условная переменная для уведомления потоков.
+    std::condition_variable dormant_cv;                 ///< Условная переменная для неактивных потоков.
+    std::atomic<bool> stop;                             ///< Флаг завершения работы пула.
+    Placement placement;                                ///< Размещение потоков.
 };
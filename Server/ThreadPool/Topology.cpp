@@ -0,0 +1,194 @@
+#include "Topology.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+/**
+ * @brief Читает узлы NUMA из sysfs (пустой результат, если сведений нет).
+ */
+std::vector<std::vector<int>> readNodes() {
+    std::vector<std::vector<int>> nodes;
+
+#ifdef __linux__
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+
+    if (online && std::getline(online, list)) {
+        for (int node : Topology::parseCpuList(list)) {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string cpus;
+
+            if (file && std::getline(file, cpus)) {
+                auto parsed = Topology::parseCpuList(cpus);
+
+                if (!parsed.empty()) {
+                    nodes.push_back(std::move(parsed));
+                }
+            }
+        }
+    }
+#endif
+
+    return nodes;
+}
+
+} // namespace
+
+const Topology& Topology::system() {
+    static const Topology topology = [] {
+        auto nodes = readNodes();
+
+        if (nodes.empty()) {
+            std::vector<int> cpus(std::max(std::thread::hardware_concurrency(), 1u));
+
+            for (size_t i = 0; i < cpus.size(); ++i) {
+                cpus[i] = static_cast<int>(i);
+            }
+            nodes.push_back(std::move(cpus));
+        }
+
+        return Topology(std::move(nodes));
+    }();
+
+    return topology;
+}
+
+Topology::Topology(std::vector<std::vector<int>> nodes) : nodes_(std::move(nodes)) {
+    if (nodes_.empty()) {
+        nodes_.push_back({0});
+    }
+}
+
+size_t Topology::nodeCount() const {
+    return nodes_.size();
+}
+
+const std::vector<int>& Topology::nodeCpus(size_t node) const {
+    return nodes_[node % nodes_.size()];
+}
+
+size_t Topology::cpuCount() const {
+    size_t count = 0;
+
+    for (const auto& node : nodes_) {
+        count += node.size();
+    }
+
+    return count;
+}
+
+size_t Topology::node(size_t index) const {
+    return index % nodes_.size();
+}
+
+int Topology::cpu(size_t index) const {
+    const auto& cpus = nodes_[node(index)];
+
+    return cpus[index / nodes_.size() % cpus.size()];
+}
+
+bool Topology::pinCurrentThread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+bool Topology::setMemoryPolicy(MemoryPolicy policy) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    // Значения из <linux/mempolicy.h>; libnuma для одного системного вызова не подключаем.
+    constexpr int MPOL_DEFAULT_MODE = 0;
+    constexpr int MPOL_INTERLEAVE_MODE = 3;
+    constexpr int MPOL_LOCAL_MODE = 4;
+
+    if (policy == MemoryPolicy::Interleave) {
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string list;
+        std::vector<int> nodes = online && std::getline(online, list) ? parseCpuList(list) : std::vector<int>{};
+
+        if (nodes.size() < 2) {
+            return true;
+        }
+
+        constexpr size_t BITS = sizeof(unsigned long) * 8;
+        size_t max_node = static_cast<size_t>(*std::max_element(nodes.begin(), nodes.end()));
+        std::vector<unsigned long> mask(max_node / BITS + 1, 0);
+
+        for (int node : nodes) {
+            mask[static_cast<size_t>(node) / BITS] |= 1UL << (static_cast<size_t>(node) % BITS);
+        }
+
+        return syscall(SYS_set_mempolicy, MPOL_INTERLEAVE_MODE, mask.data(), max_node + 2) == 0;
+    }
+
+    int mode = policy == MemoryPolicy::Local ? MPOL_LOCAL_MODE : MPOL_DEFAULT_MODE;
+
+    return syscall(SYS_set_mempolicy, mode, nullptr, 0) == 0;
+#else
+    return policy == MemoryPolicy::Default;
+#endif
+}
+
+bool Topology::parseMemoryPolicy(const std::string& name, MemoryPolicy& policy) {
+    if (name == "default") {
+        policy = MemoryPolicy::Default;
+    } else if (name == "local") {
+        policy = MemoryPolicy::Local;
+    } else if (name == "interleave") {
+        policy = MemoryPolicy::Interleave;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<int> Topology::parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+
+        size_t dash = item.find('-');
+
+        try {
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+
+    return cpus;
+}
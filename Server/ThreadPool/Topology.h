@@ -0,0 +1,98 @@
+/**
+ * @file Topology.h
+ * @brief Заголовочный файл класса Topology: узлы NUMA, привязка потоков и политика размещения памяти.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @enum MemoryPolicy
+ * @brief Политика размещения памяти процесса по узлам NUMA.
+ */
+enum class MemoryPolicy {
+    Default,     ///< Политика ОС (первое касание).
+    Local,       ///< Память на узле потока, который ее выделяет.
+    Interleave,  ///< Страницы поочередно на всех узлах.
+};
+
+/**
+ * @class Topology
+ * @brief Процессоры, сгруппированные по узлам NUMA.
+ *
+ * На Linux узлы и их процессоры читаются из /sys/devices/system/node; если сведений нет
+ * (или платформа другая), все процессоры считаются одним узлом. Привязка потоков
+ * и политика памяти поддерживаются только на Linux, на других платформах методы
+ * возвращают false.
+ */
+class Topology {
+public:
+    /**
+     * @brief Определяет топологию текущей машины.
+     */
+    static const Topology& system();
+
+    /**
+     * @brief Создает топологию из списков процессоров узлов.
+     * @param nodes Процессоры каждого узла.
+     */
+    explicit Topology(std::vector<std::vector<int>> nodes);
+
+    /**
+     * @brief Количество узлов.
+     */
+    size_t nodeCount() const;
+
+    /**
+     * @brief Процессоры узла.
+     */
+    const std::vector<int>& nodeCpus(size_t node) const;
+
+    /**
+     * @brief Общее количество процессоров.
+     */
+    size_t cpuCount() const;
+
+    /**
+     * @brief Узел для потока с номером index: потоки распределяются по узлам поочередно.
+     */
+    size_t node(size_t index) const;
+
+    /**
+     * @brief Процессор для потока с номером index: на узле node(index), по кругу внутри узла.
+     */
+    int cpu(size_t index) const;
+
+    /**
+     * @brief Привязывает текущий поток к процессорам.
+     * @param cpus Номера процессоров.
+     * @return true, если привязка выполнена.
+     */
+    static bool pinCurrentThread(const std::vector<int>& cpus);
+
+    /**
+     * @brief Устанавливает политику размещения памяти для текущего потока
+     *        и потоков, которые он создаст после этого.
+     * @param policy Политика.
+     * @return true, если политика установлена.
+     */
+    static bool setMemoryPolicy(MemoryPolicy policy);
+
+    /**
+     * @brief Разбор политики памяти из строки ("default", "local", "interleave").
+     * @param name Название политики.
+     * @param policy Результат разбора.
+     * @return true, если название корректно.
+     */
+    static bool parseMemoryPolicy(const std::string& name, MemoryPolicy& policy);
+
+    /**
+     * @brief Разбор списка процессоров в формате sysfs ("0-3,8,10-11").
+     */
+    static std::vector<int> parseCpuList(const std::string& list);
+
+private:
+    std::vector<std::vector<int>> nodes_; ///< Процессоры каждого узла.
+};
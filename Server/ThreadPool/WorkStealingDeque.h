@@ -0,0 +1,163 @@
+/**
+ * @file WorkStealingDeque.h
+ * @brief Lock-free дек для планировщика с перехватом задач (Chase-Lev).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @class WorkStealingDeque
+ * @brief Дек задач одного рабочего потока.
+ *
+ * Владелец добавляет и извлекает элементы с нижнего конца (LIFO, горячий кэш), остальные потоки
+ * перехватывают элементы с верхнего конца (FIFO). Реализация по Chase-Lev в варианте
+ * Lê et al. для слабых моделей памяти. Буфер растет удвоением; старые буферы освобождаются
+ * только в деструкторе, поскольку перехватчик может еще читать из них.
+ *
+ * @tparam T Тип элемента (указатель на задачу).
+ */
+template <class T>
+class WorkStealingDeque {
+public:
+    /**
+     * @brief Конструктор.
+     * @param capacity Начальная емкость (степень двойки).
+     */
+    explicit WorkStealingDeque(size_t capacity = 256)
+        : top(0), bottom(0), buffer(new Ring(static_cast<std::int64_t>(capacity))) {}
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief Деструктор. Освобождает текущий и устаревшие буферы.
+     */
+    ~WorkStealingDeque() {
+        delete buffer.load(std::memory_order_relaxed);
+        for (Ring* ring : retired) {
+            delete ring;
+        }
+    }
+
+    /**
+     * @brief Добавить элемент (только поток-владелец).
+     */
+    void push(T* item) {
+        std::int64_t b = bottom.load(std::memory_order_relaxed);
+        std::int64_t t = top.load(std::memory_order_acquire);
+        Ring* ring = buffer.load(std::memory_order_relaxed);
+
+        if (b - t > ring->capacity - 1) {
+            ring = grow(ring, t, b);
+        }
+
+        ring->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Извлечь последний добавленный элемент (только поток-владелец).
+     * @return Элемент или nullptr, если дек пуст.
+     */
+    T* pop() {
+        std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* ring = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = ring->get(b);
+
+        if (t == b) {
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        return item;
+    }
+
+    /**
+     * @brief Перехватить самый старый элемент (любой поток).
+     * @return Элемент или nullptr, если дек пуст или перехват проигран другому потоку.
+     */
+    T* steal() {
+        std::int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) {
+            return nullptr;
+        }
+
+        Ring* ring = buffer.load(std::memory_order_acquire);
+        T* item = ring->get(t);
+
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        return item;
+    }
+
+    /**
+     * @brief Приблизительная проверка на пустоту.
+     */
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    /**
+     * @struct Ring
+     * @brief Кольцевой буфер элементов.
+     */
+    struct Ring {
+        explicit Ring(std::int64_t size) : capacity(size), mask(size - 1), items(new std::atomic<T*>[size]) {}
+
+        void put(std::int64_t index, T* item) {
+            items[index & mask].store(item, std::memory_order_relaxed);
+        }
+
+        T* get(std::int64_t index) const {
+            return items[index & mask].load(std::memory_order_relaxed);
+        }
+
+        std::int64_t capacity;                       ///< Емкость.
+        std::int64_t mask;                           ///< Маска индекса.
+        std::unique_ptr<std::atomic<T*>[]> items;    ///< Элементы.
+    };
+
+    /**
+     * @brief Удвоить буфер, перенеся элементы [t, b).
+     */
+    Ring* grow(Ring* ring, std::int64_t t, std::int64_t b) {
+        Ring* bigger = new Ring(ring->capacity * 2);
+
+        for (std::int64_t i = t; i < b; ++i) {
+            bigger->put(i, ring->get(i));
+        }
+
+        retired.push_back(ring);
+        buffer.store(bigger, std::memory_order_release);
+
+        return bigger;
+    }
+
+    alignas(64) std::atomic<std::int64_t> top;       ///< Верхний конец (перехват).
+    alignas(64) std::atomic<std::int64_t> bottom;    ///< Нижний конец (владелец).
+    std::atomic<Ring*> buffer;                       ///< Текущий буфер.
+    std::vector<Ring*> retired;                      ///< Устаревшие буферы.
+};
@@ -0,0 +1,194 @@
+#include "BodyStream.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+
+BodyFile::BodyFile(std::string path, int fd, uint64_t size)
+    : path_(std::move(path)),
+      fd_(fd),
+      size_(size) {
+}
+
+BodyFile::~BodyFile() {
+    ::close(fd_);
+    std::remove(path_.c_str());
+}
+
+int BodyFile::fd() const {
+    return fd_;
+}
+
+uint64_t BodyFile::size() const {
+    return size_;
+}
+
+const std::string& BodyFile::path() const {
+    return path_;
+}
+
+FileStream::FileStream(std::shared_ptr<const BodyFile> file) : file_(std::move(file)) {
+}
+
+bool FileStream::next(std::string& out, size_t limit) {
+    size_t start = out.size();
+    size_t length = static_cast<size_t>(std::min<uint64_t>(file_->size() - offset_, std::max<size_t>(limit, 1)));
+    out.resize(start + length);
+
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pread(file_->fd(), &out[start + done], length - done, static_cast<off_t>(offset_ + done));
+        if (n <= 0) {
+            out.resize(start + done);
+            throw std::runtime_error("Ошибка чтения файла " + file_->path());
+        }
+        done += static_cast<size_t>(n);
+    }
+
+    offset_ += length;
+
+    return offset_ < file_->size();
+}
+
+const BodyFile* FileStream::file() const {
+    return file_.get();
+}
+
+AllRecordsStream::AllRecordsStream(std::shared_ptr<const cmdb::Snapshot> snapshot, WireFormat format)
+    : snapshot_(std::move(snapshot)),
+      format_(format) {
+}
+
+bool AllRecordsStream::next(std::string& out, size_t limit) {
+    size_t start = out.size();
+
+    while (stage_ != Stage::Done && (out.size() - start < limit || out.size() == start)) {
+        switch (stage_) {
+        case Stage::Levels: {
+            const auto& levels = snapshot_->getLevels();
+
+            if (format_ == WireFormat::Cbor) {
+                size_t sections = 1 + (snapshot_->getCICount() > 0 ? 1 : 0) + (snapshot_->getRelationshipCount() > 0 ? 1 : 0);
+                CborWriter::writeHead(out, CborWriter::Map, sections);
+                CborWriter::writeString(out, "levels");
+                CborWriter::writeHead(out, CborWriter::Array, levels.size());
+                for (const auto& level : levels) {
+                    CborWriter::writeString(out, level);
+                }
+            } else {
+                out += "{\"levels\":[";
+                for (size_t i = 0; i < levels.size(); ++i) {
+                    if (i > 0) {
+                        out += ',';
+                    }
+                    JsonWriter::writeString(out, levels[i]);
+                }
+                out += ']';
+            }
+
+            if (snapshot_->getCICount() > 0) {
+                if (format_ == WireFormat::Cbor) {
+                    CborWriter::writeString(out, "cis");
+                    CborWriter::writeHead(out, CborWriter::Array, snapshot_->getCICount());
+                } else {
+                    out += ",\"cis\":[";
+                }
+                shard_ = 0;
+                ci_ = snapshot_->getShard(0).getCIMap().begin();
+                first_ = true;
+                stage_ = Stage::Cis;
+            } else {
+                beginRelationships(out);
+            }
+            break;
+        }
+        case Stage::Cis:
+            if (!seekCi()) {
+                if (format_ == WireFormat::Json) {
+                    out += ']';
+                }
+                beginRelationships(out);
+                break;
+            }
+
+            if (format_ == WireFormat::Cbor) {
+                CborWriter::write(out, *(ci_++)->second);
+                break;
+            }
+
+            if (!first_) {
+                out += ',';
+            }
+            first_ = false;
+            JsonWriter::write(out, *(ci_++)->second);
+            break;
+        case Stage::Relationships:
+            if (!seekRelationship()) {
+                if (format_ == WireFormat::Json) {
+                    out += "]}";
+                }
+                stage_ = Stage::Done;
+                break;
+            }
+
+            if (format_ == WireFormat::Cbor) {
+                CborWriter::writeLink(out, **(relationship_++));
+                break;
+            }
+
+            if (!first_) {
+                out += ',';
+            }
+            first_ = false;
+            JsonWriter::writeLink(out, **(relationship_++));
+            break;
+        case Stage::Done:
+            break;
+        }
+    }
+
+    return stage_ != Stage::Done;
+}
+
+void AllRecordsStream::beginRelationships(std::string& out) {
+    if (snapshot_->getRelationshipCount() == 0) {
+        if (format_ == WireFormat::Json) {
+            out += '}';
+        }
+        stage_ = Stage::Done;
+        return;
+    }
+
+    if (format_ == WireFormat::Cbor) {
+        CborWriter::writeString(out, "relationships");
+        CborWriter::writeHead(out, CborWriter::Array, snapshot_->getRelationshipCount());
+    } else {
+        out += ",\"relationships\":[";
+    }
+    shard_ = 0;
+    relationship_ = snapshot_->getShard(0).getRelationshipOrder().begin();
+    first_ = true;
+    stage_ = Stage::Relationships;
+}
+
+bool AllRecordsStream::seekCi() {
+    while (ci_ == snapshot_->getShard(shard_).getCIMap().end()) {
+        if (++shard_ == snapshot_->getShardCount()) {
+            return false;
+        }
+        ci_ = snapshot_->getShard(shard_).getCIMap().begin();
+    }
+
+    return true;
+}
+
+bool AllRecordsStream::seekRelationship() {
+    while (relationship_ == snapshot_->getShard(shard_).getRelationshipOrder().end()) {
+        if (++shard_ == snapshot_->getShardCount()) {
+            return false;
+        }
+        relationship_ = snapshot_->getShard(shard_).getRelationshipOrder().begin();
+    }
+
+    return true;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file BodyStream.h
+ * @brief Источники тела ответа, сериализуемого по частям (chunked transfer encoding).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../../CMDB/Snapshot.h"
+#include "Cbor.h"
+#include "JsonWriter.h"
+
+/**
+ * @enum WireFormat
+ * @brief Формат тела ответа.
+ */
+enum class WireFormat {
+    Json,   ///< application/json.
+    Cbor,   ///< application/cbor (RFC 8949), та же структура данных в двоичном виде.
+};
+
+/**
+ * @class BodyFile
+ * @brief Открытый на чтение файл с готовым телом ответа.
+ *
+ * Файл читается по смещению (pread, sendfile), поэтому один дескриптор одновременно
+ * используют все передающие его сессии. Деструктор закрывает дескриптор и удаляет файл:
+ * последняя сессия, передававшая устаревшую версию, освобождает ее.
+ */
+class BodyFile {
+public:
+    /**
+     * @brief Конструктор.
+     * @param path Путь к файлу (удаляется в деструкторе).
+     * @param fd Открытый на чтение дескриптор.
+     * @param size Размер файла, байт.
+     */
+    BodyFile(std::string path, int fd, uint64_t size);
+
+    BodyFile(const BodyFile&) = delete;
+    BodyFile& operator=(const BodyFile&) = delete;
+
+    /**
+     * @brief Деструктор. Закрывает дескриптор и удаляет файл.
+     */
+    ~BodyFile();
+
+    /**
+     * @brief Дескриптор файла.
+     */
+    int fd() const;
+
+    /**
+     * @brief Размер файла, байт.
+     */
+    uint64_t size() const;
+
+    /**
+     * @brief Путь к файлу.
+     */
+    const std::string& path() const;
+
+private:
+    std::string path_;  ///< Путь к файлу.
+    int fd_;            ///< Дескриптор файла.
+    uint64_t size_;     ///< Размер файла, байт.
+};
+
+/**
+ * @class BodyStream
+ * @brief Источник тела ответа, который выдает JSON частями.
+ *
+ * Сессия запрашивает следующую часть только после того, как предыдущая записана в сокет,
+ * поэтому в памяти одновременно находится не больше одной части независимо от размера ответа.
+ */
+class BodyStream {
+public:
+    virtual ~BodyStream() = default;
+
+    /**
+     * @brief Дописывает следующую часть тела в out.
+     *
+     * Элементы добавляются целиком, пока дописанная за вызов часть меньше limit (независимо от
+     * данных, уже лежащих в out), поэтому часть может превысить limit не больше чем на один элемент.
+     *
+     * @param out Буфер части.
+     * @param limit Желаемый размер части, байт.
+     * @return true, если тело еще не закончено.
+     */
+    virtual bool next(std::string& out, size_t limit) = 0;
+
+    /**
+     * @brief Файл, который целиком составляет тело (для передачи без копирования через sendfile).
+     * @return nullptr, если тело строится по частям.
+     */
+    virtual const BodyFile* file() const {
+        return nullptr;
+    }
+};
+
+/**
+ * @class FileStream
+ * @brief Тело ответа из готового файла.
+ */
+class FileStream : public BodyStream {
+public:
+    /**
+     * @brief Конструктор.
+     * @param file Файл с телом ответа.
+     */
+    explicit FileStream(std::shared_ptr<const BodyFile> file);
+
+    bool next(std::string& out, size_t limit) override;
+
+    const BodyFile* file() const override;
+
+private:
+    std::shared_ptr<const BodyFile> file_;  ///< Файл с телом ответа.
+    uint64_t offset_ = 0;                   ///< Смещение следующей части.
+};
+
+/**
+ * @class AllRecordsStream
+ * @brief Тело ответа GET /all: уровни, CI и связи снимка CMDB.
+ *
+ * Хранит снимок на все время передачи и обходит его сегменты итераторами, поэтому результат
+ * соответствует одной версии данных и совпадает с сериализацией DataStore::getAllRecords
+ * (в формате CBOR - по структуре).
+ */
+class AllRecordsStream : public BodyStream {
+public:
+    /**
+     * @brief Конструктор.
+     * @param snapshot Снимок CMDB.
+     * @param format Формат тела.
+     */
+    explicit AllRecordsStream(std::shared_ptr<const cmdb::Snapshot> snapshot, WireFormat format = WireFormat::Json);
+
+    bool next(std::string& out, size_t limit) override;
+
+private:
+    /**
+     * @enum Stage
+     * @brief Раздел тела, который выдается сейчас.
+     */
+    enum class Stage {
+        Levels,
+        Cis,
+        Relationships,
+        Done,
+    };
+
+    /**
+     * @brief Начинает раздел связей или закрывает объект, если связей нет.
+     */
+    void beginRelationships(std::string& out);
+
+    /**
+     * @brief Переходит к следующему непустому сегменту для CI.
+     * @return false, если CI закончились.
+     */
+    bool seekCi();
+
+    /**
+     * @brief Переходит к следующему непустому сегменту для связей.
+     * @return false, если связи закончились.
+     */
+    bool seekRelationship();
+
+    std::shared_ptr<const cmdb::Snapshot> snapshot_;            ///< Снимок CMDB.
+    WireFormat format_;                                         ///< Формат тела.
+    Stage stage_ = Stage::Levels;                               ///< Текущий раздел.
+    size_t shard_ = 0;                                          ///< Текущий сегмент.
+    cmdb::Snapshot::CIMap::const_iterator ci_;                  ///< Следующий CI сегмента.
+    cmdb::Snapshot::RelationshipOrder::const_iterator relationship_; ///< Следующая связь сегмента.
+    bool first_ = true;                                         ///< В разделе еще нет элементов.
+};
+
+/**
+ * @class ArrayStream
+ * @brief Тело ответа - JSON-массив объектов (CI или связей) из результата выборки.
+ *
+ * Массив можно обрамить произвольным JSON, например объектом страницы `{"items":[...],"next_cursor":...}`.
+ * Элементы сериализуются с проекцией на выбранные поля (параметр fields). В формате CBOR
+ * заголовок массива с числом элементов передается в prefix, а разделителей между элементами нет.
+ */
+template <class Ptr>
+class ArrayStream : public BodyStream {
+public:
+    /**
+     * @brief Конструктор.
+     * @param items Элементы массива (указатели на CI или связи).
+     * @param prefix Текст перед элементами (открывающая скобка массива).
+     * @param suffix Текст после элементов (закрывающая скобка массива).
+     * @param fields Выдаваемые поля элементов.
+     * @param format Формат элементов.
+     */
+    explicit ArrayStream(std::shared_ptr<std::vector<Ptr>> items, std::string prefix = "[", std::string suffix = "]",
+                         FieldSet fields = {}, WireFormat format = WireFormat::Json)
+        : items_(std::move(items)),
+          prefix_(std::move(prefix)),
+          suffix_(std::move(suffix)),
+          fields_(std::move(fields)),
+          format_(format) {}
+
+    bool next(std::string& out, size_t limit) override {
+        if (!started_) {
+            out += prefix_;
+            started_ = true;
+        }
+
+        size_t start = out.size();
+
+        while (index_ < items_->size() && (out.size() - start < limit || out.size() == start)) {
+            if (format_ == WireFormat::Cbor) {
+                CborWriter::write(out, *(*items_)[index_++], fields_);
+                continue;
+            }
+
+            if (index_ > 0) {
+                out += ',';
+            }
+            JsonWriter::write(out, *(*items_)[index_++], fields_);
+        }
+
+        if (index_ < items_->size()) {
+            return true;
+        }
+
+        out += suffix_;
+        return false;
+    }
+
+private:
+    std::shared_ptr<std::vector<Ptr>> items_;   ///< Элементы массива.
+    std::string prefix_;                        ///< Текст перед элементами.
+    std::string suffix_;                        ///< Текст после элементов.
+    FieldSet fields_;                           ///< Выдаваемые поля элементов.
+    WireFormat format_;                         ///< Формат элементов.
+    size_t index_ = 0;                          ///< Следующий элемент.
+    bool started_ = false;                      ///< Открывающая скобка уже выдана.
+};
@@ -0,0 +1,484 @@
+#include "Cbor.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace json = boost::json;
+
+namespace {
+
+std::string_view trim(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i] >= 'A' && a[i] <= 'Z' ? static_cast<char>(a[i] - 'A' + 'a') : a[i];
+        char y = b[i] >= 'A' && b[i] <= 'Z' ? static_cast<char>(b[i] - 'A' + 'a') : b[i];
+        if (x != y) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void writeBigEndian(std::string& out, uint64_t value, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        out += static_cast<char>((value >> shift) & 0xFF);
+    }
+}
+
+/**
+ * @brief Разбор CBOR из буфера с текущей позицией.
+ */
+class Parser {
+public:
+    explicit Parser(std::string_view data) : data_(data) {}
+
+    json::value parse(size_t depth) {
+        uint8_t initial = byte();
+        uint8_t major = initial >> 5;
+        uint8_t info = initial & 0x1F;
+
+        switch (major) {
+        case CborWriter::Unsigned: {
+            uint64_t value = argument(info);
+            if (value <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                return json::value(static_cast<int64_t>(value));
+            }
+            return json::value(value);
+        }
+        case CborWriter::Negative: {
+            uint64_t value = argument(info);
+            if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                fail();
+            }
+            return json::value(-1 - static_cast<int64_t>(value));
+        }
+        case CborWriter::Bytes:
+        case CborWriter::Text:
+            return json::value(string(major, info));
+        case CborWriter::Array: {
+            enter(depth);
+            json::array array;
+
+            if (info == 31) {
+                while (!breakCode()) {
+                    array.push_back(parse(depth + 1));
+                }
+            } else {
+                uint64_t count = length(info);
+                array.reserve(static_cast<size_t>(count));
+                for (uint64_t i = 0; i < count; ++i) {
+                    array.push_back(parse(depth + 1));
+                }
+            }
+
+            return json::value(std::move(array));
+        }
+        case CborWriter::Map: {
+            enter(depth);
+            json::object object;
+
+            auto member = [&]() {
+                uint8_t key_initial = byte();
+                if ((key_initial >> 5) != CborWriter::Text) {
+                    fail();
+                }
+                std::string key = string(CborWriter::Text, key_initial & 0x1F);
+                object[key] = parse(depth + 1);
+            };
+
+            if (info == 31) {
+                while (!breakCode()) {
+                    member();
+                }
+            } else {
+                uint64_t count = length(info);
+                for (uint64_t i = 0; i < count; ++i) {
+                    member();
+                }
+            }
+
+            return json::value(std::move(object));
+        }
+        case CborWriter::Tag:
+            argument(info);
+            enter(depth);
+            return parse(depth + 1);
+        default:
+            return simple(info);
+        }
+    }
+
+    bool done() const {
+        return pos_ == data_.size();
+    }
+
+private:
+    [[noreturn]] static void fail() {
+        throw std::invalid_argument("Некорректный CBOR");
+    }
+
+    static void enter(size_t depth) {
+        if (depth >= CborReader::MAX_DEPTH) {
+            fail();
+        }
+    }
+
+    uint8_t byte() {
+        if (pos_ >= data_.size()) {
+            fail();
+        }
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+
+    uint64_t bigEndian(int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value = (value << 8) | byte();
+        }
+        return value;
+    }
+
+    uint64_t argument(uint8_t info) {
+        if (info < 24) {
+            return info;
+        }
+
+        switch (info) {
+        case 24: return bigEndian(1);
+        case 25: return bigEndian(2);
+        case 26: return bigEndian(4);
+        case 27: return bigEndian(8);
+        default: fail();
+        }
+    }
+
+    /**
+     * @brief Длина строки или число элементов, не превышающее остаток буфера.
+     */
+    uint64_t length(uint8_t info) {
+        uint64_t value = argument(info);
+        if (value > data_.size() - pos_) {
+            fail();
+        }
+        return value;
+    }
+
+    bool breakCode() {
+        if (pos_ < data_.size() && static_cast<uint8_t>(data_[pos_]) == 0xFF) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    std::string string(uint8_t major, uint8_t info) {
+        if (info != 31) {
+            uint64_t size = length(info);
+            std::string result(data_.substr(pos_, static_cast<size_t>(size)));
+            pos_ += static_cast<size_t>(size);
+            return result;
+        }
+
+        // Строка неопределенной длины - последовательность частей того же типа
+        std::string result;
+        while (!breakCode()) {
+            uint8_t initial = byte();
+            if ((initial >> 5) != major || (initial & 0x1F) == 31) {
+                fail();
+            }
+            result += string(major, initial & 0x1F);
+        }
+        return result;
+    }
+
+    json::value simple(uint8_t info) {
+        switch (info) {
+        case 20: return json::value(false);
+        case 21: return json::value(true);
+        case 22:
+        case 23: return json::value(nullptr);
+        case 25: return json::value(half(static_cast<uint16_t>(bigEndian(2))));
+        case 26: {
+            uint32_t bits = static_cast<uint32_t>(bigEndian(4));
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return json::value(static_cast<double>(value));
+        }
+        case 27: {
+            uint64_t bits = bigEndian(8);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return json::value(value);
+        }
+        default: fail();
+        }
+    }
+
+    static double half(uint16_t bits) {
+        int exponent = (bits >> 10) & 0x1F;
+        int mantissa = bits & 0x3FF;
+        double value;
+
+        if (exponent == 0) {
+            value = std::ldexp(mantissa, -24);
+        } else if (exponent != 31) {
+            value = std::ldexp(mantissa + 1024, exponent - 25);
+        } else {
+            value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return (bits & 0x8000) ? -value : value;
+    }
+
+    std::string_view data_;     ///< Разбираемый буфер.
+    size_t pos_ = 0;            ///< Позиция следующего байта.
+};
+
+} // namespace
+
+bool CborWriter::accepted(std::string_view accept) {
+    double cbor = 0;
+    double json = 0;
+
+    while (!accept.empty()) {
+        size_t comma = accept.find(',');
+        std::string_view item = accept.substr(0, comma);
+        accept = comma == std::string_view::npos ? std::string_view() : accept.substr(comma + 1);
+
+        size_t semicolon = item.find(';');
+        std::string_view type = trim(item.substr(0, semicolon));
+        double quality = 1;
+
+        while (semicolon != std::string_view::npos) {
+            item.remove_prefix(semicolon + 1);
+            semicolon = item.find(';');
+            std::string_view param = trim(item.substr(0, semicolon));
+
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                quality = std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+            }
+        }
+
+        if (equalsIgnoreCase(type, "application/cbor")) {
+            cbor = quality;
+        } else if (equalsIgnoreCase(type, "application/json")) {
+            json = quality;
+        }
+    }
+
+    return cbor > 0 && cbor >= json;
+}
+
+void CborWriter::writeHead(std::string& out, MajorType type, uint64_t value) {
+    uint8_t major = static_cast<uint8_t>(type << 5);
+
+    if (value < 24) {
+        out += static_cast<char>(major | value);
+    } else if (value <= 0xFF) {
+        out += static_cast<char>(major | 24);
+        writeBigEndian(out, value, 1);
+    } else if (value <= 0xFFFF) {
+        out += static_cast<char>(major | 25);
+        writeBigEndian(out, value, 2);
+    } else if (value <= 0xFFFFFFFF) {
+        out += static_cast<char>(major | 26);
+        writeBigEndian(out, value, 4);
+    } else {
+        out += static_cast<char>(major | 27);
+        writeBigEndian(out, value, 8);
+    }
+}
+
+void CborWriter::writeString(std::string& out, std::string_view value) {
+    writeHead(out, Text, value.size());
+    out.append(value.data(), value.size());
+}
+
+void CborWriter::writeNumber(std::string& out, long long value) {
+    if (value >= 0) {
+        writeHead(out, Unsigned, static_cast<uint64_t>(value));
+    } else {
+        writeHead(out, Negative, static_cast<uint64_t>(-1 - value));
+    }
+}
+
+void CborWriter::writeNumber(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    out += static_cast<char>((Simple << 5) | 27);
+    writeBigEndian(out, bits, 8);
+}
+
+void CborWriter::writeNull(std::string& out) {
+    out += static_cast<char>((Simple << 5) | 22);
+}
+
+void CborWriter::write(std::string& out, const cmdb::CI& ci, const FieldSet& fields) {
+    const auto& properties = ci.getProperties();
+    size_t members = 0;
+
+    for (auto field : {FieldSet::Id, FieldSet::Name, FieldSet::Type, FieldSet::Level}) {
+        members += fields.has(field) ? 1 : 0;
+    }
+    members += fields.hasProperties() ? 1 : 0;
+
+    writeHead(out, Map, members);
+
+    if (fields.has(FieldSet::Id)) {
+        writeString(out, "id");
+        writeString(out, ci.getId());
+    }
+
+    if (fields.has(FieldSet::Name)) {
+        writeString(out, "name");
+        writeString(out, ci.getName());
+    }
+
+    if (fields.has(FieldSet::Type)) {
+        writeString(out, "type");
+        writeString(out, ci.getType());
+    }
+
+    if (fields.has(FieldSet::Level)) {
+        writeString(out, "level");
+        writeNumber(out, static_cast<long long>(ci.getLevel()));
+    }
+
+    if (!fields.hasProperties()) {
+        return;
+    }
+
+    writeString(out, "properties");
+
+    if (fields.allProperties()) {
+        writeHead(out, Map, properties.size());
+        for (const auto& [key, value] : properties) {
+            writeString(out, key);
+            writeString(out, value);
+        }
+        return;
+    }
+
+    size_t present = 0;
+    for (const auto& key : fields.properties()) {
+        present += properties.count(key);
+    }
+
+    writeHead(out, Map, present);
+    for (const auto& key : fields.properties()) {
+        auto it = properties.find(key);
+        if (it != properties.end()) {
+            writeString(out, it->first);
+            writeString(out, it->second);
+        }
+    }
+}
+
+void CborWriter::write(std::string& out, const cmdb::Relationship& relationship, const FieldSet& fields) {
+    size_t members = 0;
+
+    for (auto field : {FieldSet::Type, FieldSet::Source, FieldSet::Destination, FieldSet::Weight}) {
+        members += fields.has(field) ? 1 : 0;
+    }
+
+    writeHead(out, Map, members);
+
+    if (fields.has(FieldSet::Type)) {
+        writeString(out, "type");
+        writeString(out, relationship.getType());
+    }
+
+    if (fields.has(FieldSet::Source)) {
+        writeString(out, "source");
+        writeString(out, relationship.getSource());
+    }
+
+    if (fields.has(FieldSet::Destination)) {
+        writeString(out, "destination");
+        writeString(out, relationship.getDestination());
+    }
+
+    if (fields.has(FieldSet::Weight)) {
+        writeString(out, "weight");
+        writeNumber(out, relationship.getWeight());
+    }
+}
+
+void CborWriter::writeLink(std::string& out, const cmdb::Relationship& relationship) {
+    writeHead(out, Map, 3);
+    writeString(out, "from_id");
+    writeString(out, relationship.getSource());
+    writeString(out, "to_id");
+    writeString(out, relationship.getDestination());
+    writeString(out, "type");
+    writeString(out, relationship.getType());
+}
+
+void CborWriter::write(std::string& out, const json::value& value) {
+    switch (value.kind()) {
+    case json::kind::null:
+        writeNull(out);
+        break;
+    case json::kind::bool_:
+        out += static_cast<char>((Simple << 5) | (value.as_bool() ? 21 : 20));
+        break;
+    case json::kind::int64:
+        writeNumber(out, static_cast<long long>(value.as_int64()));
+        break;
+    case json::kind::uint64:
+        writeHead(out, Unsigned, value.as_uint64());
+        break;
+    case json::kind::double_:
+        writeNumber(out, value.as_double());
+        break;
+    case json::kind::string:
+        writeString(out, value.as_string());
+        break;
+    case json::kind::array:
+        writeHead(out, Array, value.as_array().size());
+        for (const auto& item : value.as_array()) {
+            write(out, item);
+        }
+        break;
+    case json::kind::object:
+        writeHead(out, Map, value.as_object().size());
+        for (const auto& member : value.as_object()) {
+            writeString(out, member.key());
+            write(out, member.value());
+        }
+        break;
+    }
+}
+
+std::string CborWriter::encode(const json::value& value) {
+    std::string out;
+    write(out, value);
+    return out;
+}
+
+json::value CborReader::decode(std::string_view data) {
+    Parser parser(data);
+    json::value value = parser.parse(0);
+
+    if (!parser.done()) {
+        throw std::invalid_argument("Некорректный CBOR");
+    }
+
+    return value;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file Cbor.h
+ * @brief Двоичный формат CBOR (RFC 8949): запись CI, связей и JSON-значений и разбор тел запросов.
+ */
+
+#pragma once
+
+#include <boost/json.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "../../CMDB/CI.h"
+#include "../../CMDB/Relationship.h"
+#include "FieldSet.h"
+
+/**
+ * @class CborWriter
+ * @brief Статический класс для записи CBOR в строку-буфер.
+ *
+ * Структура данных совпадает с JSON-представлением (JsonWriter): объекты - map с текстовыми
+ * ключами, массивы - array, целые числа - unsigned/negative integer, дробные - float64.
+ * Длины массивов и объектов всегда известны заранее, поэтому используется только
+ * определенная длина (definite length), а клиент может выделять память сразу под весь массив.
+ */
+class CborWriter {
+public:
+    /**
+     * @enum MajorType
+     * @brief Старшие 3 бита начального байта элемента CBOR.
+     */
+    enum MajorType : uint8_t {
+        Unsigned = 0,   ///< Неотрицательное целое.
+        Negative = 1,   ///< Отрицательное целое (-1 - значение).
+        Bytes = 2,      ///< Строка байт.
+        Text = 3,       ///< Строка UTF-8.
+        Array = 4,      ///< Массив.
+        Map = 5,        ///< Объект (пары ключ - значение).
+        Tag = 6,        ///< Тег.
+        Simple = 7,     ///< false, true, null и числа с плавающей точкой.
+    };
+
+    /**
+     * @brief Проверяет, что клиент предпочитает CBOR (application/cbor) JSON.
+     * @param accept Значение заголовка Accept.
+     * @return true, если у application/cbor ненулевой q не меньше, чем у application/json.
+     */
+    static bool accepted(std::string_view accept);
+
+    /**
+     * @brief Записывает начальный байт элемента с аргументом (длиной или значением).
+     * @param out Буфер.
+     * @param type Старший тип.
+     * @param value Аргумент в кратчайшей форме.
+     */
+    static void writeHead(std::string& out, MajorType type, uint64_t value);
+
+    /**
+     * @brief Записывает текстовую строку.
+     */
+    static void writeString(std::string& out, std::string_view value);
+
+    /**
+     * @brief Записывает целое число.
+     */
+    static void writeNumber(std::string& out, long long value);
+
+    /**
+     * @brief Записывает число с плавающей точкой (float64).
+     */
+    static void writeNumber(std::string& out, double value);
+
+    /**
+     * @brief Записывает null.
+     */
+    static void writeNull(std::string& out);
+
+    /**
+     * @brief Записывает выбранные поля CI (id, name, type, level и properties).
+     * @param out Буфер.
+     * @param ci Конфигурационная единица.
+     * @param fields Выбранные поля.
+     */
+    static void write(std::string& out, const cmdb::CI& ci, const FieldSet& fields = {});
+
+    /**
+     * @brief Записывает выбранные поля связи (type, source, destination и weight).
+     * @param out Буфер.
+     * @param relationship Связь.
+     * @param fields Выбранные поля.
+     */
+    static void write(std::string& out, const cmdb::Relationship& relationship, const FieldSet& fields = {});
+
+    /**
+     * @brief Записывает связь в формате полной выгрузки: from_id, to_id и type.
+     */
+    static void writeLink(std::string& out, const cmdb::Relationship& relationship);
+
+    /**
+     * @brief Записывает произвольное JSON-значение.
+     */
+    static void write(std::string& out, const boost::json::value& value);
+
+    /**
+     * @brief Кодирует JSON-значение в CBOR.
+     */
+    static std::string encode(const boost::json::value& value);
+};
+
+/**
+ * @class CborReader
+ * @brief Разбор тела запроса в формате CBOR в JSON-значение.
+ */
+class CborReader {
+public:
+    /**
+     * @brief Раскодирует один элемент CBOR, занимающий весь буфер.
+     *
+     * Поддерживаются все старшие типы, включая элементы неопределенной длины. Строки байт
+     * передаются как строки, теги пропускаются, undefined читается как null. Ключи объектов
+     * должны быть текстовыми строками.
+     *
+     * @param data Тело запроса.
+     * @return JSON-значение.
+     * @throws std::invalid_argument Некорректный CBOR или вложенность больше MAX_DEPTH.
+     */
+    static boost::json::value decode(std::string_view data);
+
+    static constexpr size_t MAX_DEPTH = 64; ///< Максимальная вложенность массивов и объектов.
+};
@@ -0,0 +1,145 @@
+#include "Compressor.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+
+std::string_view trim(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+} // namespace
+
+Compressor::Compressor(Encoding encoding, int level) : stream_(std::make_unique<z_stream_s>()) {
+    // windowBits 15 - формат zlib, +16 - заголовок и контрольная сумма gzip.
+    int window_bits = encoding == Encoding::Gzip ? 15 + 16 : 15;
+
+    if (deflateInit2(stream_.get(), std::clamp(level, 1, 9), Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Ошибка инициализации zlib");
+    }
+}
+
+Compressor::~Compressor() {
+    deflateEnd(stream_.get());
+}
+
+void Compressor::write(std::string& out, std::string_view data, bool finish) {
+    stream_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream_->avail_in = static_cast<uInt>(data.size());
+
+    int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+    int result = Z_OK;
+
+    do {
+        size_t start = out.size();
+        size_t room = std::max<size_t>(deflateBound(stream_.get(), stream_->avail_in), 16 * 1024);
+        out.resize(start + room);
+
+        stream_->next_out = reinterpret_cast<Bytef*>(&out[start]);
+        stream_->avail_out = static_cast<uInt>(room);
+
+        result = deflate(stream_.get(), flush);
+        out.resize(start + room - stream_->avail_out);
+
+        if (result == Z_STREAM_ERROR) {
+            throw std::runtime_error("Ошибка сжатия zlib");
+        }
+    } while (stream_->avail_in > 0 || stream_->avail_out == 0 || (finish && result != Z_STREAM_END));
+}
+
+std::string Compressor::compress(std::string_view data, Encoding encoding, int level) {
+    std::string out;
+    Compressor(encoding, level).write(out, data, true);
+    return out;
+}
+
+Compressor::Encoding Compressor::negotiate(std::string_view accept_encoding) {
+    double gzip = -1;
+    double deflate = -1;
+    double any = -1;
+
+    while (!accept_encoding.empty()) {
+        size_t comma = accept_encoding.find(',');
+        std::string_view item = accept_encoding.substr(0, comma);
+        accept_encoding.remove_prefix(comma == std::string_view::npos ? accept_encoding.size() : comma + 1);
+
+        size_t semicolon = item.find(';');
+        std::string_view coding = trim(item.substr(0, semicolon));
+        double quality = 1;
+
+        if (semicolon != std::string_view::npos) {
+            std::string_view param = trim(item.substr(semicolon + 1));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                quality = std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+            }
+        }
+
+        if (equalsIgnoreCase(coding, "gzip") || equalsIgnoreCase(coding, "x-gzip")) {
+            gzip = quality;
+        } else if (equalsIgnoreCase(coding, "deflate")) {
+            deflate = quality;
+        } else if (coding == "*") {
+            any = quality;
+        }
+    }
+
+    if (gzip < 0) {
+        gzip = any;
+    }
+    if (deflate < 0) {
+        deflate = any;
+    }
+
+    if (gzip > 0 && gzip >= deflate) {
+        return Encoding::Gzip;
+    }
+    if (deflate > 0) {
+        return Encoding::Deflate;
+    }
+
+    return Encoding::Identity;
+}
+
+std::string_view Compressor::name(Encoding encoding) {
+    switch (encoding) {
+    case Encoding::Gzip: return "gzip";
+    case Encoding::Deflate: return "deflate";
+    case Encoding::Identity: break;
+    }
+
+    return "identity";
+}
+
+CompressingStream::CompressingStream(std::unique_ptr<BodyStream> inner, Compressor::Encoding encoding, int level)
+    : inner_(std::move(inner)),
+      compressor_(encoding, level) {
+}
+
+bool CompressingStream::next(std::string& out, size_t limit) {
+    size_t start = out.size();
+
+    // Сжатые данные копятся внутри zlib, поэтому исходные части читаются, пока не наберется
+    // limit сжатых байт или источник не закончится.
+    while (!finished_ && (out.size() - start < limit || out.size() == start)) {
+        input_.clear();
+        finished_ = !inner_->next(input_, limit);
+        compressor_.write(out, input_, finished_);
+    }
+
+    return !finished_;
+}
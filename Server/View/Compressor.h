@@ -0,0 +1,113 @@
+/**
+ * @file Compressor.h
+ * @brief Сжатие тел ответов (gzip / deflate) на основе zlib.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "BodyStream.h"
+
+struct z_stream_s;
+
+/**
+ * @struct CompressionConfig
+ * @brief Параметры сжатия ответов.
+ */
+struct CompressionConfig {
+    int level = 6;              ///< Уровень сжатия zlib 1-9 (0 - сжатие выключено).
+    size_t min_size = 1024;     ///< Минимальный размер тела, которое сжимается целиком, байт.
+};
+
+/**
+ * @class Compressor
+ * @brief Потоковое сжатие в формате gzip (RFC 1952) или deflate (zlib, RFC 1950).
+ */
+class Compressor {
+public:
+    /**
+     * @enum Encoding
+     * @brief Кодирование тела ответа (Content-Encoding).
+     */
+    enum class Encoding {
+        Identity,   ///< Без сжатия.
+        Gzip,       ///< gzip.
+        Deflate,    ///< deflate (поток zlib).
+    };
+
+    /**
+     * @brief Конструктор.
+     * @param encoding Формат сжатия (не Identity).
+     * @param level Уровень сжатия zlib.
+     * @throws std::runtime_error Если zlib не удалось инициализировать.
+     */
+    Compressor(Encoding encoding, int level);
+
+    /**
+     * @brief Деструктор. Освобождает состояние zlib.
+     */
+    ~Compressor();
+
+    Compressor(const Compressor&) = delete;
+    Compressor& operator=(const Compressor&) = delete;
+
+    /**
+     * @brief Сжимает очередную часть данных и дописывает результат в буфер.
+     * @param out Буфер сжатых данных.
+     * @param data Часть исходных данных.
+     * @param finish Последняя часть: дописывается конец потока.
+     */
+    void write(std::string& out, std::string_view data, bool finish);
+
+    /**
+     * @brief Сжимает данные целиком.
+     * @param data Исходные данные.
+     * @param encoding Формат сжатия.
+     * @param level Уровень сжатия zlib.
+     * @return Сжатые данные.
+     */
+    static std::string compress(std::string_view data, Encoding encoding, int level);
+
+    /**
+     * @brief Выбирает кодирование по заголовку Accept-Encoding (с учетом q-значений).
+     * @param accept_encoding Значение заголовка.
+     * @return Gzip или Deflate, если клиент их принимает (при равном q предпочтительнее gzip), иначе Identity.
+     */
+    static Encoding negotiate(std::string_view accept_encoding);
+
+    /**
+     * @brief Имя кодирования для Content-Encoding.
+     */
+    static std::string_view name(Encoding encoding);
+
+private:
+    std::unique_ptr<z_stream_s> stream_;    ///< Состояние zlib.
+};
+
+/**
+ * @class CompressingStream
+ * @brief Источник тела, который сжимает части другого источника.
+ *
+ * Исходные части сжимаются по мере передачи, поэтому потоковый ответ не собирается в памяти
+ * ни в исходном, ни в сжатом виде; limit ограничивает размер сжатой части.
+ */
+class CompressingStream : public BodyStream {
+public:
+    /**
+     * @brief Конструктор.
+     * @param inner Исходный источник тела.
+     * @param encoding Формат сжатия.
+     * @param level Уровень сжатия zlib.
+     */
+    CompressingStream(std::unique_ptr<BodyStream> inner, Compressor::Encoding encoding, int level);
+
+    bool next(std::string& out, size_t limit) override;
+
+private:
+    std::unique_ptr<BodyStream> inner_;     ///< Исходный источник тела.
+    Compressor compressor_;                 ///< Состояние сжатия.
+    std::string input_;                     ///< Текущая исходная часть.
+    bool finished_ = false;                 ///< Исходный источник исчерпан.
+};
@@ -0,0 +1,143 @@
+#include "FieldSet.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::string_view PROPERTY_PREFIX = "properties.";
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::string decode(std::string_view value) {
+    std::string result;
+    result.reserve(value.size());
+
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] != '%') {
+            result += value[i];
+            continue;
+        }
+
+        int high = i + 2 < value.size() ? hexDigit(value[i + 1]) : -1;
+        int low = high >= 0 ? hexDigit(value[i + 2]) : -1;
+        if (low < 0) {
+            throw std::invalid_argument("Не корректный fields");
+        }
+
+        result += static_cast<char>(high * 16 + low);
+        i += 2;
+    }
+
+    return result;
+}
+
+} // namespace
+
+FieldSet FieldSet::parseCI(std::string_view spec) {
+    FieldSet fields;
+    fields.all_ = false;
+
+    while (true) {
+        size_t comma = spec.find(',');
+        std::string name = decode(spec.substr(0, comma));
+
+        if (name == "id") {
+            fields.mask_ |= Id;
+        } else if (name == "name") {
+            fields.mask_ |= Name;
+        } else if (name == "type") {
+            fields.mask_ |= Type;
+        } else if (name == "level") {
+            fields.mask_ |= Level;
+        } else if (name == "properties") {
+            fields.mask_ |= Properties;
+        } else if (name.size() > PROPERTY_PREFIX.size() && name.compare(0, PROPERTY_PREFIX.size(), PROPERTY_PREFIX) == 0) {
+            name.erase(0, PROPERTY_PREFIX.size());
+            if (std::find(fields.properties_.begin(), fields.properties_.end(), name) == fields.properties_.end()) {
+                fields.properties_.push_back(std::move(name));
+            }
+        } else {
+            throw std::invalid_argument("Неизвестное поле: " + name);
+        }
+
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        spec.remove_prefix(comma + 1);
+    }
+
+    // Полный набор выдается из кэша сериализации CI
+    if ((fields.mask_ & (Id | Name | Type | Level | Properties)) == (Id | Name | Type | Level | Properties)) {
+        return FieldSet();
+    }
+
+    if (fields.mask_ & Properties) {
+        fields.properties_.clear();
+    }
+
+    return fields;
+}
+
+FieldSet FieldSet::parseRelationship(std::string_view spec) {
+    FieldSet fields;
+    fields.all_ = false;
+
+    while (true) {
+        size_t comma = spec.find(',');
+        std::string name = decode(spec.substr(0, comma));
+
+        if (name == "type") {
+            fields.mask_ |= Type;
+        } else if (name == "source") {
+            fields.mask_ |= Source;
+        } else if (name == "destination") {
+            fields.mask_ |= Destination;
+        } else if (name == "weight") {
+            fields.mask_ |= Weight;
+        } else {
+            throw std::invalid_argument("Неизвестное поле: " + name);
+        }
+
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        spec.remove_prefix(comma + 1);
+    }
+
+    if (fields.mask_ == (Type | Source | Destination | Weight)) {
+        return FieldSet();
+    }
+
+    return fields;
+}
+
+bool FieldSet::all() const {
+    return all_;
+}
+
+bool FieldSet::has(Field field) const {
+    return all_ || (mask_ & field) != 0;
+}
+
+bool FieldSet::hasProperties() const {
+    return has(Properties) || !properties_.empty();
+}
+
+bool FieldSet::allProperties() const {
+    return has(Properties);
+}
+
+const std::vector<std::string>& FieldSet::properties() const {
+    return properties_;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file FieldSet.h
+ * @brief Набор полей, которые выдаются в ответе на чтение (параметр fields).
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class FieldSet
+ * @brief Проекция CI или связи: поля, которые нужно сериализовать.
+ *
+ * Задается списком через запятую: для CI - `id`, `name`, `type`, `level`, `properties`
+ * (все свойства) и `properties.<имя>` (отдельное свойство), для связи - `type`, `source`,
+ * `destination` и `weight`. Невыбранные поля не читаются из модели и не кодируются.
+ * Набор по умолчанию содержит все поля.
+ */
+class FieldSet {
+public:
+    /**
+     * @enum Field
+     * @brief Поле CI или связи (битовая маска).
+     */
+    enum Field : unsigned {
+        Id = 1u << 0,           ///< id CI.
+        Name = 1u << 1,         ///< name CI.
+        Type = 1u << 2,         ///< type CI или связи.
+        Level = 1u << 3,        ///< level CI.
+        Properties = 1u << 4,   ///< Все свойства CI.
+        Source = 1u << 5,       ///< source связи.
+        Destination = 1u << 6,  ///< destination связи.
+        Weight = 1u << 7,       ///< weight связи.
+    };
+
+    /**
+     * @brief Набор из всех полей.
+     */
+    FieldSet() = default;
+
+    /**
+     * @brief Разбирает список полей CI.
+     * @param spec Значение параметра fields (имена свойств могут быть закодированы через %XX).
+     * @return Набор полей.
+     * @throws std::invalid_argument Пустой список или неизвестное поле.
+     */
+    static FieldSet parseCI(std::string_view spec);
+
+    /**
+     * @brief Разбирает список полей связи.
+     * @param spec Значение параметра fields (имена могут быть закодированы через %XX).
+     * @return Набор полей.
+     * @throws std::invalid_argument Пустой список или неизвестное поле.
+     */
+    static FieldSet parseRelationship(std::string_view spec);
+
+    /**
+     * @brief Выбраны все поля (объект сериализуется целиком).
+     */
+    bool all() const;
+
+    /**
+     * @brief Выбрано поле field.
+     */
+    bool has(Field field) const;
+
+    /**
+     * @brief Выбраны свойства CI (все или отдельные).
+     */
+    bool hasProperties() const;
+
+    /**
+     * @brief Выбраны все свойства CI.
+     */
+    bool allProperties() const;
+
+    /**
+     * @brief Отдельно выбранные свойства CI (без повторов, по порядку в запросе).
+     */
+    const std::vector<std::string>& properties() const;
+
+private:
+    bool all_ = true;                       ///< Выбраны все поля.
+    unsigned mask_ = 0;                     ///< Выбранные поля (Field).
+    std::vector<std::string> properties_;   ///< Отдельно выбранные свойства CI.
+};
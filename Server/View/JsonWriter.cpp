@@ -0,0 +1,282 @@
+#include "JsonWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+void writeEscape(std::string& out, unsigned char c) {
+    static constexpr char hex[] = "0123456789abcdef";
+
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\b': out += "\\b"; break;
+    case '\f': out += "\\f"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    default: {
+        char code[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+        out.append(code, sizeof(code));
+    }
+    }
+}
+
+} // namespace
+
+size_t JsonWriter::findEscape(const char* data, size_t size) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+        // c <= 0x1f (без знака) <=> max(c, 0x1f) == 0x1f.
+        __m128i mask = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+
+        if (int bits = _mm_movemask_epi8(mask)) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(bits)));
+        }
+    }
+#endif
+
+    for (; i < size; ++i) {
+        if (needsEscape(static_cast<unsigned char>(data[i]))) {
+            return i;
+        }
+    }
+
+    return size;
+}
+
+void JsonWriter::writeString(std::string& out, std::string_view value) {
+    out += '"';
+
+    while (!value.empty()) {
+        size_t pos = findEscape(value.data(), value.size());
+        out.append(value.data(), pos);
+
+        if (pos == value.size()) {
+            break;
+        }
+
+        writeEscape(out, static_cast<unsigned char>(value[pos]));
+        value.remove_prefix(pos + 1);
+    }
+
+    out += '"';
+}
+
+void JsonWriter::writeNumber(std::string& out, long long value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void JsonWriter::writeNumber(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+
+    if (std::find_if(buffer, result.ptr, [](char c) { return c == '.' || c == 'e'; }) == result.ptr) {
+        out += ".0";
+    }
+}
+
+void JsonWriter::write(std::string& out, const cmdb::CI& ci) {
+    out += ci.getCachedJSON([&ci](std::string& json) { writeFields(json, ci); });
+}
+
+void JsonWriter::writeFields(std::string& out, const cmdb::CI& ci) {
+    out += '{';
+    writeKey(out, "id");
+    writeString(out, ci.getId());
+    out += ',';
+    writeKey(out, "name");
+    writeString(out, ci.getName());
+    out += ',';
+    writeKey(out, "type");
+    writeString(out, ci.getType());
+    out += ',';
+    writeKey(out, "level");
+    writeNumber(out, static_cast<long long>(ci.getLevel()));
+    out += ',';
+    writeKey(out, "properties");
+    out += '{';
+
+    bool first = true;
+    for (const auto& [key, value] : ci.getProperties()) {
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+
+        writeString(out, key);
+        out += ':';
+        writeString(out, value);
+    }
+
+    out += "}}";
+}
+
+void JsonWriter::write(std::string& out, const cmdb::CI& ci, const FieldSet& fields) {
+    if (fields.all()) {
+        write(out, ci);
+        return;
+    }
+
+    bool first = true;
+    out += '{';
+
+    if (fields.has(FieldSet::Id)) {
+        writeKey(out, "id", first);
+        writeString(out, ci.getId());
+    }
+
+    if (fields.has(FieldSet::Name)) {
+        writeKey(out, "name", first);
+        writeString(out, ci.getName());
+    }
+
+    if (fields.has(FieldSet::Type)) {
+        writeKey(out, "type", first);
+        writeString(out, ci.getType());
+    }
+
+    if (fields.has(FieldSet::Level)) {
+        writeKey(out, "level", first);
+        writeNumber(out, static_cast<long long>(ci.getLevel()));
+    }
+
+    if (fields.hasProperties()) {
+        writeKey(out, "properties", first);
+        out += '{';
+
+        const auto& properties = ci.getProperties();
+        bool first_property = true;
+
+        auto writeProperty = [&](const std::string& key, const std::string& value) {
+            if (!first_property) {
+                out += ',';
+            }
+            first_property = false;
+
+            writeString(out, key);
+            out += ':';
+            writeString(out, value);
+        };
+
+        if (fields.allProperties()) {
+            for (const auto& [key, value] : properties) {
+                writeProperty(key, value);
+            }
+        } else {
+            for (const auto& key : fields.properties()) {
+                auto it = properties.find(key);
+                if (it != properties.end()) {
+                    writeProperty(it->first, it->second);
+                }
+            }
+        }
+
+        out += '}';
+    }
+
+    out += '}';
+}
+
+void JsonWriter::write(std::string& out, const cmdb::Relationship& relationship) {
+    out += '{';
+    writeKey(out, "type");
+    writeString(out, relationship.getType());
+    out += ',';
+    writeKey(out, "source");
+    writeString(out, relationship.getSource());
+    out += ',';
+    writeKey(out, "destination");
+    writeString(out, relationship.getDestination());
+    out += ',';
+    writeKey(out, "weight");
+    writeNumber(out, relationship.getWeight());
+    out += '}';
+}
+
+void JsonWriter::write(std::string& out, const cmdb::Relationship& relationship, const FieldSet& fields) {
+    if (fields.all()) {
+        write(out, relationship);
+        return;
+    }
+
+    bool first = true;
+    out += '{';
+
+    if (fields.has(FieldSet::Type)) {
+        writeKey(out, "type", first);
+        writeString(out, relationship.getType());
+    }
+
+    if (fields.has(FieldSet::Source)) {
+        writeKey(out, "source", first);
+        writeString(out, relationship.getSource());
+    }
+
+    if (fields.has(FieldSet::Destination)) {
+        writeKey(out, "destination", first);
+        writeString(out, relationship.getDestination());
+    }
+
+    if (fields.has(FieldSet::Weight)) {
+        writeKey(out, "weight", first);
+        writeNumber(out, relationship.getWeight());
+    }
+
+    out += '}';
+}
+
+void JsonWriter::writeLink(std::string& out, const cmdb::Relationship& relationship) {
+    out += '{';
+    writeKey(out, "from_id");
+    writeString(out, relationship.getSource());
+    out += ',';
+    writeKey(out, "to_id");
+    writeString(out, relationship.getDestination());
+    out += ',';
+    writeKey(out, "type");
+    writeString(out, relationship.getType());
+    out += '}';
+}
+
+void JsonWriter::writeKey(std::string& out, std::string_view key) {
+    out += '"';
+    out += key;
+    out += "\":";
+}
+
+void JsonWriter::writeKey(std::string& out, std::string_view key, bool& first) {
+    if (!first) {
+        out += ',';
+    }
+    first = false;
+
+    writeKey(out, key);
+}
@@ -0,0 +1,110 @@
+/**
+ * @file JsonWriter.h
+ * @brief Сериализация CI и связей в JSON напрямую в буфер, без построения json::object.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "../../CMDB/CI.h"
+#include "../../CMDB/Relationship.h"
+#include "FieldSet.h"
+
+/**
+ * @class JsonWriter
+ * @brief Статический класс для записи JSON в строку-буфер.
+ *
+ * Формат совпадает с сериализацией CI::asJSON() и Relationship::asJSON(), но поля пишутся
+ * прямо из модели: нет промежуточных объектов, копий строк и выделений памяти на элемент.
+ * Представление CI строится один раз и хранится в кэше CI (CI::getCachedJSON), поэтому
+ * повторная выдача неизмененного CI сводится к копированию готовой строки.
+ * Строки экранируются как в Boost.JSON; поиск символов, требующих экранирования, выполняется
+ * блоками по 16 байт (SSE2), а участки без таких символов копируются целиком.
+ */
+class JsonWriter {
+public:
+    /**
+     * @brief Записывает строку JSON в кавычках с экранированием.
+     * @param out Буфер.
+     * @param value Строка.
+     */
+    static void writeString(std::string& out, std::string_view value);
+
+    /**
+     * @brief Записывает целое число.
+     */
+    static void writeNumber(std::string& out, long long value);
+
+    /**
+     * @brief Записывает число с плавающей точкой (кратчайшее точное представление, всегда
+     *        с дробной частью или порядком; бесконечность и NaN - как null).
+     */
+    static void writeNumber(std::string& out, double value);
+
+    /**
+     * @brief Записывает CI (id, name, type, level и properties) из кэша сериализации CI.
+     * @param out Буфер.
+     * @param ci Конфигурационная единица.
+     */
+    static void write(std::string& out, const cmdb::CI& ci);
+
+    /**
+     * @brief Записывает выбранные поля CI.
+     *
+     * Полный набор полей берется из кэша сериализации; для проекции поля читаются прямо
+     * из модели, а отдельные свойства ищутся по имени без обхода остальных.
+     *
+     * @param out Буфер.
+     * @param ci Конфигурационная единица.
+     * @param fields Выбранные поля.
+     */
+    static void write(std::string& out, const cmdb::CI& ci, const FieldSet& fields);
+
+    /**
+     * @brief Записывает связь: type, source, destination и weight.
+     * @param out Буфер.
+     * @param relationship Связь.
+     */
+    static void write(std::string& out, const cmdb::Relationship& relationship);
+
+    /**
+     * @brief Записывает выбранные поля связи.
+     * @param out Буфер.
+     * @param relationship Связь.
+     * @param fields Выбранные поля.
+     */
+    static void write(std::string& out, const cmdb::Relationship& relationship, const FieldSet& fields);
+
+    /**
+     * @brief Записывает связь в формате полной выгрузки: from_id, to_id и type.
+     * @param out Буфер.
+     * @param relationship Связь.
+     */
+    static void writeLink(std::string& out, const cmdb::Relationship& relationship);
+
+    /**
+     * @brief Позиция первого символа, требующего экранирования (кавычка, обратная косая черта
+     *        или управляющий символ).
+     * @param data Начало строки.
+     * @param size Длина строки.
+     * @return Позиция символа или size, если таких символов нет.
+     */
+    static size_t findEscape(const char* data, size_t size);
+
+private:
+    /**
+     * @brief Сериализует CI без использования кэша.
+     */
+    static void writeFields(std::string& out, const cmdb::CI& ci);
+
+    /**
+     * @brief Записывает ключ объекта с двоеточием (ключ не требует экранирования).
+     */
+    static void writeKey(std::string& out, std::string_view key);
+
+    /**
+     * @brief Записывает ключ очередного поля объекта, предваряя его запятой, если поле не первое.
+     */
+    static void writeKey(std::string& out, std::string_view key, bool& first);
+};
@@ -1,4 +1,5 @@
 #include "ResponseFormatter.h"
+#include <limits>
 
 void ResponseFormatter::makeJSONResponse(http::response<http::string_body>& res, const json::object& obj) {
     res.set(http::field::content_type, "application/json");
@@ -12,6 +13,57 @@ void ResponseFormatter::makeJSONResponse(http::response<http::string_body>& res,
     res.prepare_payload();
 }
 
+void ResponseFormatter::makeJSONResponse(http::response<http::string_body>& res, const std::string& body) {
+    res.set(http::field::content_type, "application/json");
+    res.body() = body;
+    res.prepare_payload();
+}
+
+void ResponseFormatter::makeNotModifiedResponse(http::response<http::string_body>& res, const std::string& etag) {
+    res.result(http::status::not_modified);
+    res.set(http::field::etag, etag);
+    res.body().clear();
+    res.prepare_payload();
+}
+
+void ResponseFormatter::makeExistsResponse(http::response<http::string_body>& res, bool found, const std::string& etag,
+                                           WireFormat format) {
+    res.result(found ? http::status::ok : http::status::not_found);
+    res.set(http::field::content_type, contentType(format));
+    res.set(http::field::etag, etag);
+    res.body().clear();
+    res.prepare_payload();
+}
+
+void ResponseFormatter::makeJSONResponse(http::response<http::string_body>& res, BodyStream& body) {
+    res.set(http::field::content_type, "application/json");
+    makeBodyResponse(res, body);
+}
+
+void ResponseFormatter::makeBodyResponse(http::response<http::string_body>& res, BodyStream& body) {
+    res.chunked(false);
+    res.body().clear();
+    body.next(res.body(), std::numeric_limits<size_t>::max());
+    res.prepare_payload();
+}
+
+void ResponseFormatter::makeStreamResponse(http::response<http::string_body>& res, WireFormat format) {
+    res.set(http::field::content_type, contentType(format));
+    res.body().clear();
+    res.chunked(true);
+}
+
+const char* ResponseFormatter::contentType(WireFormat format) {
+    return format == WireFormat::Cbor ? "application/cbor" : "application/json";
+}
+
+void ResponseFormatter::makeFileResponse(http::response<http::string_body>& res, uint64_t size) {
+    res.set(http::field::content_type, "application/json");
+    res.body().clear();
+    res.chunked(false);
+    res.content_length(size);
+}
+
 void ResponseFormatter::makeErrorResponse(http::response<http::string_body>& res, http::status status, const std::string& message) {
     res.result(status);
     res.set(http::field::content_type, "application/json");
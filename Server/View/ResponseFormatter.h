@@ -9,6 +9,7 @@
 #include <boost/beast/http.hpp>
 #include <boost/asio.hpp>
 #include <boost/json.hpp>
+#include "BodyStream.h"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -34,6 +35,63 @@ public:
      */
     static void makeJSONResponse(http::response<http::string_body>& res, const json::array& arr);
 
+    /**
+     * @brief Формирует JSON-ответ из готового сериализованного тела.
+     * @param res Ссылка на HTTP-ответ, который будет заполнен.
+     * @param body Сериализованный JSON.
+     */
+    static void makeJSONResponse(http::response<http::string_body>& res, const std::string& body);
+
+    /**
+     * @brief Формирует ответ 304 Not Modified.
+     * @param res Ссылка на HTTP-ответ, который будет заполнен.
+     * @param etag ETag текущей версии данных.
+     */
+    static void makeNotModifiedResponse(http::response<http::string_body>& res, const std::string& etag);
+
+    /**
+     * @brief Формирует ответ на HEAD-запрос существования: 200 или 404 без тела.
+     * @param res Ссылка на HTTP-ответ, который будет заполнен.
+     * @param found Найден ли хотя бы один объект.
+     * @param etag ETag текущей версии данных.
+     * @param format Формат, в котором был бы выдан ответ на GET.
+     */
+    static void makeExistsResponse(http::response<http::string_body>& res, bool found, const std::string& etag,
+                                   WireFormat format);
+
+    /**
+     * @brief Формирует JSON-ответ, тело которого целиком выдает источник.
+     * @param res Ссылка на HTTP-ответ, который будет заполнен.
+     * @param body Источник тела ответа.
+     */
+    static void makeJSONResponse(http::response<http::string_body>& res, BodyStream& body);
+
+    /**
+     * @brief Собирает тело потокового ответа целиком, сохраняя заголовки (Content-Type и др.).
+     * @param res Ссылка на HTTP-ответ с заголовками от makeStreamResponse.
+     * @param body Источник тела ответа.
+     */
+    static void makeBodyResponse(http::response<http::string_body>& res, BodyStream& body);
+
+    /**
+     * @brief Формирует заголовки ответа, тело которого передается частями (chunked).
+     * @param res Ссылка на HTTP-ответ, который будет заполнен.
+     * @param format Формат тела.
+     */
+    static void makeStreamResponse(http::response<http::string_body>& res, WireFormat format = WireFormat::Json);
+
+    /**
+     * @brief Значение Content-Type для формата тела.
+     */
+    static const char* contentType(WireFormat format);
+
+    /**
+     * @brief Формирует заголовки JSON-ответа, тело которого передается из файла.
+     * @param res Ссылка на HTTP-ответ, который будет заполнен.
+     * @param size Размер тела (Content-Length), байт.
+     */
+    static void makeFileResponse(http::response<http::string_body>& res, uint64_t size);
+
     /**
      * @brief Формирует ответ с ошибкой.
      * @param res Ссылка на HTTP-ответ, который будет заполнен.
@@ -0,0 +1,96 @@
+/**
+ * @file bench_Snapshot.cpp
+ * @brief Микробенчмарк стоимости одной записи в снимок в зависимости от числа КЕ.
+ *
+ * Для каждого размера базы (1 тыс. - 1 млн КЕ) измеряется время цикла, который выполняет
+ * каждый писатель CMDB: построитель от текущего снимка, одно изменение, сборка новой версии.
+ * Индексы сегментов разделяют узлы между версиями, поэтому время записи не должно расти с N.
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "../CMDB/Snapshot.h"
+
+using namespace cmdb;
+
+namespace {
+
+constexpr size_t SHARDS = 16;
+constexpr int WRITES = 20000;
+
+/**
+ * @brief КЕ бенчмарка с двумя индексируемыми свойствами.
+ */
+Snapshot::CIPtr makeCI(size_t index, int level) {
+    auto id = "CI_" + std::to_string(index);
+    return std::make_shared<CI>(id, id, "Host", level,
+        std::unordered_map<std::string, std::string>{{"Zone", std::to_string(index % 8)}, {"Rack", std::to_string(index % 64)}});
+}
+
+/**
+ * @brief Снимок из count КЕ, связанных в цепочку.
+ */
+std::shared_ptr<const Snapshot> populate(size_t count) {
+    SnapshotBuilder builder(std::make_shared<Snapshot>(SHARDS));
+
+    for (size_t i = 0; i < count; ++i) {
+        builder.insertCI(makeCI(i, 1));
+
+        if (i > 0) {
+            builder.addRelationship(std::make_shared<Relationship>("CI_" + std::to_string(i - 1), "CI_" + std::to_string(i), "Next"));
+        }
+    }
+
+    return builder.build(1);
+}
+
+/**
+ * @brief Среднее время (мкс) одной публикуемой записи; apply вносит изменение номер i.
+ */
+template <class Apply>
+double perWrite(std::shared_ptr<const Snapshot> current, Apply apply) {
+    uint64_t generation = current->getGeneration();
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < WRITES; ++i) {
+        SnapshotBuilder builder(current);
+        apply(builder, i);
+        current = builder.build(++generation);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / WRITES;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "Записей: " << WRITES << ", сегментов: " << SHARDS << ", мкс на запись\n";
+    std::cout << "        КЕ   обновление КЕ        новая КЕ     новая связь\n";
+
+    for (size_t count : {1000, 10000, 100000, 1000000}) {
+        auto base = populate(count);
+
+        double update = perWrite(base, [count](SnapshotBuilder& builder, int i) {
+            builder.putCI(makeCI(static_cast<size_t>(i) * 7919 % count, 2));
+        });
+        double insert = perWrite(base, [count](SnapshotBuilder& builder, int i) {
+            builder.insertCI(makeCI(count + static_cast<size_t>(i), 1));
+        });
+        double link = perWrite(base, [count](SnapshotBuilder& builder, int i) {
+            builder.addRelationship(std::make_shared<Relationship>(
+                "CI_" + std::to_string(static_cast<size_t>(i) * 7919 % count), "CI_0", "Uses"));
+        });
+
+        std::cout << std::setw(10) << count << std::fixed << std::setprecision(2)
+                  << std::setw(16) << update
+                  << std::setw(16) << insert
+                  << std::setw(16) << link << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file bench_ThreadPool.cpp
+ * @brief Микробенчмарк пропускной способности ThreadPool в сравнении с пулом на одной очереди.
+ *
+ * Для каждого числа потоков (1-64) измеряется время выполнения пустых задач в двух сценариях:
+ * задачи ставит один внешний поток, и задачи порождаются внутри пула (fan-out). Каждое значение -
+ * медиана нескольких запусков, поскольку отдельные запуски заметно зависят от планировщика ОС.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "../Server/ThreadPool/ThreadPool.h"
+
+namespace {
+
+/**
+ * @class MutexQueuePool
+ * @brief Исходный пул: одна очередь std::function под одним мьютексом.
+ */
+class MutexQueuePool {
+public:
+    explicit MutexQueuePool(size_t threads) : stop(false) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this] { worker(); });
+        }
+    }
+
+    ~MutexQueuePool() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void enqueue(std::function<void()> func) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            tasks.push(std::move(func));
+        }
+        cv.notify_one();
+    }
+
+private:
+    void worker() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                cv.wait(lock, [this] { return stop || !tasks.empty(); });
+
+                if (stop && tasks.empty())
+                    return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable cv;
+    bool stop;
+};
+
+constexpr int TASKS = 200000;
+constexpr int FAN_OUT = 100;
+constexpr int RUNS = 5;
+
+/**
+ * @brief Задачи ставит один внешний поток; возвращает миллионы задач в секунду.
+ */
+template <class Pool>
+double external(size_t threads) {
+    std::atomic<int> done{0};
+    auto start = std::chrono::steady_clock::now();
+    {
+        Pool pool(threads);
+        for (int i = 0; i < TASKS; ++i) {
+            pool.enqueue([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return done.load() / elapsed.count() / 1e6;
+}
+
+/**
+ * @brief Задачи порождаются внутри пула; возвращает миллионы задач в секунду.
+ */
+template <class Pool>
+double fanOut(size_t threads) {
+    std::atomic<int> done{0};
+    auto start = std::chrono::steady_clock::now();
+    {
+        Pool pool(threads);
+        for (int i = 0; i < TASKS / FAN_OUT; ++i) {
+            pool.enqueue([&pool, &done] {
+                for (int j = 0; j < FAN_OUT; ++j) {
+                    pool.enqueue([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+                }
+            });
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return done.load() / elapsed.count() / 1e6;
+}
+
+/**
+ * @brief Медиана RUNS запусков сценария.
+ */
+double median(double (*scenario)(size_t), size_t threads) {
+    std::vector<double> results;
+
+    for (int i = 0; i < RUNS; ++i) {
+        results.push_back(scenario(threads));
+    }
+    std::sort(results.begin(), results.end());
+
+    return results[RUNS / 2];
+}
+
+} // namespace
+
+int main() {
+    std::cout << "Задач: " << TASKS << ", млн задач/с\n";
+    std::cout << std::setw(8) << "потоки"
+              << std::setw(16) << "mutex внеш."
+              << std::setw(16) << "steal внеш."
+              << std::setw(16) << "mutex fan-out"
+              << std::setw(16) << "steal fan-out" << "\n";
+
+    for (size_t threads : {1, 2, 4, 8, 16, 32, 64}) {
+        std::cout << std::setw(8) << threads << std::fixed << std::setprecision(2)
+                  << std::setw(16) << median(external<MutexQueuePool>, threads)
+                  << std::setw(16) << median(external<ThreadPool>, threads)
+                  << std::setw(16) << median(fanOut<MutexQueuePool>, threads)
+                  << std::setw(16) << median(fanOut<ThreadPool>, threads) << "\n";
+    }
+
+    return 0;
+}
@@ -4,17 +4,52 @@
 namespace po = boost::program_options;
 
 int main(int argc, char* argv[]) {
-    std::string db_path = "cmdb.bin";
-    int port = 8080;
-    unsigned int num_threads = std::thread::hardware_concurrency() * 2;
+    ServerConfig config;
+    size_t idle_timeout = 30;
+    size_t read_timeout = 30;
+    size_t write_timeout = 30;
+    size_t retry_after = 1;
+    size_t queue_latency = 5;
+    size_t export_settle = 500;
+    bool no_keep_alive = false;
+    std::string handler_placement = "float";
+    std::string numa_memory = "default";
 
     try {
         po::options_description desc("Допустимые опции");
         desc.add_options()
             ("help,h", "help")
-            ("port,p", po::value<int>(&port)->default_value(8080), "Номер порта (по умолчанию 8080)")
-            ("threads,t", po::value<unsigned int>(&num_threads)->default_value(std::thread::hardware_concurrency() * 2), "Число потоков (по умолчанию число процессоров * 2)")
-            ("db,d", po::value<std::string>(&db_path)->default_value("cmdb.bin"), "Путь к файлу БД");
+            ("port,p", po::value<int>(&config.port)->default_value(8080), "Номер порта (по умолчанию 8080)")
+            ("threads,t", po::value<size_t>(&config.io_threads)->default_value(std::thread::hardware_concurrency()), "Число потоков ввода-вывода (по умолчанию число процессоров)")
+            ("handler-threads", po::value<size_t>(&config.handler_threads)->default_value(0), "Число потоков обработчиков (0 - запросы обрабатываются в потоках ввода-вывода)")
+            ("min-handler-threads", po::value<size_t>(&config.handler_pool.min_threads)->default_value(1), "Минимальное число потоков обработчиков при адаптивном подборе")
+            ("max-handler-threads", po::value<size_t>(&config.handler_pool.max_threads)->default_value(0), "Максимальное число потоков обработчиков; если больше --handler-threads, число подбирается по нагрузке (0 - число постоянно)")
+            ("queue-latency", po::value<size_t>(&queue_latency)->default_value(5), "Допустимое время ожидания запроса в очереди обработчиков при адаптивном подборе, мс")
+            ("shards,s", po::value<size_t>(&config.shard_count)->default_value(cmdb::CMDB::DEFAULT_SHARD_COUNT), "Число сегментов хранилища CMDB")
+            ("write-batch,w", po::value<size_t>(&config.write_batch)->default_value(0), "Размер пачки потока-писателя (0 - конвейер модификаций отключен)")
+            ("reuse-port", po::bool_switch(&config.reuse_port), "Отдельный acceptor (SO_REUSEPORT) и цикл событий на каждый поток ввода-вывода")
+            ("pin-threads", po::bool_switch(&config.pin_threads), "Привязывать потоки ввода-вывода к ядрам процессора")
+            ("handler-placement", po::value<std::string>(&handler_placement)->default_value("float"), "Размещение потоков обработчиков: float, pin (по ядру на поток) или numa (по узлам NUMA)")
+            ("numa-memory", po::value<std::string>(&numa_memory)->default_value("default"), "Размещение памяти по узлам NUMA: default, local или interleave")
+            ("idle-timeout", po::value<size_t>(&idle_timeout)->default_value(30), "Время ожидания следующего запроса в соединении, секунд")
+            ("no-keep-alive", po::bool_switch(&no_keep_alive), "Закрывать соединение после каждого ответа")
+            ("read-timeout", po::value<size_t>(&read_timeout)->default_value(30), "Время чтения тела запроса, секунд")
+            ("write-timeout", po::value<size_t>(&write_timeout)->default_value(30), "Время записи ответа, секунд")
+            ("max-connections", po::value<size_t>(&config.max_connections)->default_value(0), "Максимум открытых соединений, сверх него ответ 503 (0 - без ограничения)")
+            ("backlog", po::value<int>(&config.backlog)->default_value(static_cast<int>(net::socket_base::max_listen_connections)), "Длина очереди ожидающих приема соединений")
+            ("header-limit", po::value<size_t>(&config.session.header_limit)->default_value(8 * 1024), "Максимальный размер заголовков запроса, байт")
+            ("body-limit", po::value<size_t>(&config.session.body_limit)->default_value(8 * 1024 * 1024), "Максимальный размер тела запроса, байт")
+            ("chunk-size", po::value<size_t>(&config.session.chunk_size)->default_value(64 * 1024), "Размер части потокового ответа (GET /all, выборки CI и связей), байт")
+            ("response-cache", po::value<size_t>(&config.response_cache.max_entries)->default_value(64), "Максимум ответов GET /all, /ci и /relationship в кэше (0 - кэш выключен)")
+            ("response-cache-entry", po::value<size_t>(&config.response_cache.max_entry_size)->default_value(1024 * 1024), "Максимальный размер кэшируемого ответа, байт")
+            ("compression-level", po::value<int>(&config.compression.level)->default_value(6), "Уровень сжатия ответов gzip / deflate для клиентов с Accept-Encoding, 1-9 (0 - сжатие выключено)")
+            ("compression-min-size", po::value<size_t>(&config.compression.min_size)->default_value(1024), "Минимальный размер сжимаемого ответа, байт (потоковые ответы сжимаются всегда)")
+            ("export-dir", po::value<std::string>(&config.exporter.directory)->default_value(""), "Каталог файла полной выгрузки для GET /all через sendfile (пусто - выгрузка выключена)")
+            ("export-settle", po::value<size_t>(&export_settle)->default_value(500), "Время без модификаций перед пересборкой файла выгрузки, мс")
+            ("max-pending", po::value<size_t>(&config.session.max_pending)->default_value(0), "Максимум запросов в очереди каждого класса запросов, сверх него ответ 503 (0 - без ограничения)")
+            ("batch-concurrency", po::value<size_t>(&config.batch_concurrency)->default_value(0), "Максимум одновременно обрабатываемых пакетных запросов (0 - половина потоков обработчиков)")
+            ("retry-after", po::value<size_t>(&retry_after)->default_value(1), "Значение Retry-After в ответах 503, секунд")
+            ("db,d", po::value<std::string>(&config.db)->default_value("cmdb.bin"), "Путь к файлу БД");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -26,12 +61,57 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
+        config.session.idle_timeout = std::chrono::seconds(idle_timeout);
+        config.session.keep_alive = !no_keep_alive;
+        config.exporter.settle = std::chrono::milliseconds(export_settle);
+        config.session.read_timeout = std::chrono::seconds(read_timeout);
+        config.session.write_timeout = std::chrono::seconds(write_timeout);
+        config.session.retry_after = std::chrono::seconds(retry_after);
+        config.handler_pool.target_latency = std::chrono::milliseconds(queue_latency);
+
+        if (handler_placement == "pin") {
+            config.handler_placement = ThreadPool::Placement::Pinned;
+        } else if (handler_placement == "numa") {
+            config.handler_placement = ThreadPool::Placement::NumaNodes;
+        } else if (handler_placement != "float") {
+            throw po::invalid_option_value(handler_placement);
+        }
+
+        MemoryPolicy memory_policy;
+
+        if (!Topology::parseMemoryPolicy(numa_memory, memory_policy)) {
+            throw po::invalid_option_value(numa_memory);
+        }
+
+        // Политика наследуется потоками, созданными позже, и действует при загрузке CMDB.
+        if (!Topology::setMemoryPolicy(memory_policy)) {
+            std::cerr << "Не удалось установить политику памяти " << numa_memory << std::endl;
+        }
+
         std::cout << "Используемые параметры:" << std::endl;
-        std::cout << "  Порт: " << port << std::endl;
-        std::cout << "  Число потоков: " << num_threads << std::endl;
-        std::cout << "  Файл БД: " << db_path << std::endl;
+        std::cout << "  Порт: " << config.port << std::endl;
+        std::cout << "  Число потоков ввода-вывода: " << config.io_threads << std::endl;
+        std::cout << "  Циклы событий на поток (SO_REUSEPORT): " << (config.reuse_port ? "да" : "нет") << std::endl;
+        std::cout << "  Привязка потоков к ядрам: " << (config.pin_threads ? "да" : "нет") << std::endl;
+        std::cout << "  Размещение обработчиков / памяти: " << handler_placement << " / " << numa_memory
+                  << " (узлов NUMA: " << Topology::system().nodeCount() << ")" << std::endl;
+        std::cout << "  Число потоков обработчиков: " << config.handler_threads << std::endl;
+        std::cout << "  Пределы числа обработчиков: " << config.handler_pool.min_threads << " - " << config.handler_pool.max_threads << std::endl;
+        std::cout << "  Параллельность пакетных запросов: " << config.batch_concurrency << std::endl;
+        std::cout << "  Число сегментов: " << config.shard_count << std::endl;
+        std::cout << "  Размер пачки записи: " << config.write_batch << std::endl;
+        std::cout << "  Keep-alive: " << (config.session.keep_alive ? "да" : "нет") << std::endl;
+        std::cout << "  Таймаут простоя соединения: " << idle_timeout << " с" << std::endl;
+        std::cout << "  Таймауты чтения / записи: " << read_timeout << " / " << write_timeout << " с" << std::endl;
+        std::cout << "  Максимум соединений: " << config.max_connections << std::endl;
+        std::cout << "  Лимиты заголовков / тела: " << config.session.header_limit << " / " << config.session.body_limit << " байт" << std::endl;
+        std::cout << "  Кэш ответов: " << config.response_cache.max_entries << " по " << config.response_cache.max_entry_size << " байт" << std::endl;
+        std::cout << "  Сжатие ответов: уровень " << config.compression.level << " от " << config.compression.min_size << " байт" << std::endl;
+        std::cout << "  Каталог выгрузки: " << (config.exporter.directory.empty() ? "выключено" : config.exporter.directory) << std::endl;
+        std::cout << "  Максимум запросов в очереди: " << config.session.max_pending << std::endl;
+        std::cout << "  Файл БД: " << config.db << std::endl;
 
-        Server server(port, num_threads, db_path);
+        Server server(config);
         server.Run();
 
     } catch (const po::error& e) {
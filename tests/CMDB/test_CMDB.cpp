@@ -1,6 +1,13 @@
 #define BOOST_TEST_MODULE CMDBTests
 #include <boost/test/included/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include "../../CMDB/CMDB.h"
 #include "../../CMDB/CI.h"
 
@@ -104,4 +111,487 @@ BOOST_AUTO_TEST_CASE(PropertyFilterSearch) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(HasPropsFilter) {
+    std::remove(filename.c_str());
+    auto& cmdb = CMDB::getInstance(filename);
+
+    cmdb.addCI("HP1", "Web", "Server", 1, {{"HpOS", "Ubuntu"}, {"HpZone", "A"}});
+    cmdb.addCI("HP2", "Web", "Server", 1, {{"HpOS", "Debian"}});
+    cmdb.addCI("HP3", "Db", "Server", 2, {{"HpOS", "Ubuntu"}, {"HpZone", "B"}});
+
+    // Результат выборки по свойствам должен жить до конца просмотра (проверяется сборкой с WITH_ASAN)
+    auto result = cmdb.getCIs(std::map<std::string, std::string>{{"has_props", "HpOS,HpZone"}, {"name", "Web"}});
+
+    BOOST_REQUIRE_EQUAL(result->size(), 1u);
+    BOOST_CHECK_EQUAL(result->front()->getId(), "HP1");
+    BOOST_CHECK_EQUAL(cmdb.getCIs(std::map<std::string, std::string>{{"has_props", "HpOS"}})->size(), 3u);
+    BOOST_CHECK(cmdb.getCIs(std::map<std::string, std::string>{{"has_props", "Rack"}})->empty());
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotIsolation) {
+    std::remove(filename.c_str());
+    auto& cmdb = CMDB::getInstance(filename);
+
+    auto before = cmdb.snapshot();
+    BOOST_REQUIRE(before);
+    BOOST_CHECK(!before->getCI("CI_SNAP"));
+
+    BOOST_CHECK(cmdb.addCI("CI_SNAP", "Cache", "Service", 1, {{"Port", "6379"}}));
+    BOOST_CHECK(cmdb.setProperty("CI_SNAP", "Port", "6380"));
+
+    auto after = cmdb.snapshot();
+    BOOST_CHECK(after->getGeneration() > before->getGeneration());
+    BOOST_CHECK_EQUAL(cmdb.getGeneration(), after->getGeneration());
+
+    BOOST_CHECK(!before->getCI("CI_SNAP"));
+    BOOST_CHECK(!before->hasProperty("Port"));
+
+    auto ci = after->getCI("CI_SNAP");
+    BOOST_REQUIRE(ci);
+    BOOST_CHECK_EQUAL(ci->getProperty("Port").value(), "6380");
+
+    BOOST_CHECK(cmdb.removeCI("CI_SNAP"));
+    BOOST_CHECK(after->getCI("CI_SNAP"));
+    BOOST_CHECK(!cmdb.getCI("CI_SNAP"));
+}
+
+BOOST_AUTO_TEST_CASE(BuilderSharesStructureWithPublishedSnapshots) {
+    const size_t count = 3000;
+    SnapshotBuilder builder(std::make_shared<Snapshot>(4));
+
+    for (size_t i = 0; i < count; ++i) {
+        auto id = "PS_" + std::to_string(i);
+        builder.insertCI(std::make_shared<CI>(id, id, "Host", 1,
+            std::unordered_map<std::string, std::string>{{"Parity", std::to_string(i % 2)}}));
+
+        if (i > 0) {
+            builder.addRelationship(std::make_shared<Relationship>("PS_" + std::to_string(i - 1), id, "Next"));
+        }
+    }
+
+    auto first = builder.build(1);
+
+    for (size_t i = 0; i < count; i += 2) {
+        auto id = "PS_" + std::to_string(i);
+        builder.removeRelationshipsForId(id);
+        BOOST_CHECK(builder.eraseCI(id));
+    }
+    builder.putCI(std::make_shared<CI>("PS_1", "PS_1", "Host", 2,
+        std::unordered_map<std::string, std::string>{{"Zone", "A"}}));
+
+    auto second = builder.build(2);
+
+    // Первая версия не видит изменений, внесенных построителем после ее сборки
+    BOOST_CHECK_EQUAL(first->getCICount(), count);
+    BOOST_CHECK_EQUAL(first->getRelationshipCount(), count - 1);
+    BOOST_CHECK(first->getCI("PS_0"));
+    BOOST_CHECK_EQUAL(first->getCI("PS_1")->getLevel(), 1);
+    BOOST_CHECK(!first->hasProperty("Zone"));
+    BOOST_REQUIRE(first->getDependents("PS_1"));
+    BOOST_CHECK_EQUAL(first->getDependents("PS_1")->size(), 1u);
+
+    BOOST_CHECK_EQUAL(second->getCICount(), count / 2);
+    BOOST_CHECK_EQUAL(second->getRelationshipCount(), 0u);
+    BOOST_CHECK(!second->getCI("PS_0"));
+    BOOST_CHECK_EQUAL(second->getCI("PS_1")->getLevel(), 2);
+    BOOST_CHECK(second->hasProperty("Zone"));
+    BOOST_CHECK(!second->getDependents("PS_1"));
+
+    size_t visited = 0;
+    std::string previous;
+    second->forEachCIAfter(std::nullopt, [&](const Snapshot::CIPtr& ci) {
+        BOOST_CHECK(previous < ci->getId());
+        previous = ci->getId();
+        ++visited;
+        return true;
+    });
+    BOOST_CHECK_EQUAL(visited, count / 2);
+}
+
+BOOST_AUTO_TEST_CASE(BuilderDoesNotChangePublishedLevels) {
+    SnapshotBuilder builder(std::make_shared<Snapshot>(4));
+    builder.levels().push_back("L0");
+
+    auto first = builder.build(1);
+    builder.levels().push_back("L1");
+
+    auto latest = std::make_shared<Snapshot>(4);
+    auto second = builder.rebase(*latest, 2);
+    auto third = builder.rebase(*latest, 3);
+    builder.levels()[0] = "Renamed";
+
+    BOOST_CHECK_EQUAL(first->getLevels().size(), 1u);
+    BOOST_CHECK_EQUAL(second->getLevels().size(), 2u);
+    BOOST_CHECK_EQUAL(second->getLevels()[0], "L0");
+    // Повторный rebase (как при повторе compare-and-swap) переносит изменение уровней
+    BOOST_CHECK_EQUAL(third->getLevels().size(), 2u);
+    BOOST_CHECK_EQUAL(builder.view().getLevels()[0], "Renamed");
+}
+
+BOOST_AUTO_TEST_CASE(ShardedWritesAndRelationships) {
+    auto& cmdb = CMDB::getInstance(filename);
+    BOOST_CHECK_EQUAL(cmdb.getShardCount(), CMDB::DEFAULT_SHARD_COUNT);
+
+    const int writers = 4;
+    const int per_writer = 50;
+    std::vector<std::thread> threads;
+
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&cmdb, w]() {
+            for (int i = 0; i < per_writer; ++i) {
+                cmdb.addCI("SH_" + std::to_string(w) + "_" + std::to_string(i), "Node", "Shard", 0, {{"Zone", std::to_string(w)}});
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto cis = cmdb.getCIs("Shard");
+    BOOST_REQUIRE(cis);
+    BOOST_CHECK_EQUAL(cis->size(), static_cast<size_t>(writers * per_writer));
+    BOOST_CHECK_EQUAL(cmdb.getCIs(std::vector<std::string>{"Zone"})->size(), static_cast<size_t>(writers * per_writer));
+
+    for (int i = 1; i < per_writer; ++i) {
+        BOOST_CHECK(cmdb.addRelationship("SH_0_0", "SH_1_" + std::to_string(i), "Uses"));
+        BOOST_CHECK(cmdb.addRelationship("SH_2_" + std::to_string(i), "SH_0_0", "Feeds"));
+    }
+
+    BOOST_CHECK_EQUAL(cmdb.getRelationships(std::map<std::string, std::string>{{"source", "SH_0_0"}})->size(), static_cast<size_t>(per_writer - 1));
+    BOOST_CHECK_EQUAL(cmdb.getDependentCIs("SH_0_0")->size(), static_cast<size_t>(per_writer - 1));
+
+    BOOST_CHECK(cmdb.removeCI("SH_0_0"));
+    BOOST_CHECK(cmdb.getDependentCIs("SH_1_1")->empty());
+    BOOST_CHECK(cmdb.getRelationships(std::map<std::string, std::string>{{"source", "SH_2_1"}})->empty());
+
+    for (int w = 0; w < writers; ++w) {
+        for (int i = 0; i < per_writer; ++i) {
+            cmdb.removeCI("SH_" + std::to_string(w) + "_" + std::to_string(i));
+        }
+    }
+
+    BOOST_CHECK(!cmdb.snapshot()->hasProperty("Zone"));
+}
+
+BOOST_AUTO_TEST_CASE(WritePipelineBatches) {
+    auto& cmdb = CMDB::getInstance(filename);
+    cmdb.enableWritePipeline(64);
+    BOOST_CHECK(cmdb.isWritePipelineEnabled());
+
+    const int writers = 4;
+    const int per_writer = 100;
+    std::atomic<int> added{0};
+    std::vector<std::thread> threads;
+
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&cmdb, &added, w]() {
+            for (int i = 0; i < per_writer; ++i) {
+                if (cmdb.addCI("WP_" + std::to_string(w) + "_" + std::to_string(i), "Node", "Pipeline", 0)) {
+                    ++added;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    BOOST_CHECK_EQUAL(added.load(), writers * per_writer);
+    BOOST_CHECK(!cmdb.addCI("WP_0_0", "Node", "Pipeline", 0));
+    BOOST_CHECK(cmdb.addRelationship("WP_0_0", "WP_1_0", "Uses"));
+    BOOST_CHECK_EQUAL(cmdb.getDependentCIs("WP_1_0")->size(), 1);
+
+    for (int w = 0; w < writers; ++w) {
+        for (int i = 0; i < per_writer; ++i) {
+            BOOST_CHECK(cmdb.removeCI("WP_" + std::to_string(w) + "_" + std::to_string(i)));
+        }
+    }
+
+    cmdb.disableWritePipeline();
+    BOOST_CHECK(!cmdb.isWritePipelineEnabled());
+    BOOST_CHECK(!cmdb.getCIs("Pipeline"));
+}
+
+BOOST_AUTO_TEST_CASE(WritePipelineReportsCommitFailure) {
+    std::atomic<bool> broken{true};
+    auto base = std::make_shared<Snapshot>(4);
+    std::shared_ptr<const Snapshot> published = base;
+
+    WritePipeline pipeline([&](const WritePipeline::Batch& batch) {
+        SnapshotBuilder builder(published);
+
+        for (auto* mutation : batch) {
+            mutation->apply(builder);
+        }
+
+        if (broken) {
+            throw std::runtime_error("commit failed");
+        }
+
+        published = builder.build(1);
+    });
+
+    auto add = [](SnapshotBuilder& builder) {
+        builder.putCI(std::make_shared<CI>("WF_1", "Node", "Pipeline"));
+        return true;
+    };
+
+    auto failed = pipeline.submit(add);
+    BOOST_CHECK_THROW(failed.get(), std::runtime_error);
+    BOOST_CHECK(!published->getCI("WF_1"));
+
+    std::promise<bool> callback_failed;
+    pipeline.submit(add, [&](std::exception_ptr error, bool) { callback_failed.set_value(error != nullptr); });
+    BOOST_CHECK(callback_failed.get_future().get());
+
+    broken = false;
+    BOOST_CHECK(pipeline.submit(add).get());
+    BOOST_CHECK(published->getCI("WF_1"));
+}
+
+BOOST_AUTO_TEST_CASE(TransactionIsAtomic) {
+    auto& cmdb = CMDB::getInstance(filename);
+
+    std::vector<TxOperation> operations(3);
+    operations[0].type = TxOperation::Type::AddCI;
+    operations[0].id = "TX_A";
+    operations[0].name = "App";
+    operations[0].ci_type = "Tx";
+    operations[1].type = TxOperation::Type::AddCI;
+    operations[1].id = "TX_B";
+    operations[1].name = "Db";
+    operations[1].ci_type = "Tx";
+    operations[2].type = TxOperation::Type::AddRelationship;
+    operations[2].id = "TX_A";
+    operations[2].to_id = "TX_MISSING";
+    operations[2].relationship_type = "Uses";
+
+    auto generation = cmdb.getGeneration();
+    auto rejected = cmdb.applyTransaction(operations);
+
+    BOOST_CHECK(!rejected.committed);
+    BOOST_CHECK_EQUAL(rejected.failed_index, 2);
+    BOOST_CHECK_EQUAL(rejected.messages.size(), 3);
+    BOOST_CHECK(!cmdb.getCI("TX_A"));
+    BOOST_CHECK_EQUAL(cmdb.getGeneration(), generation);
+
+    operations[2].to_id = "TX_B";
+    auto committed = cmdb.applyTransaction(operations);
+
+    BOOST_CHECK(committed.committed);
+    BOOST_CHECK_EQUAL(cmdb.getGeneration(), generation + 1);
+    BOOST_CHECK(cmdb.getCI("TX_A"));
+    BOOST_CHECK_EQUAL(cmdb.getDependentCIs("TX_B")->size(), 1);
+
+    std::vector<TxOperation> cleanup(2);
+    cleanup[0].type = TxOperation::Type::RemoveCI;
+    cleanup[0].id = "TX_A";
+    cleanup[1].type = TxOperation::Type::RemoveCI;
+    cleanup[1].id = "TX_B";
+
+    BOOST_CHECK(cmdb.applyTransaction(cleanup).committed);
+    BOOST_CHECK(!cmdb.getCIs("Tx"));
+}
+
+BOOST_AUTO_TEST_CASE(AsyncTransactionAcknowledgement) {
+    auto& cmdb = CMDB::getInstance(filename);
+
+    auto makeOperations = [](const std::string& id, TxOperation::Type type) {
+        std::vector<TxOperation> operations(1);
+        operations[0].type = type;
+        operations[0].id = id;
+        operations[0].name = "Async";
+        operations[0].ci_type = "AsyncTx";
+        return operations;
+    };
+
+    bool called = false;
+    cmdb.applyTransaction(makeOperations("ASYNC_A", TxOperation::Type::AddCI), [&](std::exception_ptr error, TxResult result) {
+        called = !error && result.committed;
+    });
+
+    BOOST_CHECK(called);
+    BOOST_CHECK(cmdb.getCI("ASYNC_A"));
+
+    cmdb.enableWritePipeline(16);
+
+    std::vector<std::future<TxResult>> results;
+    for (const char* id : {"ASYNC_B", "ASYNC_C", "ASYNC_A"}) {
+        auto promise = std::make_shared<std::promise<TxResult>>();
+        results.push_back(promise->get_future());
+
+        cmdb.applyTransaction(makeOperations(id, TxOperation::Type::AddCI), [promise](std::exception_ptr error, TxResult result) {
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value(std::move(result));
+            }
+        });
+    }
+
+    BOOST_CHECK(results[0].get().committed);
+    BOOST_CHECK(results[1].get().committed);
+    BOOST_CHECK(!results[2].get().committed);
+    BOOST_CHECK_EQUAL(cmdb.getCIs("AsyncTx")->size(), 3);
+
+    cmdb.disableWritePipeline();
+
+    for (const char* id : {"ASYNC_A", "ASYNC_B", "ASYNC_C"}) {
+        BOOST_CHECK(cmdb.applyTransaction(makeOperations(id, TxOperation::Type::RemoveCI)).committed);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BulkAddCIsAndRelationships) {
+    auto& cmdb = CMDB::getInstance(filename);
+    const int count = 600;
+
+    std::vector<CMDB::CIData> cis;
+    for (int i = 0; i < count; ++i) {
+        cis.push_back({"BULK_" + std::to_string(i), "Node", "Bulk", 0, {{"zone", i % 2 ? "odd" : "even"}}});
+    }
+    cis.push_back({"BULK_0", "Duplicate", "Bulk", 0, {}});
+    cis.push_back({"BULK_BAD_LEVEL", "Node", "Bulk", 1000, {}});
+
+    auto generation = cmdb.getGeneration();
+    auto added = cmdb.addCIs(cis);
+
+    BOOST_CHECK_EQUAL(added.added, count);
+    BOOST_CHECK_EQUAL(cmdb.getGeneration(), generation + 1);
+    BOOST_CHECK(added.succeeded[0]);
+    BOOST_CHECK(!added.succeeded[count]);
+    BOOST_CHECK(!added.succeeded[count + 1]);
+    BOOST_CHECK_EQUAL(cmdb.getCIs("Bulk")->size(), count);
+    BOOST_CHECK_EQUAL(cmdb.getCIs(std::vector<std::string>{"zone"})->size(), count);
+
+    std::vector<CMDB::RelationshipData> relationships;
+    for (int i = 1; i < count; ++i) {
+        relationships.push_back({"BULK_" + std::to_string(i), "BULK_0", "Uses"});
+    }
+    relationships.push_back({"BULK_1", "BULK_MISSING", "Uses"});
+
+    auto linked = cmdb.addRelationships(relationships);
+
+    BOOST_CHECK_EQUAL(linked.added, count - 1);
+    BOOST_CHECK(!linked.succeeded.back());
+    BOOST_CHECK_EQUAL(cmdb.getDependentCIs("BULK_0")->size(), count - 1);
+
+    for (int i = 0; i < count; ++i) {
+        BOOST_CHECK(cmdb.removeCI("BULK_" + std::to_string(i)));
+    }
+    BOOST_CHECK(!cmdb.getCIs("Bulk"));
+}
+
+BOOST_AUTO_TEST_CASE(KeysetPagination) {
+    auto& cmdb = CMDB::getInstance(filename);
+    const int count = 120;
+    const size_t limit = 50;
+
+    for (int i = 0; i < count; ++i) {
+        char id[16];
+        std::snprintf(id, sizeof(id), "PAGE_%03d", i);
+        cmdb.addCI(id, "Node", "Page", 0, {});
+    }
+
+    std::map<std::string, std::string> filters{{"type", "Page"}};
+    std::vector<std::string> seen;
+    std::optional<std::string> after;
+    bool more = true;
+
+    while (more) {
+        auto page = cmdb.getCIs(filters, after, limit, more);
+        BOOST_REQUIRE(!page->empty());
+        BOOST_CHECK_LE(page->size(), limit);
+
+        for (const auto& ci : *page) {
+            seen.push_back(ci->getId());
+        }
+        after = seen.back();
+
+        // Изменения между страницами не сдвигают еще не выданные КЕ
+        if (seen.size() == limit) {
+            BOOST_CHECK(cmdb.removeCI("PAGE_000"));
+            cmdb.addCI("PAGE_001A", "Node", "Page", 0, {});
+        }
+    }
+
+    BOOST_CHECK_EQUAL(seen.size(), static_cast<size_t>(count));
+    BOOST_CHECK(std::is_sorted(seen.begin(), seen.end()));
+    BOOST_CHECK_EQUAL(seen[limit], "PAGE_050");
+
+    auto single = cmdb.getCIs({{"id", "PAGE_070"}}, std::string("PAGE_060"), limit, more);
+    BOOST_CHECK_EQUAL(single->size(), 1u);
+    BOOST_CHECK(cmdb.getCIs({{"id", "PAGE_070"}}, std::string("PAGE_080"), limit, more)->empty());
+
+    for (int i = 2; i < 12; ++i) {
+        char id[16];
+        std::snprintf(id, sizeof(id), "PAGE_%03d", i);
+        BOOST_CHECK(cmdb.addRelationship("PAGE_001", id, "Uses"));
+        BOOST_CHECK(cmdb.addRelationship(id, "PAGE_001", "Feeds"));
+    }
+
+    std::optional<RelationshipKey> rel_after;
+    size_t rels = 0;
+    do {
+        auto page = cmdb.getRelationships({{"source", "PAGE_001"}}, rel_after, 3, more);
+        BOOST_REQUIRE(!page->empty());
+        for (const auto& rel : *page) {
+            BOOST_CHECK_EQUAL(rel->getSource(), "PAGE_001");
+        }
+        rels += page->size();
+        rel_after = RelationshipKey{page->back()->getSource(), page->back()->getDestination(), page->back()->getType()};
+    } while (more);
+    BOOST_CHECK_EQUAL(rels, 10u);
+
+    auto feeds = cmdb.getRelationships({{"type", "Feeds"}}, std::nullopt, 100, more);
+    BOOST_CHECK_EQUAL(feeds->size(), 10u);
+    BOOST_CHECK(!more);
+
+    BOOST_CHECK(cmdb.removeCI("PAGE_001"));
+    BOOST_CHECK(cmdb.getRelationships({{"type", "Feeds"}}, std::nullopt, 100, more)->empty());
+
+    auto remaining = cmdb.getCIs("Page");
+    BOOST_REQUIRE(remaining);
+    for (const auto& ci : *remaining) {
+        BOOST_CHECK(cmdb.removeCI(ci->getId()));
+    }
+    BOOST_CHECK(cmdb.getCIs(filters, std::nullopt, limit, more)->empty());
+}
+
+BOOST_AUTO_TEST_CASE(CountWithoutMaterialization) {
+    auto& cmdb = CMDB::getInstance(filename);
+
+    for (int i = 0; i < 10; ++i) {
+        cmdb.addCI("COUNT_" + std::to_string(i), "Node", "Counted", 0,
+                   i < 4 ? std::unordered_map<std::string, std::string>{{"Rack", "R1"}, {"Zone", "A"}}
+                         : std::unordered_map<std::string, std::string>{{"Rack", "R2"}});
+    }
+    BOOST_CHECK(cmdb.addRelationship("COUNT_0", "COUNT_1", "Uses"));
+    BOOST_CHECK(cmdb.addRelationship("COUNT_2", "COUNT_1", "Uses"));
+
+    // Счет совпадает с размером выборки для тех же фильтров
+    for (const auto& filters : std::vector<std::map<std::string, std::string>>{
+             {}, {{"type", "Counted"}}, {{"has_props", "Rack"}}, {{"has_props", "Rack,Zone"}, {"type", "Counted"}},
+             {{"id", "COUNT_3"}}, {{"id", "COUNT_3"}, {"name", "Other"}}}) {
+        BOOST_CHECK_EQUAL(cmdb.countCIs(filters), cmdb.getCIs(filters)->size());
+    }
+
+    for (const auto& filters : std::vector<std::map<std::string, std::string>>{
+             {}, {{"source", "COUNT_0"}}, {{"destination", "COUNT_1"}}, {{"destination", "COUNT_1"}, {"source", "COUNT_2"}},
+             {{"type", "Uses"}}, {{"destination", "COUNT_0"}}}) {
+        BOOST_CHECK_EQUAL(cmdb.countRelationships(filters), cmdb.getRelationships(filters)->size());
+    }
+
+    // Проверка существования останавливается на первом совпадении
+    BOOST_CHECK_EQUAL(cmdb.countCIs({{"type", "Counted"}}, 1), 1u);
+    BOOST_CHECK_EQUAL(cmdb.countCIs({{"has_props", "Zone"}, {"type", "Counted"}}, 3), 3u);
+    BOOST_CHECK_EQUAL(cmdb.countRelationships({{"destination", "COUNT_1"}}, 1), 1u);
+    BOOST_CHECK_EQUAL(cmdb.countCIs({{"type", "Missing"}}, 1), 0u);
+
+    for (int i = 0; i < 10; ++i) {
+        BOOST_CHECK(cmdb.removeCI("COUNT_" + std::to_string(i)));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
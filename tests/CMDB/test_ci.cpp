@@ -1,5 +1,6 @@
 #define BOOST_TEST_MODULE test_ci
 #include <boost/test/unit_test.hpp>
+#include <type_traits>
 #include "../../CMDB/CI.h"
 
 using namespace cmdb;
@@ -101,4 +102,62 @@ BOOST_AUTO_TEST_CASE(TestJSONSerialization) {
     BOOST_CHECK(json_str.find("\"cpu\":\"Intel\"") != std::string::npos);
 }
 
+BOOST_AUTO_TEST_CASE(TestCachedJSON) {
+    CI ci("CI1", "Server", "Hardware", 1, {{"cpu", "Intel"}});
+    int builds = 0;
+    auto build = [&](std::string& json) {
+        ++builds;
+        json = ci.getName() + ":" + ci.getProperty("cpu").value_or("");
+    };
+
+    BOOST_CHECK_EQUAL(ci.getCachedJSON(build), "Server:Intel");
+    BOOST_CHECK_EQUAL(ci.getCachedJSON(build), "Server:Intel");
+    BOOST_CHECK_EQUAL(builds, 1);
+
+    CI copy(ci);
+    BOOST_CHECK(copy.setName("Backup"));
+    BOOST_CHECK_EQUAL(copy.getCachedJSON([&](std::string& json) { ++builds; json = copy.getName(); }), "Backup");
+    BOOST_CHECK_EQUAL(builds, 2);
+    BOOST_CHECK_EQUAL(ci.getCachedJSON(build), "Server:Intel");
+
+    BOOST_CHECK(!ci.setName("Server"));
+    BOOST_CHECK_EQUAL(ci.getCachedJSON(build), "Server:Intel");
+    BOOST_CHECK_EQUAL(builds, 2);
+
+    BOOST_CHECK(ci.setProperty("cpu", std::string("AMD")));
+    BOOST_CHECK_EQUAL(ci.getCachedJSON(build), "Server:AMD");
+    BOOST_CHECK_EQUAL(builds, 3);
+
+    BOOST_CHECK(ci.removeProperty("cpu"));
+    BOOST_CHECK_EQUAL(ci.getCachedJSON(build), "Server:");
+    BOOST_CHECK(ci.setLevel(2));
+    BOOST_CHECK_EQUAL(ci.getCachedJSON(build), "Server:");
+    BOOST_CHECK_EQUAL(builds, 5);
+}
+
+BOOST_AUTO_TEST_CASE(TestMove) {
+    static_assert(std::is_nothrow_move_constructible<CI>::value, "CI must be nothrow movable");
+    static_assert(std::is_nothrow_move_assignable<CI>::value, "CI must be nothrow move assignable");
+
+    CI ci("CI1", "Server", "Hardware", 1, {{"cpu", "Intel"}});
+    auto name = [](const CI& source) {
+        return [&source](std::string& json) { json = source.getName(); };
+    };
+    BOOST_CHECK_EQUAL(ci.getCachedJSON(name(ci)), "Server");
+
+    CI moved(std::move(ci));
+    BOOST_CHECK_EQUAL(moved.getId(), "CI1");
+    BOOST_CHECK_EQUAL(moved.getLevel(), 1);
+    BOOST_CHECK_EQUAL(moved.getProperty("cpu").value(), "Intel");
+    BOOST_CHECK_EQUAL(moved.getCachedJSON(name(moved)), "Server");
+
+    CI target("CI2", "Router", "Network");
+    BOOST_CHECK_EQUAL(target.getCachedJSON(name(target)), "Router");
+
+    target = std::move(moved);
+    BOOST_CHECK_EQUAL(target.getId(), "CI1");
+    BOOST_CHECK_EQUAL(target.getProperties().size(), 1);
+    BOOST_CHECK_EQUAL(target.getCachedJSON(name(target)), "Server");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
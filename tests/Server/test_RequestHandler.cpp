@@ -1,9 +1,15 @@
 #define BOOST_TEST_MODULE RequestHandlerTest
 #include <boost/test/included/unit_test.hpp>
 #include <cstdio>
+#include <functional>
+#include <future>
+#include <zlib.h>
 #include "../../CMDB/CMDB.h"
 #include "../../Server/Controller/RequestHandler.h"
 #include "../../Server/Model/DataStore.h"
+#include "../../Server/View/Cbor.h"
+#include "../../Server/View/Compressor.h"
+#include "../../Server/View/JsonWriter.h"
 
 using namespace boost::beast;
 using namespace http;
@@ -12,6 +18,31 @@ BOOST_AUTO_TEST_SUITE(RequestHandlerTestSuite)
 
 std::string filename = "test_file.bin";
 
+namespace {
+
+std::string inflateBody(const std::string& data) {
+    z_stream stream{};
+    inflateInit2(&stream, 15 + 32);
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    std::string out;
+    int result = Z_OK;
+    while (result == Z_OK) {
+        char buffer[4096];
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+    inflateEnd(&stream);
+
+    return result == Z_STREAM_END ? out : "<inflate error>";
+}
+
+} // namespace
+
 BOOST_AUTO_TEST_CASE(TestHandleAddLevel) {
     std::remove(filename.c_str());
 
@@ -113,4 +144,654 @@ BOOST_AUTO_TEST_CASE(TestHandleAddRelation) {
     BOOST_CHECK_EQUAL(rel->at(0)->getType(), "Depends");
 }
 
+BOOST_AUTO_TEST_CASE(TestHandleTransaction) {
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+
+    RequestHandler handler(store);
+
+    std::string tx_body = R"({"operations": [
+        {"op": "add_ci", "ci": {"id": "TX0001", "name": "Web", "type": "Service", "level": 1}},
+        {"op": "add_ci", "ci": {"id": "TX0002", "name": "Db", "type": "Service", "level": 1}},
+        {"op": "add_relationship", "relationship": {"source": "TX0001", "destination": "TX0002", "type": "Uses"}},
+        {"op": "update_ci", "ci": {"id": "TX0002", "properties": {"Port": "5432"}}}
+    ]})";
+
+    request<string_body> req{verb::post, "/api/v1/data/tx", 11};
+    req.body() = tx_body;
+    req.prepare_payload();
+
+    response<string_body> res;
+    handler.handleRequest(req, res);
+
+    BOOST_CHECK_EQUAL(res.result(), status::ok);
+    BOOST_CHECK(cmdb.getCI("TX0001"));
+    BOOST_CHECK_EQUAL(cmdb.getCI("TX0002")->getProperty("Port").value(), "5432");
+    BOOST_CHECK(cmdb.getRelationships("TX0001", "TX0002"));
+
+    std::string bad_body = R"([
+        {"op": "remove_ci", "id": "TX0001"},
+        {"op": "remove_ci", "id": "TX0001"}
+    ])";
+
+    request<string_body> bad_req{verb::post, "/api/v1/data/tx", 11};
+    bad_req.body() = bad_body;
+    bad_req.prepare_payload();
+
+    response<string_body> bad_res;
+    handler.handleRequest(bad_req, bad_res);
+
+    BOOST_CHECK_EQUAL(bad_res.result(), status::bad_request);
+    BOOST_CHECK(cmdb.getCI("TX0001"));
+
+    request<string_body> typed_req{verb::post, "/api/v1/data/tx", 11};
+    typed_req.body() = R"([
+        {"op": "remove_ci", "id": "TX0001"},
+        {"op": "add_ci", "ci": {"id": "TX0003", "name": 1, "type": "t", "level": "x"}}
+    ])";
+    typed_req.prepare_payload();
+
+    response<string_body> typed_res;
+    handler.handleRequest(typed_req, typed_res);
+
+    BOOST_CHECK_EQUAL(typed_res.result(), status::bad_request);
+    std::string typed_message(boost::json::parse(typed_res.body()).at("error").as_string());
+    BOOST_CHECK_EQUAL(typed_message.rfind("Транзакция отменена: операция 1", 0), 0u);
+    BOOST_CHECK(cmdb.getCI("TX0001"));
+
+    auto typed_error = store.applyTransaction(boost::json::parse(typed_req.body()));
+    BOOST_CHECK_EQUAL(typed_error.at("status").as_string(), "failure");
+    BOOST_CHECK_EQUAL(typed_error.at("failed_index").as_int64(), 1);
+
+    auto relationship_error = store.applyTransaction(boost::json::parse(
+        R"([{"op": "add_relationship", "relationship": {"source": "TX0001", "destination": 2, "type": "Uses"}}])"));
+    BOOST_CHECK_EQUAL(relationship_error.at("failed_index").as_int64(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestClassifyRequests) {
+    auto classify = [](verb method, const std::string& target, const std::string& body = "") {
+        request<string_body> req{method, target, 11};
+        req.body() = body;
+        return RequestHandler::classify(req);
+    };
+
+    BOOST_CHECK_EQUAL(classify(verb::get, "/api/v1/data/ci?id=CI001"), RequestHandler::Interactive);
+    BOOST_CHECK_EQUAL(classify(verb::get, "/api/v1/data/level?id=1"), RequestHandler::Interactive);
+    BOOST_CHECK_EQUAL(classify(verb::get, "/api/v1/data/props?id=CI001"), RequestHandler::Interactive);
+    BOOST_CHECK_EQUAL(classify(verb::get, "/api/v1/data/ci?type=Server&count=true"), RequestHandler::Interactive);
+    BOOST_CHECK_EQUAL(classify(verb::head, "/api/v1/data/relationship?source=CI001"), RequestHandler::Interactive);
+    BOOST_CHECK_EQUAL(classify(verb::get, "/"), RequestHandler::Interactive);
+
+    BOOST_CHECK_EQUAL(classify(verb::get, "/api/v1/data/ci?type=Server"), RequestHandler::Normal);
+    BOOST_CHECK_EQUAL(classify(verb::get, "/api/v1/data/relationship"), RequestHandler::Normal);
+    BOOST_CHECK_EQUAL(classify(verb::post, "/api/v1/data/ci", R"({"id": "CI001"})"), RequestHandler::Normal);
+    BOOST_CHECK_EQUAL(classify(verb::delete_, "/api/v1/data/ci?id=CI001"), RequestHandler::Normal);
+
+    BOOST_CHECK_EQUAL(classify(verb::get, "/api/v1/data/all"), RequestHandler::Batch);
+    BOOST_CHECK_EQUAL(classify(verb::post, "/api/v1/data/tx", "[]"), RequestHandler::Batch);
+    BOOST_CHECK_EQUAL(classify(verb::post, "/api/v1/data/ci", R"( [{"id": "CI001"}])"), RequestHandler::Batch);
+}
+
+BOOST_AUTO_TEST_CASE(TestAsyncHandleTransaction) {
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+    RequestHandler handler(store);
+
+    cmdb.enableWritePipeline(8);
+
+    request<string_body> req{verb::post, "/api/v1/data/tx", 11};
+    req.body() = R"([{"op": "add_ci", "ci": {"id": "ASYNC01", "name": "Async", "type": "Server", "level": 0}}])";
+    req.prepare_payload();
+
+    response<string_body> res;
+    auto done = handler.asyncHandleRequest(req, res, boost::asio::use_future);
+    done.get();
+
+    BOOST_CHECK_EQUAL(res.result(), status::ok);
+    BOOST_CHECK(cmdb.getCI("ASYNC01"));
+
+    request<string_body> bad_req{verb::post, "/api/v1/data/tx", 11};
+    bad_req.body() = "{not json";
+    bad_req.prepare_payload();
+
+    response<string_body> bad_res;
+    bool called = false;
+    handler.handleRequest(bad_req, bad_res, [&]() { called = true; });
+
+    BOOST_CHECK(called);
+    BOOST_CHECK_EQUAL(bad_res.result(), status::bad_request);
+
+    request<string_body> typed_req{verb::post, "/api/v1/data/tx", 11};
+    typed_req.body() = R"([{"op": "add_ci", "ci": {"id": "a", "name": 1, "type": "t", "level": "x"}}])";
+    typed_req.prepare_payload();
+
+    response<string_body> typed_res;
+    handler.asyncHandleRequest(typed_req, typed_res, boost::asio::use_future).get();
+
+    BOOST_CHECK_EQUAL(typed_res.result(), status::bad_request);
+    BOOST_CHECK(!cmdb.getCI("a"));
+
+    // Поток-писатель только передает шаг формирования ответа исполнителю сессии
+    request<string_body> tx_req{verb::post, "/api/v1/data/tx", 11};
+    tx_req.body() = R"([{"op": "add_ci", "ci": {"id": "ASYNC02", "name": "Async", "type": "Server", "level": 0}}])";
+    tx_req.prepare_payload();
+
+    response<string_body> tx_res;
+    std::promise<std::function<void()>> dispatched;
+    bool finished = false;
+    handler.handleRequest(tx_req, tx_res, [&]() { finished = true; },
+        [&](std::function<void()> step) { dispatched.set_value(std::move(step)); });
+
+    auto step = dispatched.get_future().get();
+    BOOST_CHECK(!finished);
+    BOOST_CHECK(tx_res.body().empty());
+
+    step();
+    BOOST_CHECK(finished);
+    BOOST_CHECK_EQUAL(tx_res.result(), status::ok);
+
+    request<string_body> get_req{verb::get, "/api/v1/data/ci?id=ASYNC01", 11};
+    response<string_body> get_res;
+    handler.asyncHandleRequest(get_req, get_res, boost::asio::use_future).get();
+
+    BOOST_CHECK_EQUAL(get_res.result(), status::ok);
+
+    cmdb.disableWritePipeline();
+}
+
+BOOST_AUTO_TEST_CASE(TestStreamLargeResponses) {
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+    RequestHandler handler(store, {0, 0});
+
+    auto drain = [](BodyStream& body, size_t limit, size_t& chunks) {
+        std::string result;
+        bool more = true;
+
+        while (more) {
+            std::string chunk;
+            more = body.next(chunk, limit);
+            result += chunk;
+            ++chunks;
+        }
+
+        return result;
+    };
+
+    request<string_body> all_req{verb::get, "/api/v1/data/all", 11};
+    response<string_body> all_res;
+    std::unique_ptr<BodyStream> all;
+
+    BOOST_REQUIRE(handler.handleRead(all_req, all_res, all));
+    BOOST_REQUIRE(all);
+    BOOST_CHECK(all_res.chunked());
+
+    size_t chunks = 0;
+    BOOST_CHECK_EQUAL(drain(*all, 16, chunks), boost::json::serialize(store.getAllRecords()));
+    BOOST_CHECK_GT(chunks, 2u);
+
+    request<string_body> ci_req{verb::get, "/api/v1/data/ci", 11};
+    response<string_body> ci_res;
+    handler.handleRequest(ci_req, ci_res);
+    std::string expected = ci_res.body();
+
+    std::unique_ptr<BodyStream> cis;
+    BOOST_REQUIRE(handler.handleRead(ci_req, ci_res, cis));
+    BOOST_REQUIRE(cis);
+    BOOST_CHECK_EQUAL(drain(*cis, 1, chunks), expected);
+
+    // Бюджет части считается от дописанных байт, а не от размера уже заполненного буфера
+    std::string filled(64, ' ');
+    BOOST_REQUIRE(handler.handleRead(all_req, all_res, all));
+    BOOST_CHECK(!all->next(filled, 1 << 20));
+    BOOST_CHECK_EQUAL(filled.substr(64), boost::json::serialize(store.getAllRecords()));
+
+    filled.assign(64, ' ');
+    BOOST_REQUIRE(handler.handleRead(ci_req, ci_res, cis));
+    BOOST_CHECK(!cis->next(filled, 1 << 20));
+    BOOST_CHECK_EQUAL(filled.substr(64), expected);
+
+    request<string_body> missing_req{verb::get, "/api/v1/data/ci?type=Missing", 11};
+    response<string_body> missing_res;
+    std::unique_ptr<BodyStream> missing;
+    BOOST_CHECK(handler.handleRead(missing_req, missing_res, missing));
+    BOOST_CHECK(!missing);
+    BOOST_CHECK_EQUAL(missing_res.result(), status::not_found);
+
+    request<string_body> post_req{verb::post, "/api/v1/data/ci", 11};
+    BOOST_CHECK(!handler.handleRead(post_req, missing_res, missing));
+}
+
+BOOST_AUTO_TEST_CASE(TestJsonWriter) {
+    std::string clean(40, 'a');
+    clean[20] = '\x80';
+    BOOST_CHECK_EQUAL(JsonWriter::findEscape(clean.data(), clean.size()), clean.size());
+
+    clean[33] = '\x01';
+    BOOST_CHECK_EQUAL(JsonWriter::findEscape(clean.data(), clean.size()), 33u);
+
+    std::vector<std::string> strings = {
+        "",
+        "plain",
+        "\"quoted\"",
+        "0123456789abcde\\",
+        "0123456789abcdef\n tail",
+        "tab\there\r\n and a long suffix without escapes at all",
+        std::string("nul\0byte", 8),
+        "\x1f\x7f \xd0\xa1\xd0\xb5\xd1\x80\xd0\xb2\xd0\xb5\xd1\x80 /path",
+    };
+
+    for (const auto& value : strings) {
+        std::string out;
+        JsonWriter::writeString(out, value);
+        BOOST_CHECK_EQUAL(out, boost::json::serialize(boost::json::string(value)));
+    }
+
+    cmdb::CI ci("CI\"01", "Web\tServer", "Server", 2, {{"Port", "80"}, {"Path", "C:\\www"}});
+    std::string ci_json;
+    JsonWriter::write(ci_json, ci);
+    BOOST_CHECK_EQUAL(ci_json, boost::json::serialize(ci.asJSON()));
+
+    cmdb::Relationship relationship("CI01", "CI02", "depends", 1.0);
+    std::string relationship_json;
+    JsonWriter::write(relationship_json, relationship);
+    auto parsed = boost::json::parse(relationship_json).as_object();
+    BOOST_CHECK(parsed.at("source") == "CI01");
+    BOOST_CHECK(parsed.at("destination") == "CI02");
+    BOOST_CHECK(parsed.at("type") == "depends");
+    BOOST_CHECK(parsed.at("weight").is_double());
+    BOOST_CHECK_EQUAL(parsed.at("weight").as_double(), 1.0);
+
+    std::string link_json;
+    JsonWriter::writeLink(link_json, relationship);
+    BOOST_CHECK_EQUAL(link_json, R"({"from_id":"CI01","to_id":"CI02","type":"depends"})");
+}
+
+BOOST_AUTO_TEST_CASE(TestResponseCache) {
+    ResponseCache cache({2, 8});
+
+    cache.put("/a", 1, "aaa");
+    cache.put("/b", 1, "bbb");
+    cache.put("/big", 1, "0123456789");
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+
+    BOOST_REQUIRE(cache.get("/a", 1));
+    cache.put("/c", 1, "ccc");
+    BOOST_CHECK(!cache.get("/b", 1));
+    BOOST_CHECK_EQUAL(*cache.get("/a", 1), "aaa");
+
+    BOOST_CHECK(!cache.get("/c", 2));
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(TestConditionalReads) {
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+    RequestHandler handler(store);
+
+    request<string_body> req{verb::get, "/api/v1/data/ci?type=Server&level=3", 11};
+    response<string_body> first;
+    handler.handleRequest(req, first);
+
+    BOOST_CHECK_EQUAL(first.result(), status::ok);
+    std::string etag(first[field::etag]);
+    BOOST_REQUIRE(!etag.empty());
+    BOOST_CHECK_EQUAL(handler.cache().size(), 1u);
+
+    request<string_body> reordered{verb::get, "/api/v1/data/ci?level=3&type=Server", 11};
+    response<string_body> cached;
+    std::unique_ptr<BodyStream> body;
+    BOOST_REQUIRE(handler.handleRead(reordered, cached, body));
+    BOOST_CHECK(!body);
+    BOOST_CHECK_EQUAL(cached.body(), first.body());
+    BOOST_CHECK_EQUAL(cached[field::etag], etag);
+
+    req.set(field::if_none_match, "\"other\", W/" + etag);
+    response<string_body> not_modified;
+    handler.handleRequest(req, not_modified);
+    BOOST_CHECK_EQUAL(not_modified.result(), status::not_modified);
+    BOOST_CHECK(not_modified.body().empty());
+
+    request<string_body> add{verb::post, "/api/v1/data/level", 11};
+    add.body() = R"({"name": "Cache Level"})";
+    add.prepare_payload();
+    response<string_body> add_res;
+    handler.handleRequest(add, add_res);
+
+    response<string_body> modified;
+    handler.handleRequest(req, modified);
+    BOOST_CHECK_EQUAL(modified.result(), status::ok);
+    BOOST_CHECK_NE(modified[field::etag], etag);
+    BOOST_CHECK_EQUAL(modified.body(), first.body());
+
+    // "*" совпадает только с существующей выборкой
+    req.set(field::if_none_match, "*");
+    response<string_body> any;
+    handler.handleRequest(req, any);
+    BOOST_CHECK_EQUAL(any.result(), status::not_modified);
+
+    request<string_body> missing{verb::get, "/api/v1/data/ci?type=Nope", 11};
+    missing.set(field::if_none_match, "*");
+    response<string_body> missing_res;
+    handler.handleRequest(missing, missing_res);
+    BOOST_CHECK_EQUAL(missing_res.result(), status::not_found);
+}
+
+BOOST_AUTO_TEST_CASE(TestCompression) {
+    using Encoding = Compressor::Encoding;
+
+    BOOST_CHECK(Compressor::negotiate("gzip, deflate, br") == Encoding::Gzip);
+    BOOST_CHECK(Compressor::negotiate("deflate;q=1, gzip;q=0.5") == Encoding::Deflate);
+    BOOST_CHECK(Compressor::negotiate("gzip;q=0, *") == Encoding::Deflate);
+    BOOST_CHECK(Compressor::negotiate("br, identity") == Encoding::Identity);
+    BOOST_CHECK(Compressor::negotiate("") == Encoding::Identity);
+
+    std::string text(10000, 'x');
+    BOOST_CHECK_EQUAL(inflateBody(Compressor::compress(text, Encoding::Gzip, 6)), text);
+    BOOST_CHECK_EQUAL(inflateBody(Compressor::compress(text, Encoding::Deflate, 1)), text);
+    BOOST_CHECK_LT(Compressor::compress(text, Encoding::Gzip, 6).size(), 200u);
+
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+    RequestHandler handler(store, {0, 0}, {6, 64});
+
+    request<string_body> req{verb::get, "/api/v1/data/all", 11};
+    response<string_body> plain;
+    handler.handleRequest(req, plain);
+    BOOST_CHECK(!plain.count(field::content_encoding));
+    BOOST_CHECK_EQUAL(plain[field::vary], "Accept, Accept-Encoding");
+
+    // Потоковый ответ сжимается по частям и совпадает с несжатым после распаковки.
+    req.set(field::accept_encoding, "gzip");
+    response<string_body> streamed;
+    std::unique_ptr<BodyStream> body;
+    BOOST_REQUIRE(handler.handleRead(req, streamed, body));
+    BOOST_REQUIRE(body);
+    BOOST_CHECK_EQUAL(streamed[field::content_encoding], "gzip");
+    BOOST_CHECK_NE(streamed[field::etag], plain[field::etag]);
+
+    std::string packed;
+    while (body->next(packed, 16)) {
+    }
+    BOOST_CHECK_EQUAL(inflateBody(packed), plain.body());
+
+    // Готовые тела сжимаются целиком, если они не меньше min_size.
+    request<string_body> levels{verb::get, "/api/v1/data/level", 11};
+    levels.set(field::accept_encoding, "deflate");
+    response<string_body> compressed;
+    handler.handleRequest(levels, compressed);
+
+    levels.erase(field::accept_encoding);
+    response<string_body> uncompressed;
+    handler.handleRequest(levels, uncompressed);
+
+    BOOST_REQUIRE_GE(uncompressed.body().size(), 64u);
+    BOOST_CHECK_EQUAL(compressed[field::content_encoding], "deflate");
+    BOOST_CHECK_EQUAL(compressed[field::content_length], std::to_string(compressed.body().size()));
+    BOOST_CHECK_EQUAL(inflateBody(compressed.body()), uncompressed.body());
+}
+
+BOOST_AUTO_TEST_CASE(TestPagination) {
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+    RequestHandler handler(store, {0, 0});
+
+    for (int i = 0; i < 120; ++i) {
+        cmdb.addCI("PG" + std::to_string(1000 + i), "Paged", "PageType", 0, {});
+    }
+
+    auto readPage = [&](const std::string& target) {
+        request<string_body> req{verb::get, target, 11};
+        response<string_body> res;
+        handler.handleRequest(req, res);
+        BOOST_REQUIRE_EQUAL(res.result(), status::ok);
+        return boost::json::parse(res.body()).as_object();
+    };
+
+    std::vector<std::string> ids;
+    std::string target = "/api/v1/data/ci?type=PageType&limit=50";
+
+    for (int page = 0; page < 3; ++page) {
+        auto body = readPage(target);
+        const auto& items = body.at("items").as_array();
+        BOOST_CHECK_EQUAL(items.size(), page < 2 ? 50u : 20u);
+
+        for (const auto& item : items) {
+            ids.push_back(boost::json::value_to<std::string>(item.as_object().at("id")));
+        }
+
+        if (page == 0) {
+            // Вставка перед курсором не сдвигает следующую страницу
+            cmdb.addCI("PG0999", "Paged", "PageType", 0, {});
+        }
+
+        if (page < 2) {
+            BOOST_REQUIRE(body.at("next_cursor").is_string());
+            target = "/api/v1/data/ci?type=PageType&cursor=" +
+                boost::json::value_to<std::string>(body.at("next_cursor")) + "&limit=50";
+        } else {
+            BOOST_CHECK(body.at("next_cursor").is_null());
+        }
+    }
+
+    BOOST_REQUIRE_EQUAL(ids.size(), 120u);
+    BOOST_CHECK_EQUAL(ids.front(), "PG1000");
+    BOOST_CHECK_EQUAL(ids[50], "PG1050");
+    BOOST_CHECK_EQUAL(ids.back(), "PG1119");
+
+    auto empty = readPage("/api/v1/data/ci?type=Missing&limit=10");
+    BOOST_CHECK(empty.at("items").as_array().empty());
+    BOOST_CHECK(empty.at("next_cursor").is_null());
+
+    BOOST_CHECK(cmdb.addRelationship("PG1000", "PG1001", "Uses"));
+    BOOST_CHECK(cmdb.addRelationship("PG1000", "PG1002", "Uses"));
+    auto rels = readPage("/api/v1/data/relationship?source=PG1000&limit=1");
+    BOOST_CHECK_EQUAL(rels.at("items").as_array().size(), 1u);
+    BOOST_REQUIRE(rels.at("next_cursor").is_string());
+    auto rest = readPage("/api/v1/data/relationship?source=PG1000&limit=1&cursor=" +
+        boost::json::value_to<std::string>(rels.at("next_cursor")));
+    BOOST_CHECK_EQUAL(rest.at("items").as_array().size(), 1u);
+    BOOST_CHECK(rest.at("next_cursor").is_null());
+
+    for (const std::string query : {"limit=0", "limit=abc", "cursor=%25%25", "limit=5&cursor=cGF"}) {
+        request<string_body> req{verb::get, "/api/v1/data/ci?" + query, 11};
+        response<string_body> res;
+        handler.handleRequest(req, res);
+        BOOST_CHECK_EQUAL(res.result(), status::bad_request);
+    }
+
+    for (const auto& id : ids) {
+        cmdb.removeCI(id);
+    }
+    cmdb.removeCI("PG0999");
+}
+
+BOOST_AUTO_TEST_CASE(TestFieldProjection) {
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+    RequestHandler handler(store, {0, 0});
+
+    cmdb.addCI("FP1", "Projected", "FieldType", 2, {{"Zone", "A"}, {"Rack", "R1"}, {"Owner x", "ops"}});
+    cmdb.addCI("FP2", "Projected", "FieldType", 2, {{"Rack", "R2"}});
+    BOOST_CHECK(cmdb.addRelationship("FP1", "FP2", "Uses"));
+
+    auto read = [&](const std::string& target, status expected = status::ok) {
+        request<string_body> req{verb::get, target, 11};
+        response<string_body> res;
+        handler.handleRequest(req, res);
+        BOOST_CHECK_EQUAL(res.result(), expected);
+        return res.body();
+    };
+
+    BOOST_CHECK_EQUAL(read("/api/v1/data/ci?type=FieldType&fields=id,type&limit=10"),
+                      R"({"items":[{"id":"FP1","type":"FieldType"},{"id":"FP2","type":"FieldType"}],"next_cursor":null})");
+    BOOST_CHECK_EQUAL(read("/api/v1/data/ci?id=FP1&fields=id,properties.Zone,properties.Owner%20x,properties.Missing"),
+                      R"([{"id":"FP1","properties":{"Zone":"A","Owner x":"ops"}}])");
+    BOOST_CHECK_EQUAL(read("/api/v1/data/ci?id=FP2&fields=level,properties.Zone&limit=5"),
+                      R"({"items":[{"level":2,"properties":{}}],"next_cursor":null})");
+    BOOST_CHECK_EQUAL(read("/api/v1/data/ci?id=FP1&fields=id,name,type,level,properties"),
+                      read("/api/v1/data/ci?id=FP1"));
+    BOOST_CHECK_EQUAL(read("/api/v1/data/relationship?source=FP1&fields=destination"),
+                      R"([{"destination":"FP2"}])");
+    BOOST_CHECK_EQUAL(read("/api/v1/data/relationship?source=FP1&fields=typ%65,destination"),
+                      R"([{"type":"Uses","destination":"FP2"}])");
+
+    read("/api/v1/data/ci?type=FieldType&fields=", status::bad_request);
+    read("/api/v1/data/ci?type=FieldType&fields=id,source", status::bad_request);
+    read("/api/v1/data/relationship?source=FP1&fields=name", status::bad_request);
+
+    cmdb.removeCI("FP1");
+    cmdb.removeCI("FP2");
+}
+
+BOOST_AUTO_TEST_CASE(TestCbor) {
+    BOOST_CHECK(CborWriter::accepted("application/cbor"));
+    BOOST_CHECK(CborWriter::accepted("application/json;q=0.5, application/cbor"));
+    BOOST_CHECK(!CborWriter::accepted("application/json, application/cbor;q=0.5"));
+    BOOST_CHECK(!CborWriter::accepted("application/cbor;q=0"));
+    BOOST_CHECK(!CborWriter::accepted("*/*"));
+
+    BOOST_CHECK_EQUAL(CborWriter::encode(boost::json::value(1000)), std::string("\x19\x03\xe8", 3));
+    BOOST_CHECK_EQUAL(CborWriter::encode(boost::json::value(-1)), std::string("\x20", 1));
+    BOOST_CHECK_EQUAL(CborWriter::encode(boost::json::value("a")), std::string("\x61" "a", 2));
+
+    auto value = boost::json::parse(R"({"a":[1,-20,300000,2.5,true,false,null],"b":{"c":"text"},"d":[]})");
+    BOOST_CHECK_EQUAL(boost::json::serialize(CborReader::decode(CborWriter::encode(value))), boost::json::serialize(value));
+
+    // Массив и строка неопределенной длины, тег, float16
+    auto indefinite = CborReader::decode(std::string("\x9f\x01\x7f\x61x\x61y\xff\xc1\x02\xf9\x3c\x00\xff", 14));
+    BOOST_CHECK_EQUAL(boost::json::serialize(indefinite), boost::json::serialize(boost::json::parse(R"([1,"xy",2,1.0])")));
+
+    BOOST_CHECK_THROW(CborReader::decode(std::string("\x82\x01", 2)), std::invalid_argument);
+    BOOST_CHECK_THROW(CborReader::decode(std::string("\x01\x02", 2)), std::invalid_argument);
+    BOOST_CHECK_THROW(CborReader::decode(std::string("\xa1\x01\x02", 3)), std::invalid_argument);
+    BOOST_CHECK_THROW(CborReader::decode(std::string("\x7b\xff\xff\xff\xff\xff\xff\xff\xff", 9)), std::invalid_argument);
+    BOOST_CHECK_THROW(CborReader::decode(std::string(100, '\x81') + '\x01'), std::invalid_argument);
+
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+    RequestHandler handler(store, {0, 0});
+
+    boost::json::value ci = boost::json::parse(
+        R"([{"id":"CB1","name":"Binary","type":"CborType","level":1,"properties":{"Zone":"B"}},
+            {"id":"CB2","name":"Binary","type":"CborType","level":1}])");
+
+    request<string_body> add{verb::post, "/api/v1/data/ci", 11};
+    add.set(field::content_type, "application/cbor");
+    add.set(field::accept, "application/cbor");
+    add.body() = CborWriter::encode(ci);
+    add.prepare_payload();
+    response<string_body> added;
+    handler.handleRequest(add, added);
+    BOOST_CHECK_EQUAL(added.result(), status::ok);
+    BOOST_CHECK_EQUAL(added[field::content_type], "application/cbor");
+    BOOST_CHECK(CborReader::decode(added.body()).is_object());
+    BOOST_CHECK(cmdb.getCI("CB1"));
+
+    auto read = [&](const std::string& target, bool binary) {
+        request<string_body> req{verb::get, target, 11};
+        if (binary) {
+            req.set(field::accept, "application/cbor");
+        }
+        response<string_body> res;
+        handler.handleRequest(req, res);
+        BOOST_CHECK_EQUAL(res.result(), status::ok);
+        BOOST_CHECK_EQUAL(res[field::content_type], binary ? "application/cbor" : "application/json");
+        return res;
+    };
+
+    for (std::string target : {"/api/v1/data/ci?id=CB1", "/api/v1/data/ci?type=CborType&limit=1",
+                               "/api/v1/data/ci?type=CborType&fields=id,properties.Zone&limit=5",
+                               "/api/v1/data/level"}) {
+        auto json = read(target, false);
+        auto cbor = read(target, true);
+        BOOST_CHECK_EQUAL(boost::json::serialize(CborReader::decode(cbor.body())),
+                          boost::json::serialize(boost::json::parse(json.body())));
+        if (target != "/api/v1/data/level") {
+            BOOST_CHECK_NE(cbor[field::etag], json[field::etag]);
+        }
+    }
+
+    auto all = CborReader::decode(read("/api/v1/data/all", true).body()).as_object();
+    auto all_json = boost::json::parse(read("/api/v1/data/all", false).body()).as_object();
+    BOOST_CHECK_EQUAL(all.at("cis").as_array().size(), all_json.at("cis").as_array().size());
+    BOOST_CHECK_EQUAL(all.at("levels").as_array().size(), all_json.at("levels").as_array().size());
+
+    request<string_body> bad{verb::post, "/api/v1/data/ci", 11};
+    bad.set(field::content_type, "application/cbor");
+    bad.body() = std::string("\x82\x01", 2);
+    bad.prepare_payload();
+    response<string_body> rejected;
+    handler.handleRequest(bad, rejected);
+    BOOST_CHECK_EQUAL(rejected.result(), status::bad_request);
+
+    cmdb.removeCI("CB1");
+    cmdb.removeCI("CB2");
+}
+
+BOOST_AUTO_TEST_CASE(TestCount) {
+    auto& cmdb = cmdb::CMDB::getInstance(filename);
+    DataStore store(cmdb);
+    RequestHandler handler(store, {0, 0});
+
+    for (int i = 0; i < 12; ++i) {
+        cmdb.addCI("CN" + std::to_string(100 + i), "Counted", "CountType", i % 3,
+                   i % 2 == 0 ? std::unordered_map<std::string, std::string>{{"Zone", "A"}}
+                              : std::unordered_map<std::string, std::string>{});
+    }
+    BOOST_CHECK(cmdb.addRelationship("CN100", "CN101", "Uses"));
+    BOOST_CHECK(cmdb.addRelationship("CN100", "CN102", "Uses"));
+    BOOST_CHECK(cmdb.addRelationship("CN103", "CN102", "Feeds"));
+
+    auto count = [&](const std::string& target) {
+        request<string_body> req{verb::get, target, 11};
+        response<string_body> res;
+        handler.handleRequest(req, res);
+        BOOST_REQUIRE_EQUAL(res.result(), status::ok);
+        auto body = boost::json::parse(res.body()).as_object();
+        BOOST_CHECK_EQUAL(body.size(), 1u);
+        return boost::json::value_to<size_t>(body.at("count"));
+    };
+
+    BOOST_CHECK_EQUAL(count("/api/v1/data/ci?type=CountType&count=true"), 12u);
+    BOOST_CHECK_EQUAL(count("/api/v1/data/ci?type=CountType&level=1&count=true"), 4u);
+    BOOST_CHECK_EQUAL(count("/api/v1/data/ci?has_props=Zone&type=CountType&count=true"), 6u);
+    BOOST_CHECK_EQUAL(count("/api/v1/data/ci?id=CN105&count=true"), 1u);
+    BOOST_CHECK_EQUAL(count("/api/v1/data/ci?count=true"), cmdb.getCIs(std::map<std::string, std::string>{})->size());
+    BOOST_CHECK_EQUAL(count("/api/v1/data/relationship?source=CN100&count=true"), 2u);
+    BOOST_CHECK_EQUAL(count("/api/v1/data/relationship?destination=CN102&count=true"), 2u);
+    BOOST_CHECK_EQUAL(count("/api/v1/data/relationship?destination=CN102&type=Feeds&count=true"), 1u);
+    BOOST_CHECK_EQUAL(count("/api/v1/data/relationship?type=Feeds&count=true"),
+                      cmdb.getRelationships(std::map<std::string, std::string>{{"type", "Feeds"}})->size());
+    BOOST_CHECK_EQUAL(count("/api/v1/data/relationship?source=CN999&count=true"), 0u);
+
+    auto head = [&](const std::string& target, const char* if_none_match = nullptr) {
+        request<string_body> req{verb::head, target, 11};
+        if (if_none_match) {
+            req.set(field::if_none_match, if_none_match);
+        }
+        response<string_body> res;
+        handler.handleRequest(req, res);
+        BOOST_CHECK(res.body().empty());
+        BOOST_CHECK(!res[field::etag].empty());
+        return res.result();
+    };
+
+    BOOST_CHECK_EQUAL(head("/api/v1/data/ci?type=CountType&level=2"), status::ok);
+    BOOST_CHECK_EQUAL(head("/api/v1/data/ci?type=CountType&level=7"), status::not_found);
+    BOOST_CHECK_EQUAL(head("/api/v1/data/relationship?source=CN103&destination=CN102"), status::ok);
+    BOOST_CHECK_EQUAL(head("/api/v1/data/relationship?source=CN103&destination=CN101"), status::not_found);
+    BOOST_CHECK_EQUAL(head("/api/v1/data/ci?type=CountType&level=2", "*"), status::not_modified);
+    BOOST_CHECK_EQUAL(head("/api/v1/data/ci?type=CountType&level=7", "*"), status::not_found);
+
+    request<string_body> bad{verb::get, "/api/v1/data/ci?type=CountType&count=yes", 11};
+    response<string_body> rejected;
+    handler.handleRequest(bad, rejected);
+    BOOST_CHECK_EQUAL(rejected.result(), status::bad_request);
+
+    for (int i = 0; i < 12; ++i) {
+        cmdb.removeCI("CN" + std::to_string(100 + i));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
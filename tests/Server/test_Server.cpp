@@ -0,0 +1,366 @@
+#define BOOST_TEST_MODULE ServerTest
+#include <boost/test/included/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include "../../Server/Server.h"
+
+BOOST_AUTO_TEST_SUITE(ServerTestSuite)
+
+std::string filename = "test_server.bin";
+
+namespace {
+
+ServerConfig makeConfig(size_t handler_threads) {
+    ServerConfig config;
+    config.port = 0;
+    config.io_threads = 2;
+    config.handler_threads = handler_threads;
+    config.db = filename;
+
+    return config;
+}
+
+http::response<http::string_body> get(unsigned short port, const std::string& target) {
+    net::io_context ioc;
+    beast::tcp_stream stream(ioc);
+    stream.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), port));
+
+    http::request<http::string_body> req{http::verb::get, target, 11};
+    http::write(stream, req);
+
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+
+    return res;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ServesConcurrentClients) {
+    std::remove(filename.c_str());
+
+    for (size_t handler_threads : {0, 2}) {
+        Server server(makeConfig(handler_threads));
+        std::thread runner([&server] { server.Run(); });
+
+        std::atomic<int> ok{0};
+        std::vector<std::thread> clients;
+
+        for (int i = 0; i < 8; ++i) {
+            clients.emplace_back([&] {
+                if (get(server.getPort(), "/api/v1/data/all").result() == http::status::ok) {
+                    ++ok;
+                }
+            });
+        }
+
+        for (auto& client : clients) {
+            client.join();
+        }
+
+        BOOST_CHECK_EQUAL(ok.load(), 8);
+        BOOST_CHECK_EQUAL(get(server.getPort(), "/api/v1/data/missing").result(), http::status::not_found);
+
+        server.Stop();
+        runner.join();
+    }
+
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(ReusePortEventLoops) {
+    std::remove(filename.c_str());
+
+    auto config = makeConfig(0);
+    config.io_threads = 4;
+    config.reuse_port = true;
+    config.pin_threads = true;
+
+    Server server(config);
+    std::thread runner([&server] { server.Run(); });
+
+    std::atomic<int> ok{0};
+    std::vector<std::thread> clients;
+
+    for (int i = 0; i < 16; ++i) {
+        clients.emplace_back([&] {
+            if (get(server.getPort(), "/api/v1/data/all").result() == http::status::ok) {
+                ++ok;
+            }
+        });
+    }
+
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    BOOST_CHECK_EQUAL(ok.load(), 16);
+
+    server.Stop();
+    runner.join();
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(KeepAliveAndPipelining) {
+    std::remove(filename.c_str());
+
+    auto config = makeConfig(0);
+    config.session.idle_timeout = std::chrono::seconds(1);
+
+    Server server(config);
+    std::thread runner([&server] { server.Run(); });
+
+    net::io_context ioc;
+    beast::tcp_stream stream(ioc);
+    stream.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), server.getPort()));
+
+    http::request<http::string_body> all{http::verb::get, "/api/v1/data/all", 11};
+    http::request<http::string_body> missing{http::verb::get, "/api/v1/data/missing", 11};
+    http::write(stream, all);
+    http::write(stream, missing);
+    http::write(stream, all);
+
+    beast::flat_buffer buffer;
+    std::vector<http::status> statuses;
+
+    for (int i = 0; i < 3; ++i) {
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+
+        BOOST_CHECK(res.keep_alive());
+        statuses.push_back(res.result());
+    }
+
+    BOOST_CHECK(statuses[0] == http::status::ok);
+    BOOST_CHECK(statuses[1] == http::status::not_found);
+    BOOST_CHECK(statuses[2] == http::status::ok);
+
+    http::response<http::string_body> res;
+    beast::error_code ec;
+    http::read(stream, buffer, res, ec);
+
+    BOOST_CHECK(ec == http::error::end_of_stream);
+
+    server.Stop();
+    runner.join();
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(AdmissionControl) {
+    std::remove(filename.c_str());
+
+    auto config = makeConfig(0);
+    config.max_connections = 1;
+    config.session.body_limit = 64;
+    config.session.retry_after = std::chrono::seconds(5);
+
+    Server server(config);
+    std::thread runner([&server] { server.Run(); });
+
+    net::io_context ioc;
+    beast::tcp_stream held(ioc);
+    held.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), server.getPort()));
+    http::write(held, http::request<http::string_body>{http::verb::get, "/api/v1/data/all", 11});
+
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(held, buffer, res);
+
+    BOOST_CHECK(res.result() == http::status::ok);
+
+    auto rejected = get(server.getPort(), "/api/v1/data/all");
+
+    BOOST_CHECK(rejected.result() == http::status::service_unavailable);
+    BOOST_CHECK_EQUAL(rejected[http::field::retry_after], "5");
+
+    http::request<http::string_body> large{http::verb::post, "/api/v1/data/ci", 11};
+    large.body() = std::string(128, 'x');
+    large.prepare_payload();
+    http::write(held, large);
+
+    res = {};
+    http::read(held, buffer, res);
+
+    BOOST_CHECK(res.result() == http::status::payload_too_large);
+    BOOST_CHECK(!res.keep_alive());
+
+    server.Stop();
+    runner.join();
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(ChunkedResponses) {
+    std::remove(filename.c_str());
+
+    for (size_t handler_threads : {0, 2}) {
+        auto config = makeConfig(handler_threads);
+        config.session.chunk_size = 256;
+
+        Server server(config);
+        std::thread runner([&server] { server.Run(); });
+
+        net::io_context ioc;
+        beast::tcp_stream stream(ioc);
+        stream.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), server.getPort()));
+
+        json::array cis;
+        for (int i = 0; i < 100; ++i) {
+            cis.push_back(json::object{{"id", "CHUNK" + std::to_string(handler_threads) + "_" + std::to_string(i)}, {"name", "Chunk"}, {"type", "Server"}, {"level", 0}});
+        }
+
+        http::request<http::string_body> add{http::verb::post, "/api/v1/data/ci", 11};
+        add.body() = json::serialize(cis);
+        add.prepare_payload();
+        http::write(stream, add);
+
+        beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+
+        BOOST_CHECK(res.result() == http::status::ok);
+
+        http::write(stream, http::request<http::string_body>{http::verb::get, "/api/v1/data/all", 11});
+
+        http::response<http::string_body> chunked;
+        http::read(stream, buffer, chunked);
+
+        BOOST_CHECK(chunked.result() == http::status::ok);
+        BOOST_CHECK(chunked.chunked());
+        BOOST_CHECK(chunked.keep_alive());
+        BOOST_CHECK_GE(json::parse(chunked.body()).as_object().at("cis").as_array().size(), 100u);
+
+        http::write(stream, http::request<http::string_body>{http::verb::get, "/api/v1/data/ci?type=Server", 11});
+
+        http::response<http::string_body> list;
+        http::read(stream, buffer, list);
+
+        BOOST_CHECK(list.chunked());
+        BOOST_CHECK_GE(json::parse(list.body()).as_array().size(), 100u);
+
+        auto plain = get(server.getPort(), "/api/v1/data/missing");
+        BOOST_CHECK(!plain.chunked());
+
+        beast::tcp_stream legacy(ioc);
+        legacy.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), server.getPort()));
+        http::write(legacy, http::request<http::string_body>{http::verb::get, "/api/v1/data/all", 10});
+
+        beast::flat_buffer legacy_buffer;
+        http::response<http::string_body> whole;
+        http::read(legacy, legacy_buffer, whole);
+
+        BOOST_CHECK(!whole.chunked());
+        BOOST_CHECK_EQUAL(whole.body(), chunked.body());
+
+        server.Stop();
+        runner.join();
+        std::remove(filename.c_str());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ExportFile) {
+    std::remove(filename.c_str());
+
+    auto config = makeConfig(0);
+    config.session.chunk_size = 256;
+    config.exporter.directory = "test_export";
+    config.exporter.settle = std::chrono::milliseconds(200);
+    config.response_cache.max_entries = 0;
+
+    Server server(config);
+    std::thread runner([&server] { server.Run(); });
+
+    net::io_context ioc;
+    beast::tcp_stream stream(ioc);
+    stream.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), server.getPort()));
+    beast::flat_buffer buffer;
+
+    auto request = [&](http::request<http::string_body> req) {
+        req.prepare_payload();
+        http::write(stream, req);
+
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        return res;
+    };
+
+    // Ждет, пока GET /all начнет отдаваться из файла выгрузки (Content-Length вместо chunked).
+    auto awaitExport = [&] {
+        http::response<http::string_body> res;
+        for (int i = 0; i < 100; ++i) {
+            res = request({http::verb::get, "/api/v1/data/all", 11});
+            if (!res.chunked()) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return res;
+    };
+
+    json::array cis;
+    for (int i = 0; i < 100; ++i) {
+        cis.push_back(json::object{{"id", "EXPORT_" + std::to_string(i)}, {"name", "Export"}, {"type", "Server"}, {"level", 0}});
+    }
+
+    http::request<http::string_body> add{http::verb::post, "/api/v1/data/ci", 11};
+    add.body() = json::serialize(cis);
+    BOOST_CHECK(request(add).result() == http::status::ok);
+
+    auto exported = awaitExport();
+
+    BOOST_CHECK(exported.result() == http::status::ok);
+    BOOST_REQUIRE(!exported.chunked());
+    BOOST_CHECK(exported.keep_alive());
+    BOOST_CHECK_EQUAL(exported[http::field::content_length], std::to_string(exported.body().size()));
+    BOOST_CHECK_GE(json::parse(exported.body()).as_object().at("cis").as_array().size(), 100u);
+
+    std::string etag(exported[http::field::etag]);
+    BOOST_CHECK(!etag.empty());
+
+    http::request<http::string_body> conditional{http::verb::get, "/api/v1/data/all", 11};
+    conditional.set(http::field::if_none_match, etag);
+    BOOST_CHECK(request(conditional).result() == http::status::not_modified);
+
+    beast::tcp_stream legacy(ioc);
+    legacy.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), server.getPort()));
+    http::write(legacy, http::request<http::string_body>{http::verb::get, "/api/v1/data/all", 10});
+
+    beast::flat_buffer legacy_buffer;
+    http::response<http::string_body> whole;
+    http::read(legacy, legacy_buffer, whole);
+
+    BOOST_CHECK_EQUAL(whole.body(), exported.body());
+
+    http::request<http::string_body> gzip{http::verb::get, "/api/v1/data/all", 11};
+    gzip.set(http::field::accept_encoding, "gzip");
+    auto compressed = request(gzip);
+
+    BOOST_CHECK(!compressed.chunked());
+    BOOST_CHECK_EQUAL(compressed[http::field::content_encoding], "gzip");
+    BOOST_CHECK_LT(compressed.body().size(), exported.body().size());
+
+    // После модификации файл устарел: ответ строится заново, пока выгрузка не пересобрана.
+    http::request<http::string_body> level{http::verb::post, "/api/v1/data/level", 11};
+    level.body() = json::serialize(json::object{{"name", "ExportLevel"}});
+    BOOST_CHECK(request(level).result() == http::status::ok);
+
+    auto fresh = request({http::verb::get, "/api/v1/data/all", 11});
+    BOOST_CHECK(fresh.chunked());
+    BOOST_CHECK_NE(std::string(fresh[http::field::etag]), etag);
+
+    auto rebuilt = awaitExport();
+    BOOST_CHECK(!rebuilt.chunked());
+    BOOST_CHECK_EQUAL(rebuilt.body(), fresh.body());
+    BOOST_CHECK_EQUAL(std::string(rebuilt[http::field::etag]), std::string(fresh[http::field::etag]));
+
+    server.Stop();
+    runner.join();
+    std::remove(filename.c_str());
+    std::filesystem::remove_all("test_export");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
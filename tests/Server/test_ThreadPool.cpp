@@ -1,8 +1,12 @@
 #define BOOST_TEST_MODULE ThreadPoolTests
 #include <boost/test/included/unit_test.hpp>
 #include <atomic>
+#include <array>
 #include <chrono>
+#include <memory>
+#include <stdexcept>
 #include <thread>
+#include "../../Server/ThreadPool/PoolController.h"
 #include "../../Server/ThreadPool/ThreadPool.h"
 
 BOOST_AUTO_TEST_CASE(SingleTaskTest) {
@@ -18,6 +22,28 @@ BOOST_AUTO_TEST_CASE(SingleTaskTest) {
     BOOST_CHECK(taskExecuted.load());
 }
 
+BOOST_AUTO_TEST_CASE(BoundedQueueTest) {
+    ThreadPool pool(1);
+    std::atomic<bool> release{false};
+    std::atomic<int> counter{0};
+
+    pool.enqueue([&]() {
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    BOOST_CHECK(pool.tryEnqueue([&]() { ++counter; }, 2));
+    BOOST_CHECK(pool.tryEnqueue([&]() { ++counter; }, 2));
+    BOOST_CHECK(!pool.tryEnqueue([&]() { ++counter; }, 2));
+    BOOST_CHECK(pool.tryEnqueue([&]() { ++counter; }, 0));
+
+    release = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_CHECK_EQUAL(counter.load(), 3);
+}
+
 BOOST_AUTO_TEST_CASE(MultipleTasksTest) {
     ThreadPool pool(4);
     std::atomic<int> counter{0};
@@ -32,3 +58,229 @@ BOOST_AUTO_TEST_CASE(MultipleTasksTest) {
     std::this_thread::sleep_for(std::chrono::milliseconds(300));
     BOOST_CHECK_EQUAL(counter.load(), 10);
 }
+
+BOOST_AUTO_TEST_CASE(SubmitReturnsResultTest) {
+    ThreadPool pool(2);
+
+    auto answer = pool.submit([]() { return 42; });
+    auto failure = pool.submit([]() -> int { throw std::runtime_error("boom"); });
+
+    BOOST_CHECK_EQUAL(answer.get(), 42);
+    BOOST_CHECK_THROW(failure.get(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(NestedTasksAreStolenTest) {
+    std::atomic<int> counter{0};
+    {
+        ThreadPool pool(4);
+
+        pool.enqueue([&]() {
+            for (int i = 0; i < 1000; ++i) {
+                pool.enqueue([&]() { ++counter; });
+            }
+        });
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(MoveOnlyAndLargeTasksTest) {
+    std::atomic<int> counter{0};
+    {
+        ThreadPool pool(2);
+
+        auto value = std::make_unique<int>(5);
+        pool.enqueue([&counter, value = std::move(value)]() { counter += *value; });
+
+        std::array<char, 256> padding{};
+        padding[0] = 1;
+        pool.enqueue([&counter, padding]() { counter += padding[0]; });
+
+        std::array<char, 4096> huge{};
+        huge[4095] = 2;
+        pool.enqueue([&counter, huge]() { counter += huge[4095]; });
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), 8);
+}
+
+BOOST_AUTO_TEST_CASE(BulkEnqueueTest) {
+    std::atomic<int> counter{0};
+    {
+        ThreadPool pool(3);
+
+        std::vector<Task> external;
+        for (int i = 0; i < 100; ++i) {
+            external.emplace_back([&counter]() { ++counter; });
+        }
+        pool.enqueueBulk(std::move(external));
+
+        pool.enqueue([&]() {
+            std::vector<Task> nested;
+            for (int i = 0; i < 100; ++i) {
+                nested.emplace_back([&counter]() { ++counter; });
+            }
+            pool.enqueueBulk(std::move(nested));
+        });
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), 200);
+}
+
+BOOST_AUTO_TEST_CASE(LaneCapacityAndWeightsTest) {
+    std::vector<size_t> order;
+    {
+        ThreadPool pool(1, {{0, 3, 0}, {2, 1, 0}});
+        std::atomic<bool> release{false};
+
+        BOOST_CHECK_EQUAL(pool.laneCount(), 2u);
+
+        pool.enqueueTo(0, [&]() {
+            while (!release) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        BOOST_CHECK(pool.enqueueTo(1, [&]() { order.push_back(1); }));
+        BOOST_CHECK(pool.enqueueTo(1, [&]() { order.push_back(1); }));
+        BOOST_CHECK(!pool.enqueueTo(1, [&]() { order.push_back(1); }));
+
+        for (int i = 0; i < 6; ++i) {
+            BOOST_CHECK(pool.enqueueTo(0, [&]() { order.push_back(0); }));
+        }
+
+        BOOST_CHECK_EQUAL(pool.pending(0), 6u);
+        BOOST_CHECK_EQUAL(pool.pending(1), 2u);
+
+        release = true;
+    }
+
+    std::vector<size_t> expected = {0, 0, 1, 0, 0, 0, 1, 0};
+    BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(LaneConcurrencyLimitTest) {
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    std::atomic<int> counter{0};
+    {
+        ThreadPool pool(4, {{0, 1, 0}, {0, 1, 1}});
+
+        for (int i = 0; i < 6; ++i) {
+            pool.enqueueTo(1, [&]() {
+                int now = ++running;
+                int seen = peak.load();
+                while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                --running;
+                ++counter;
+            });
+        }
+
+        for (int i = 0; i < 6; ++i) {
+            pool.enqueueTo(0, [&]() { ++counter; });
+        }
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), 12);
+    BOOST_CHECK_EQUAL(peak.load(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ResizeTest) {
+    std::atomic<int> counter{0};
+    {
+        ThreadPool pool(2, {}, 4);
+
+        BOOST_CHECK_EQUAL(pool.size(), 2u);
+        BOOST_CHECK_EQUAL(pool.maxThreads(), 4u);
+
+        pool.resize(10);
+        BOOST_CHECK_EQUAL(pool.size(), 4u);
+
+        for (int i = 0; i < 50; ++i) {
+            pool.enqueue([&counter]() { ++counter; });
+        }
+
+        pool.resize(0);
+        BOOST_CHECK_EQUAL(pool.size(), 1u);
+
+        for (int i = 0; i < 50; ++i) {
+            pool.enqueue([&counter]() { ++counter; });
+        }
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(AdaptiveSizingTest) {
+    ThreadPool pool(1, {}, 4);
+    PoolControllerConfig config;
+    config.interval = std::chrono::milliseconds(10);
+    config.target_latency = std::chrono::milliseconds(2);
+    config.max_cpu = 2.0;
+    config.shrink_after = 5;
+
+    PoolController controller(pool, config);
+    std::atomic<bool> release{false};
+
+    for (int i = 0; i < 4; ++i) {
+        pool.enqueue([&]() {
+            while (!release) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+
+    for (int i = 0; i < 200 && pool.size() < 4; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL(pool.size(), 4u);
+
+    release = true;
+
+    for (int i = 0; i < 200 && pool.size() > 1; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL(pool.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(TopologyTest) {
+    std::vector<int> expected = {0, 1, 2, 3, 8, 10, 11};
+    auto cpus = Topology::parseCpuList("0-3,8,10-11");
+    BOOST_CHECK_EQUAL_COLLECTIONS(cpus.begin(), cpus.end(), expected.begin(), expected.end());
+    BOOST_CHECK(Topology::parseCpuList("a-b").empty());
+
+    Topology topology({{0, 1}, {2, 3}});
+    BOOST_CHECK_EQUAL(topology.nodeCount(), 2u);
+    BOOST_CHECK_EQUAL(topology.cpuCount(), 4u);
+    BOOST_CHECK_EQUAL(topology.node(3), 1u);
+    BOOST_CHECK_EQUAL(topology.cpu(0), 0);
+    BOOST_CHECK_EQUAL(topology.cpu(1), 2);
+    BOOST_CHECK_EQUAL(topology.cpu(2), 1);
+    BOOST_CHECK_EQUAL(topology.cpu(5), 2);
+
+    MemoryPolicy policy = MemoryPolicy::Default;
+    BOOST_CHECK(Topology::parseMemoryPolicy("interleave", policy));
+    BOOST_CHECK(policy == MemoryPolicy::Interleave);
+    BOOST_CHECK(!Topology::parseMemoryPolicy("remote", policy));
+
+    BOOST_CHECK_GE(Topology::system().cpuCount(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(PlacementTest) {
+    std::atomic<int> counter{0};
+    {
+        ThreadPool pinned(2, {}, 0, ThreadPool::Placement::Pinned);
+        ThreadPool numa(2, {}, 0, ThreadPool::Placement::NumaNodes);
+
+        for (int i = 0; i < 20; ++i) {
+            pinned.enqueue([&counter]() { ++counter; });
+            numa.enqueue([&counter]() { ++counter; });
+        }
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), 40);
+}